@@ -101,6 +101,7 @@ bool BufferPoolManager::FlushPageImpl(page_id_t page_id) {
 Page *BufferPoolManager::NewPageImpl(page_id_t *page_id) {
   // 0.   Make sure you call DiskManager::AllocatePage!
   // 1.   If all the pages in the buffer pool are pinned, return nullptr.
+  std::scoped_lock<std::mutex> bpm_lock{latch_};
   if (IsAllPinned()) {
     return nullptr;
   }
@@ -17,6 +17,7 @@
 #include "execution/executors/abstract_executor.h"
 #include "execution/executors/aggregation_executor.h"
 #include "execution/executors/delete_executor.h"
+#include "execution/executors/index_only_scan_executor.h"
 #include "execution/executors/index_scan_executor.h"
 #include "execution/executors/insert_executor.h"
 #include "execution/executors/limit_executor.h"
@@ -40,6 +41,11 @@ std::unique_ptr<AbstractExecutor> ExecutorFactory::CreateExecutor(ExecutorContex
       return std::make_unique<IndexScanExecutor>(exec_ctx, dynamic_cast<const IndexScanPlanNode *>(plan));
     }
 
+    // Create a new index scan executor that reads no table tuples.
+    case PlanType::IndexOnlyScan: {
+      return std::make_unique<IndexOnlyScanExecutor>(exec_ctx, dynamic_cast<const IndexOnlyScanPlanNode *>(plan));
+    }
+
     // Create a new insert executor.
     case PlanType::Insert: {
       auto insert_plan = dynamic_cast<const InsertPlanNode *>(plan);
@@ -0,0 +1,103 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// index_only_scan_executor.cpp
+//
+// Identification: src/execution/index_only_scan_executor.cpp
+//
+//===----------------------------------------------------------------------===//
+#include "execution/executors/index_only_scan_executor.h"
+
+#include <memory>
+
+#include "common/exception.h"
+#include "execution/expressions/column_value_expression.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+/** @return whether every column the expression reads is held by the index */
+bool IsCovered(const AbstractExpression *expr, const std::vector<int> &key_columns) {
+  auto column = dynamic_cast<const ColumnValueExpression *>(expr);
+  if (nullptr != column && (column->GetColIdx() >= key_columns.size() || key_columns[column->GetColIdx()] < 0)) {
+    return false;
+  }
+  for (auto child : expr->GetChildren()) {
+    if (!IsCovered(child, key_columns)) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+IndexOnlyScanExecutor::IndexOnlyScanExecutor(ExecutorContext *exec_ctx, const IndexOnlyScanPlanNode *plan)
+    : AbstractExecutor(exec_ctx),
+      plan_(plan),
+      index_info_(exec_ctx->GetCatalog()->GetIndex(plan->GetIndexOid())) {}
+
+void IndexOnlyScanExecutor::Init() {
+  bool is_tree = Catalog::VisitBPlusTreeIndex(index_info_->index_.get(), [this](auto *index) {
+    auto iter = std::make_shared<decltype(index->GetEndIterator())>(
+        index->GetRangeIterator(plan_->GetLowKey(), plan_->IsLowInclusive(), plan_->GetHighKey(),
+                                plan_->IsHighInclusive(), plan_->IsReverse()));
+    next_entry_ = [this, index, iter](Tuple *table_tuple, RID *rid) {
+      if (*iter == index->GetEndIterator()) {
+        return false;
+      }
+      auto entry = **iter;
+      ++*iter;
+      const Schema &table_schema = table_meta_->schema_;
+      std::vector<Value> table_values;
+      table_values.reserve(table_schema.GetColumnCount());
+      for (uint32_t i = 0; i < table_schema.GetColumnCount(); i++) {
+        table_values.push_back(key_columns_[i] < 0
+                                   ? ValueFactory::GetNullValueByType(table_schema.GetColumn(i).GetType())
+                                   : index->GetKeyValue(entry.first, key_columns_[i]));
+      }
+      *table_tuple = Tuple(table_values, &table_schema);
+      *rid = entry.second;
+      return true;
+    };
+  });
+  if (!is_tree) {
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "index-only scans need a B+ tree index");
+  }
+  table_meta_ = exec_ctx_->GetCatalog()->GetTable(index_info_->table_name_);
+  const auto &key_attrs = index_info_->index_->GetKeyAttrs();
+  key_columns_.assign(table_meta_->schema_.GetColumnCount(), -1);
+  for (size_t i = 0; i < key_attrs.size(); i++) {
+    key_columns_[key_attrs[i]] = static_cast<int>(i);
+  }
+  for (const auto &column : plan_->OutputSchema()->GetColumns()) {
+    if (!IsCovered(column.GetExpr(), key_columns_)) {
+      throw Exception(ExceptionType::INVALID, "index-only scan of a column the index does not hold");
+    }
+  }
+}
+
+bool IndexOnlyScanExecutor::Next(Tuple *tuple, RID *rid) {
+  const Schema &table_schema = table_meta_->schema_;
+  auto schema = plan_->OutputSchema();
+  auto predicate = plan_->GetPredicate();
+  Tuple table_tuple;
+  RID entry_rid;
+  while (next_entry_(&table_tuple, &entry_rid)) {
+    std::vector<Value> values;
+    values.reserve(schema->GetColumnCount());
+    for (const auto &column : schema->GetColumns()) {
+      values.push_back(column.GetExpr()->Evaluate(&table_tuple, &table_schema));
+    }
+    Tuple row_tuple(values, schema);
+    if (nullptr == predicate || predicate->Evaluate(&row_tuple, schema).GetAs<bool>()) {
+      *tuple = row_tuple;
+      *rid = entry_rid;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace bustub
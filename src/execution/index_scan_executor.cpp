@@ -11,9 +11,11 @@
 //===----------------------------------------------------------------------===//
 #include "execution/executors/index_scan_executor.h"
 
+#include <memory>
+
 namespace bustub {
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
-    : AbstractExecutor(exec_ctx), indexIter(INVALID_PAGE_ID, 0, exec_ctx->GetBufferPoolManager()) {
+    : AbstractExecutor(exec_ctx) {
   this->plan_ = plan;
   auto indexOid = plan_->GetIndexOid();
   indexInfo_ = exec_ctx_->GetCatalog()->GetIndex(indexOid);
@@ -21,26 +23,40 @@ IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanP
 }
 
 void IndexScanExecutor::Init() {
-  bPlusTreeIndex =  (BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>*)(indexInfo_->index_.get());
-  indexIter = bPlusTreeIndex->GetBeginIterator();
+  bool is_tree = Catalog::VisitBPlusTreeIndex(indexInfo_->index_.get(), [this](auto *index) {
+    // only the leaves of the key range are read, the predicate still filters the tuples in it
+    auto iter = std::make_shared<decltype(index->GetEndIterator())>(
+        index->GetRangeIterator(plan_->GetLowKey(), plan_->IsLowInclusive(), plan_->GetHighKey(),
+                                plan_->IsHighInclusive(), plan_->IsReverse()));
+    next_rid_ = [index, iter](RID *rid) {
+      if (*iter == index->GetEndIterator()) {
+        return false;
+      }
+      *rid = (**iter).second;
+      ++*iter;
+      return true;
+    };
+  });
+  if (!is_tree) {
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "index scans need a B+ tree index");
+  }
   table_meta_ = exec_ctx_->GetCatalog()->GetTable(indexInfo_->table_name_);;
 }
 
 bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) {
-  if (indexIter == bPlusTreeIndex->GetEndIterator()) {
+  RID entry_rid;
+  if (!next_rid_(&entry_rid)) {
     return false;
   }
-  ++indexIter;
-  auto key = *indexIter;
 
   auto schema = plan_->OutputSchema();
   Tuple key_tuple;
-  if (table_meta_->table_->GetTuple(key.second, &key_tuple, exec_ctx_->GetTransaction())) {
+  if (table_meta_->table_->GetTuple(entry_rid, &key_tuple, exec_ctx_->GetTransaction())) {
     auto predicate = plan_->GetPredicate();
     if (nullptr == predicate
           || predicate->Evaluate(&key_tuple, schema).GetAs<bool>()) {
       *tuple = key_tuple;
-      *rid = key.second;
+      *rid = entry_rid;
       return true;
     }
   }
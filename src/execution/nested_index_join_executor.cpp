@@ -12,45 +12,116 @@
 
 #include "execution/executors/nested_index_join_executor.h"
 
+#include "common/exception.h"
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
+#include "type/value_factory.h"
+
 namespace bustub {
 
+namespace {
+/**
+ * Find the outer column the join predicate equates with the inner column that keys a single column index.
+ * @return the outer column, or nullptr if the predicate is no such equality
+ */
+const ColumnValueExpression *OuterKeyColumn(const AbstractExpression *predicate, uint32_t key_column) {
+  auto comparison = dynamic_cast<const ComparisonExpression *>(predicate);
+  if (nullptr == comparison || ComparisonType::Equal != comparison->GetComparisonType()) {
+    return nullptr;
+  }
+  auto left = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(0));
+  auto right = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(1));
+  if (nullptr == left || nullptr == right) {
+    return nullptr;
+  }
+  if (0 == left->GetTupleIdx() && 1 == right->GetTupleIdx() && key_column == right->GetColIdx()) {
+    return left;
+  }
+  if (1 == left->GetTupleIdx() && 0 == right->GetTupleIdx() && key_column == left->GetColIdx()) {
+    return right;
+  }
+  return nullptr;
+}
+}  // namespace
+
 NestIndexJoinExecutor::NestIndexJoinExecutor(ExecutorContext *exec_ctx, const NestedIndexJoinPlanNode *plan,
                                              std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {
+    : AbstractExecutor(exec_ctx), plan_(plan) {
   child_executor_ = std::move(child_executor);
 }
 
 void NestIndexJoinExecutor::Init() {
   cur_idx_ = 0;
-  Tuple out_tuple;
-  RID out_rid;
-  auto output_schema = plan_->OutputSchema();
+  join_result_.clear();
   child_executor_->Init();
-  auto predicate = plan_->Predicate();
-  auto inner_schema = plan_->InnerTableSchema();
-  auto outer_schema = plan_->OuterTableSchema();
   auto inner_table = exec_ctx_->GetCatalog()->GetTable(plan_->GetInnerTableOid());
-  auto index_info = exec_ctx_->GetCatalog()->GetIndex(inner_table->name_, plan_->GetIndexName());
-  auto bplus_tree_index =  (BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>*)(index_info->index_.get());
-  while (child_executor_->Next(&out_tuple, &out_rid)) {
-    for (auto iter = bplus_tree_index->GetBeginIterator();
-            iter != bplus_tree_index->GetEndIterator(); ++iter) {
-      auto key = *iter;
-      Tuple inner_tuple;
-      if (inner_table->table_->GetTuple(key.second, &inner_tuple, exec_ctx_->GetTransaction())) {
-        if (nullptr == predicate
-              || predicate->EvaluateJoin(&out_tuple, outer_schema, &inner_tuple, inner_schema).GetAs<bool>()) {
-          std::vector<Value> output;
-          for (const auto & column : output_schema->GetColumns()) {
-            auto val = column.GetExpr()->EvaluateJoin(&out_tuple, outer_schema,
-                                                      &inner_tuple, inner_schema);
-            output.push_back(val);
-          }
-          join_result_.emplace_back(Tuple(output, output_schema));
-        }
+  auto index_info = exec_ctx_->GetCatalog()->GetIndex(plan_->GetIndexName(), inner_table->name_);
+  Index *index = index_info->index_.get();
+  const Schema *key_schema = index->GetKeySchema();
+  uint32_t key_column_count = index->GetIndexColumnCount() - index->GetIncludedColumnCount();
+  auto outer_key = 1 == key_column_count ? OuterKeyColumn(plan_->Predicate(), index->GetKeyAttrs()[0]) : nullptr;
+  if (nullptr == outer_key) {
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "index joins need an equality on the column of the index key");
+  }
+
+  // the outer tuples are probed in batches, each batch in one walk of the tree in key order
+  std::vector<Tuple> outer_tuples;
+  std::vector<Tuple> keys;
+  std::vector<std::vector<RID>> inner_rids;
+  auto probe = [&](auto *tree) {
+    tree->ScanKeys(keys, &inner_rids, exec_ctx_->GetTransaction());
+    for (size_t i = 0; i < outer_tuples.size(); i++) {
+      for (const auto &inner_rid : inner_rids[i]) {
+        Join(outer_tuples[i], inner_table, inner_rid);
       }
     }
+  };
 
+  Tuple out_tuple;
+  RID out_rid;
+  bool more = true;
+  while (more) {
+    outer_tuples.clear();
+    keys.clear();
+    while (outer_tuples.size() < static_cast<size_t>(INDEX_JOIN_BATCH_SIZE) &&
+           (more = child_executor_->Next(&out_tuple, &out_rid))) {
+      Value key_value = outer_key->Evaluate(&out_tuple, plan_->OuterTableSchema());
+      if (key_value.IsNull()) {
+        // joins no inner tuple
+        continue;
+      }
+      std::vector<Value> key_values;
+      key_values.reserve(key_schema->GetColumnCount());
+      TypeId key_type = key_schema->GetColumn(0).GetType();
+      key_values.push_back(key_value.GetTypeId() == key_type ? key_value : key_value.CastAs(key_type));
+      // the included columns of the key are not part of the lookup
+      for (uint32_t i = 1; i < key_schema->GetColumnCount(); i++) {
+        key_values.push_back(ValueFactory::GetNullValueByType(key_schema->GetColumn(i).GetType()));
+      }
+      keys.emplace_back(key_values, key_schema);
+      outer_tuples.push_back(out_tuple);
+    }
+    if (!outer_tuples.empty() && !Catalog::VisitBPlusTreeIndex(index, probe)) {
+      throw Exception(ExceptionType::NOT_IMPLEMENTED, "index joins need a B+ tree index");
+    }
+  }
+}
+
+void NestIndexJoinExecutor::Join(const Tuple &outer_tuple, const TableMetadata *inner_table, RID inner_rid) {
+  auto predicate = plan_->Predicate();
+  auto outer_schema = plan_->OuterTableSchema();
+  auto inner_schema = plan_->InnerTableSchema();
+  Tuple inner_tuple;
+  if (!inner_table->table_->GetTuple(inner_rid, &inner_tuple, exec_ctx_->GetTransaction())) {
+    return;
+  }
+  if (nullptr == predicate
+        || predicate->EvaluateJoin(&outer_tuple, outer_schema, &inner_tuple, inner_schema).GetAs<bool>()) {
+    std::vector<Value> output;
+    for (const auto & column : plan_->OutputSchema()->GetColumns()) {
+      output.push_back(column.GetExpr()->EvaluateJoin(&outer_tuple, outer_schema, &inner_tuple, inner_schema));
+    }
+    join_result_.emplace_back(Tuple(output, plan_->OutputSchema()));
   }
 }
 
@@ -8,7 +8,9 @@
 
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/schema.h"
+#include "storage/index/art_index.h"
 #include "storage/index/b_plus_tree_index.h"
+#include "storage/index/bw_tree_index.h"
 #include "storage/index/index.h"
 #include "storage/table/table_heap.h"
 
@@ -33,6 +35,16 @@ struct TableMetadata {
   table_oid_t oid_;
 };
 
+/** The structures an index can be built on. */
+enum class IndexType {
+  // B+ tree with latch crabbing, supports every index scan
+  BPLUS_TREE = 0,
+  // latch-free Bw-tree, for indexes under heavy concurrent updates, supports point lookups only
+  BW_TREE,
+  // in-memory adaptive radix tree on normalized keys, for the point and short range lookups of hot tables
+  ART
+};
+
 /**
  * Metadata about a index
  */
@@ -110,17 +122,43 @@ class Catalog {
    * @param key_schema the schema of the key
    * @param key_attrs key attributes
    * @param keysize size of the key
+   * @param unique whether a key maps to a single tuple, an index on a column with duplicate values must not be
+   * @param included_attrs columns stored in the index entries after the key columns, so that queries that only need
+   * the key and these columns are answered from the index alone (see IndexOnlyScanPlanNode)
+   * @param index_type the structure of the index
    * @return a pointer to the metadata of the new table
    */
   template <class KeyType, class ValueType, class KeyComparator>
   IndexInfo *CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
-                         size_t keysize) {
+                         size_t keysize, bool unique = true, const std::vector<uint32_t> &included_attrs = {},
+                         IndexType index_type = IndexType::BPLUS_TREE) {
     BUSTUB_ASSERT(index_names_.count(table_name) == 0, "Table do not exist!");
     BUSTUB_ASSERT(index_names_[table_name].count(index_name) == 0, "Index names should be unique!");
     auto index_oid = next_index_oid_++;
-    auto indexMeta = new IndexMetadata(index_name, table_name, &schema ,key_attrs);
-    auto indexInfo = std::unique_ptr<Index>(new BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>(indexMeta, bpm_));
+    auto indexMeta = new IndexMetadata(index_name, table_name, &schema, key_attrs, included_attrs);
+    auto table = GetTable(table_name)->table_.get();
+    std::unique_ptr<Index> indexInfo;
+    if (IndexType::BW_TREE == index_type || IndexType::ART == index_type) {
+      if (IndexType::BW_TREE == index_type) {
+        indexInfo = std::make_unique<BwTreeIndex<GenericKey<64>, RID, GenericComparator<64>>>(indexMeta, bpm_, unique);
+      } else {
+        // the tree lives in memory only, so it is rebuilt from the table
+        indexInfo = std::make_unique<ArtIndex<GenericKey<64>, RID, GenericComparator<64>>>(indexMeta, unique);
+      }
+      for (auto it = table->Begin(txn); it != table->End(); ++it) {
+        indexInfo->InsertEntry(it->KeyFromTuple(schema, *indexMeta->GetKeySchema(), key_attrs), it->GetRid(), txn);
+      }
+    } else if (1 == key_attrs.size() && included_attrs.empty() &&
+               TypeId::INTEGER == schema.GetColumn(key_attrs[0]).GetType()) {
+      // a single integer key column is kept in IntKey pages, which search their keys with SIMD compares
+      indexInfo = BuildBPlusTreeIndex<IntKey<4>, IntKeyComparator<4>>(indexMeta, unique, table, schema, txn);
+    } else if (1 == key_attrs.size() && included_attrs.empty() &&
+               TypeId::BIGINT == schema.GetColumn(key_attrs[0]).GetType()) {
+      indexInfo = BuildBPlusTreeIndex<IntKey<8>, IntKeyComparator<8>>(indexMeta, unique, table, schema, txn);
+    } else {
+      indexInfo = BuildBPlusTreeIndex<GenericKey<64>, GenericComparator<64>>(indexMeta, unique, table, schema, txn);
+    }
 
     auto index = std::make_unique<IndexInfo>(key_schema, index_name, std::move(indexInfo), index_oid, table_name, keysize);
     index_names_[table_name][index_name] =  index_oid;
@@ -128,6 +166,26 @@ class Catalog {
     return indexes_[index_oid].get();
   }
 
+  /**
+   * Call a visitor with a B+ tree index cast to the instantiation that CreateIndex() built it as: IntKey for a single
+   * INTEGER or BIGINT key column, GenericKey<64> otherwise.
+   * @param visitor a callable taking a pointer to any of these instantiations
+   * @return false if the index is not a B+ tree index
+   */
+  template <class Visitor>
+  static bool VisitBPlusTreeIndex(Index *index, Visitor &&visitor) {
+    if (auto int_tree = dynamic_cast<BPlusTreeIndex<IntKey<4>, RID, IntKeyComparator<4>> *>(index)) {
+      visitor(int_tree);
+    } else if (auto bigint_tree = dynamic_cast<BPlusTreeIndex<IntKey<8>, RID, IntKeyComparator<8>> *>(index)) {
+      visitor(bigint_tree);
+    } else if (auto tree = dynamic_cast<BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>> *>(index)) {
+      visitor(tree);
+    } else {
+      return false;
+    }
+    return true;
+  }
+
   IndexInfo *GetIndex(const std::string &index_name, const std::string &table_name) {
     if (index_names_.count(table_name) == 0) {
       return nullptr;
@@ -154,6 +212,15 @@ class Catalog {
   }
 
  private:
+  /** Build a B+ tree index bottom-up from the sorted keys of the existing tuples, scanned in parallel. */
+  template <class KeyType, class KeyComparator>
+  std::unique_ptr<Index> BuildBPlusTreeIndex(IndexMetadata *index_meta, bool unique, TableHeap *table,
+                                             const Schema &schema, Transaction *txn) {
+    auto tree = std::make_unique<BPlusTreeIndex<KeyType, RID, KeyComparator>>(index_meta, bpm_, unique);
+    tree->BulkLoad(table, schema, txn);
+    return tree;
+  }
+
   [[maybe_unused]] BufferPoolManager *bpm_;
   [[maybe_unused]] LockManager *lock_manager_;
   [[maybe_unused]] LogManager *log_manager_;
@@ -35,6 +35,8 @@ static constexpr int PAGE_SIZE = 4096;                                        //
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int READ_AHEAD_PAGES = 8;                                    // pages read at once for sequential I/O
+static constexpr int INDEX_JOIN_BATCH_SIZE = 128;                             // outer tuples per index join lookup
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
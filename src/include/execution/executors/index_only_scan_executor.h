@@ -0,0 +1,55 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// index_only_scan_executor.h
+//
+// Identification: src/include/execution/executors/index_only_scan_executor.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "common/rid.h"
+#include "execution/executor_context.h"
+#include "execution/executors/abstract_executor.h"
+#include "execution/plans/index_only_scan_plan.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * IndexOnlyScanExecutor executes an index scan that answers a query from the index entries alone.
+ */
+class IndexOnlyScanExecutor : public AbstractExecutor {
+ public:
+  /**
+   * Creates a new index-only scan executor.
+   * @param exec_ctx the executor context
+   * @param plan the index-only scan plan to be executed
+   */
+  IndexOnlyScanExecutor(ExecutorContext *exec_ctx, const IndexOnlyScanPlanNode *plan);
+
+  const Schema *GetOutputSchema() override { return plan_->OutputSchema(); };
+
+  void Init() override;
+
+  bool Next(Tuple *tuple, RID *rid) override;
+
+ private:
+  /** The index-only scan plan node to be executed. */
+  const IndexOnlyScanPlanNode *plan_;
+  const IndexInfo *index_info_;
+  const TableMetadata *table_meta_;
+  /** For each column of the table, its column in the index key, or -1 if the index does not hold it. */
+  std::vector<int> key_columns_;
+  /**
+   * Produces the next index entry in the scanned range, as the table tuple as far as the index holds it and the RID,
+   * or returns false at the end of the range.
+   */
+  std::function<bool(Tuple *, RID *)> next_entry_;
+};
+}  // namespace bustub
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <functional>
 #include <vector>
 
 #include "common/rid.h"
@@ -47,7 +48,7 @@ class IndexScanExecutor : public AbstractExecutor {
   const std::unique_ptr<Index> table_;
   const IndexInfo*  indexInfo_;
   const TableMetadata* table_meta_;
-  BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>* bPlusTreeIndex;
-  IndexIterator<GenericKey<64>, RID, GenericComparator<64>> indexIter;
+  /** Produces the RID of the next index entry in the scanned range, or returns false at its end. */
+  std::function<bool(RID *)> next_rid_;
 };
 }  // namespace bustub
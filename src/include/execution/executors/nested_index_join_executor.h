@@ -18,6 +18,7 @@
 #include <utility>
 #include <vector>
 
+#include "catalog/catalog.h"
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
 #include "execution/expressions/abstract_expression.h"
@@ -48,6 +49,9 @@ class NestIndexJoinExecutor : public AbstractExecutor {
   bool Next(Tuple *tuple, RID *rid) override;
 
  private:
+  /** Add the join of an outer tuple with the inner tuple at the RID an index lookup found, if the predicate holds. */
+  void Join(const Tuple &outer_tuple, const TableMetadata *inner_table, RID inner_rid);
+
   /** The nested index join plan node. */
   const NestedIndexJoinPlanNode *plan_;
 
@@ -34,6 +34,8 @@ class ComparisonExpression : public AbstractExpression {
   ComparisonExpression(const AbstractExpression *left, const AbstractExpression *right, ComparisonType comp_type)
       : AbstractExpression({left, right}, TypeId::BOOLEAN), comp_type_{comp_type} {}
 
+  ComparisonType GetComparisonType() const { return comp_type_; }
+
   Value Evaluate(const Tuple *tuple, const Schema *schema) const override {
     Value lhs = GetChildAt(0)->Evaluate(tuple, schema);
     Value rhs = GetChildAt(1)->Evaluate(tuple, schema);
@@ -0,0 +1,28 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// index_only_scan_plan.h
+//
+// Identification: src/include/execution/plans/index_only_scan_plan.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "execution/plans/index_scan_plan.h"
+
+namespace bustub {
+/**
+ * IndexOnlyScanPlanNode is an index scan that reads no table tuples: the tuples are built from the index entries,
+ * from their key and included columns. The output schema may only refer to columns the index holds, and columns of
+ * the table it does not hold read as NULL. The predicate is evaluated on the output tuples.
+ */
+class IndexOnlyScanPlanNode : public IndexScanPlanNode {
+ public:
+  using IndexScanPlanNode::IndexScanPlanNode;
+
+  PlanType GetType() const override { return PlanType::IndexOnlyScan; }
+};
+
+}  // namespace bustub
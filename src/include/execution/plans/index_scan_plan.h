@@ -18,7 +18,8 @@
 
 namespace bustub {
 /**
- * IndexScanPlanNode identifies a table that should be scanned with an optional predicate.
+ * IndexScanPlanNode identifies a table that should be scanned with an optional predicate, through an index and
+ * optionally only for a range of its keys, in key order or in reverse key order.
  */
 class IndexScanPlanNode : public AbstractPlanNode {
  public:
@@ -27,10 +28,26 @@ class IndexScanPlanNode : public AbstractPlanNode {
    * @param output the output format of this scan plan node
    * @param predicate the predicate to scan with, tuples are returned if predicate(tuple) == true or predicate ==
    * nullptr
-   * @param table_oid the identifier of table to be scanned
+   * @param index_oid the identifier of the index to scan the table with
+   * @param low_key the low bound of the keys to scan, a tuple of the key schema of the index, nullptr for none
+   * @param low_inclusive whether the key equal to the low bound is scanned
+   * @param high_key the high bound of the keys to scan, nullptr for none
+   * @param high_inclusive whether the key equal to the high bound is scanned
+   * @param reverse whether to scan from the high end of the range down
    */
-  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid)
-      : AbstractPlanNode(output, {}), predicate_{predicate}, index_oid_(index_oid) {}
+  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid,
+                    const Tuple *low_key = nullptr, bool low_inclusive = true, const Tuple *high_key = nullptr,
+                    bool high_inclusive = true, bool reverse = false)
+      : AbstractPlanNode(output, {}),
+        predicate_{predicate},
+        index_oid_(index_oid),
+        has_low_key_(nullptr != low_key),
+        low_key_(nullptr == low_key ? Tuple() : *low_key),
+        low_inclusive_(low_inclusive),
+        has_high_key_(nullptr != high_key),
+        high_key_(nullptr == high_key ? Tuple() : *high_key),
+        high_inclusive_(high_inclusive),
+        reverse_(reverse) {}
 
   PlanType GetType() const override { return PlanType::IndexScan; }
 
@@ -40,11 +57,35 @@ class IndexScanPlanNode : public AbstractPlanNode {
   /** @return the identifier of the table that should be scanned */
   index_oid_t GetIndexOid() const { return index_oid_; }
 
+  /** @return the low bound of the keys to scan, nullptr if there is none */
+  const Tuple *GetLowKey() const { return has_low_key_ ? &low_key_ : nullptr; }
+
+  /** @return whether the key equal to the low bound is scanned */
+  bool IsLowInclusive() const { return low_inclusive_; }
+
+  /** @return the high bound of the keys to scan, nullptr if there is none */
+  const Tuple *GetHighKey() const { return has_high_key_ ? &high_key_ : nullptr; }
+
+  /** @return whether the key equal to the high bound is scanned */
+  bool IsHighInclusive() const { return high_inclusive_; }
+
+  /** @return whether the keys are scanned from the high end of the range down */
+  bool IsReverse() const { return reverse_; }
+
  private:
   /** The predicate that all returned tuples must satisfy. */
   const AbstractExpression *predicate_;
   /** The table whose tuples should be scanned. */
   index_oid_t index_oid_;
+  /** The bounds of the keys to scan. */
+  bool has_low_key_;
+  Tuple low_key_;
+  bool low_inclusive_;
+  bool has_high_key_;
+  Tuple high_key_;
+  bool high_inclusive_;
+  /** Whether to scan in reverse key order. */
+  bool reverse_;
 };
 
 }  // namespace bustub
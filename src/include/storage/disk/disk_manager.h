@@ -15,15 +15,28 @@
 #include <atomic>
 #include <fstream>
 #include <future>  // NOLINT
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "common/config.h"
+#include "common/rwlatch.h"
+#include "storage/disk/disk_stats.h"
+#include "storage/disk/tablespace.h"
 
 namespace bustub {
 
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * By default every page lives in the single database file. Additional tablespaces can route ranges of page ids to
+ * other files (possibly on other devices), see AddTablespace().
+ *
+ * The page and log I/O and file layout methods are virtual, so that other storage backends can stand in for the
+ * file system, e.g.
+ * MemoryDiskManager and SimulatedDiskManager for reproducible benchmarks.
  */
 class DiskManager {
  public:
@@ -33,33 +46,41 @@ class DiskManager {
    */
   explicit DiskManager(const std::string &db_file);
 
-  ~DiskManager() = default;
+  virtual ~DiskManager() = default;
 
   /**
    * Shut down the disk manager and close all the file resources.
    */
-  void ShutDown();
+  virtual void ShutDown();
 
   /**
    * Write a page to the database file.
    * @param page_id id of the page
    * @param page_data raw page data
    */
-  void WritePage(page_id_t page_id, const char *page_data);
+  virtual void WritePage(page_id_t page_id, const char *page_data);
 
   /**
    * Read a page from the database file.
    * @param page_id id of the page
    * @param[out] page_data output buffer
    */
-  void ReadPage(page_id_t page_id, char *page_data);
+  virtual void ReadPage(page_id_t page_id, char *page_data);
+
+  /**
+   * Hint that the pages [page_id, page_id + num_pages) are about to be read in order, e.g. by a scan. The backend may
+   * start reading them ahead; it is never required to.
+   * @param page_id first page that will be read
+   * @param num_pages number of pages that will be read
+   */
+  virtual void Prefetch(page_id_t page_id, int num_pages);
 
   /**
    * Flush the entire log buffer into disk.
    * @param log_data raw log data
    * @param size size of log entry
    */
-  void WriteLog(char *log_data, int size);
+  virtual void WriteLog(char *log_data, int size);
 
   /**
    * Read a log entry from the log file.
@@ -68,19 +89,35 @@ class DiskManager {
    * @param offset offset of the log entry in the file
    * @return true if the read was successful, false otherwise
    */
-  bool ReadLog(char *log_data, int size, int offset);
+  virtual bool ReadLog(char *log_data, int size, int offset);
 
   /**
    * Allocate a page on disk.
    * @return the id of the allocated page
    */
-  page_id_t AllocatePage();
+  virtual page_id_t AllocatePage();
 
   /**
    * Deallocate a page on disk.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(page_id_t page_id);
+  virtual void DeallocatePage(page_id_t page_id);
+
+  /**
+   * Route the pages [start_page_id, end_page_id) to their own tablespace, striped across the given files.
+   * Must be called before any page of the range is written, and the range must not overlap an existing tablespace.
+   * @param start_page_id first page id of the range
+   * @param end_page_id one past the last page id of the range
+   * @param file_names the files the range is striped across
+   */
+  virtual void AddTablespace(page_id_t start_page_id, page_id_t end_page_id,
+                             const std::vector<std::string> &file_names);
+
+  /**
+   * Set how many pages are read at once once a file sees an ascending read stream, for all tablespaces.
+   * @param read_ahead_pages the read-ahead window in pages, 1 disables read-ahead
+   */
+  virtual void SetReadAheadPages(int read_ahead_pages);
 
   /** @return the number of disk flushes */
   int GetNumFlushes() const;
@@ -91,6 +128,12 @@ class DiskManager {
   /** @return the number of disk writes */
   int GetNumWrites() const;
 
+  /** @return a snapshot of the page and log I/O counters and latencies of this disk manager */
+  DiskStatsSnapshot GetStats() const { return stats_.GetSnapshot(); }
+
+  /** @return file name -> snapshot of the page I/O counters and latencies of that file */
+  std::map<std::string, DiskStatsSnapshot> GetFileStats();
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -100,19 +143,30 @@ class DiskManager {
   /** Checks if the non-blocking flush future was set. */
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
+ protected:
+  /**
+   * Creates a disk manager that opens no files, for backends that keep their pages elsewhere.
+   */
+  DiskManager();
+
+  DiskStats stats_;
+  std::atomic<bool> flush_log_;
+  std::future<void> *flush_log_f_;
+
  private:
   int GetFileSize(const std::string &file_name);
+  Tablespace *GetTablespace(page_id_t page_id);
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  // the db file, serving every page not covered by another tablespace
+  std::unique_ptr<Tablespace> default_tablespace_;
   std::string file_name_;
+  // start page id -> tablespace, protected by tablespace_latch_
+  std::map<page_id_t, std::unique_ptr<Tablespace>> tablespaces_;
+  ReaderWriterLatch tablespace_latch_;
+  int read_ahead_pages_{READ_AHEAD_PAGES};
   std::atomic<page_id_t> next_page_id_;
-  int num_flushes_;
-  int num_writes_;
-  bool flush_log_;
-  std::future<void> *flush_log_f_;
 };
 
 }  // namespace bustub
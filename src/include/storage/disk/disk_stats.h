@@ -0,0 +1,135 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_stats.h
+//
+// Identification: src/include/storage/disk/disk_stats.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <string>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/** Number of buckets of a latency histogram. Bucket i holds latencies in [2^(i-1), 2^i) microseconds. */
+static constexpr size_t LATENCY_HISTOGRAM_BUCKETS = 24;
+
+/**
+ * A point-in-time copy of a LatencyHistogram.
+ */
+struct LatencyHistogramSnapshot {
+  std::array<uint64_t, LATENCY_HISTOGRAM_BUCKETS> buckets_{};
+  uint64_t count_{0};
+  uint64_t total_ns_{0};
+
+  /** @return the mean latency in microseconds, 0 if nothing was recorded */
+  double MeanMicros() const { return count_ == 0 ? 0 : static_cast<double>(total_ns_) / count_ / 1000; }
+
+  /**
+   * @param fraction the percentile to compute, in [0, 1]
+   * @return an upper bound of the given percentile in microseconds (the upper edge of its bucket)
+   */
+  uint64_t PercentileMicros(double fraction) const;
+};
+
+/**
+ * Lock-free histogram of operation latencies with logarithmic buckets.
+ */
+class LatencyHistogram {
+ public:
+  void Record(std::chrono::nanoseconds latency);
+
+  LatencyHistogramSnapshot GetSnapshot() const;
+
+ private:
+  std::array<std::atomic<uint64_t>, LATENCY_HISTOGRAM_BUCKETS> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> total_ns_{0};
+};
+
+/**
+ * A point-in-time copy of the counters of a DiskStats.
+ */
+struct DiskStatsSnapshot {
+  uint64_t pages_read_{0};
+  uint64_t pages_written_{0};
+  uint64_t bytes_read_{0};
+  uint64_t bytes_written_{0};
+  uint64_t log_bytes_written_{0};
+  uint64_t log_flushes_{0};
+  /** Reads of the page right after the previously read page. */
+  uint64_t sequential_reads_{0};
+  uint64_t random_reads_{0};
+  /** Writes of the page right after the previously written page. */
+  uint64_t sequential_writes_{0};
+  uint64_t random_writes_{0};
+  /** Larger reads issued to fill a read-ahead buffer, and the pages they staged. */
+  uint64_t read_ahead_ios_{0};
+  uint64_t read_ahead_pages_{0};
+  /** Page reads served from a read-ahead buffer without I/O. */
+  uint64_t read_ahead_hits_{0};
+  LatencyHistogramSnapshot read_latency_;
+  LatencyHistogramSnapshot write_latency_;
+  LatencyHistogramSnapshot log_latency_;
+
+  /** @return a human readable summary */
+  std::string ToString() const;
+};
+
+/**
+ * DiskStats counts the page and log I/O of a disk manager (or of one of its files) and records its latencies.
+ * All counters are atomic, so recording never takes a latch.
+ */
+class DiskStats {
+ public:
+  /**
+   * Count a page read, sequential if it reads the page after the one read before.
+   * @param page_id the page id, or the page offset within the file for the stats of one file
+   * @param latency how long the read took
+   */
+  void RecordRead(page_id_t page_id, std::chrono::nanoseconds latency);
+
+  /** Count a page write, see RecordRead(). */
+  void RecordWrite(page_id_t page_id, std::chrono::nanoseconds latency);
+
+  void RecordLogWrite(int size, std::chrono::nanoseconds latency);
+
+  void RecordReadAheadIO(size_t num_pages);
+
+  void RecordReadAheadHit();
+
+  DiskStatsSnapshot GetSnapshot() const;
+
+  inline uint64_t GetPagesWritten() const { return pages_written_; }
+
+  inline uint64_t GetLogFlushes() const { return log_flushes_; }
+
+ private:
+  std::atomic<uint64_t> pages_read_{0};
+  std::atomic<uint64_t> pages_written_{0};
+  std::atomic<uint64_t> log_bytes_written_{0};
+  std::atomic<uint64_t> log_flushes_{0};
+  std::atomic<uint64_t> sequential_reads_{0};
+  std::atomic<uint64_t> sequential_writes_{0};
+  std::atomic<uint64_t> read_ahead_ios_{0};
+  std::atomic<uint64_t> read_ahead_pages_{0};
+  std::atomic<uint64_t> read_ahead_hits_{0};
+  std::atomic<page_id_t> last_read_page_id_{INVALID_PAGE_ID};
+  std::atomic<page_id_t> last_written_page_id_{INVALID_PAGE_ID};
+  LatencyHistogram read_latency_;
+  LatencyHistogram write_latency_;
+  LatencyHistogram log_latency_;
+};
+
+}  // namespace bustub
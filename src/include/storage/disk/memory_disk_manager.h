@@ -0,0 +1,68 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// memory_disk_manager.h
+//
+// Identification: src/include/storage/disk/memory_disk_manager.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * MemoryDiskManager keeps every page and the log in memory instead of on disk. Nothing survives the process, but
+ * page I/O costs a hash lookup and a memcpy, which makes buffer pool and index benchmarks independent of the file
+ * system and the page cache.
+ */
+class MemoryDiskManager : public DiskManager {
+ public:
+  MemoryDiskManager() = default;
+
+  ~MemoryDiskManager() override = default;
+
+  void ShutDown() override {}
+
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /** Pages that were never written read back as all zeroes. */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /** Reads are served from memory, there is nothing to read ahead. */
+  void Prefetch(page_id_t page_id, int num_pages) override {}
+
+  /** Every page stays in memory, there are no files to route pages to. */
+  void AddTablespace(page_id_t start_page_id, page_id_t end_page_id,
+                     const std::vector<std::string> &file_names) override {}
+
+  void SetReadAheadPages(int read_ahead_pages) override {}
+
+  void WriteLog(char *log_data, int size) override;
+
+  bool ReadLog(char *log_data, int size, int offset) override;
+
+  /** @return the number of pages currently stored */
+  size_t GetNumPages();
+
+ private:
+  using PageData = std::array<char, PAGE_SIZE>;
+
+  std::mutex latch_;
+  std::unordered_map<page_id_t, std::unique_ptr<PageData>> pages_;
+  std::vector<char> log_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,97 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// simulated_disk_manager.h
+//
+// Identification: src/include/storage/disk/simulated_disk_manager.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * The performance characteristics of a simulated storage device.
+ */
+struct DeviceProfile {
+  /** Fixed cost of every page read. */
+  std::chrono::microseconds read_latency_{0};
+  /** Fixed cost of every page or log write. */
+  std::chrono::microseconds write_latency_{0};
+  /** Transfer rate shared by all requests, in bytes per second. 0 means unlimited. */
+  uint64_t bandwidth_{0};
+
+  /** @return a profile resembling a SATA SSD */
+  static DeviceProfile SSD() { return {std::chrono::microseconds(100), std::chrono::microseconds(30), 500UL << 20U}; }
+
+  /** @return a profile resembling a 7200 rpm hard disk */
+  static DeviceProfile HDD() {
+    return {std::chrono::microseconds(8000), std::chrono::microseconds(8000), 150UL << 20U};
+  }
+};
+
+/**
+ * SimulatedDiskManager wraps another disk manager (usually a MemoryDiskManager) and delays every request as if it
+ * were served by a device with the given profile.
+ *
+ * Latencies of concurrent requests overlap, as on a device with a deep queue, but data transfers are serialized on
+ * one channel of the configured bandwidth.
+ */
+class SimulatedDiskManager : public DiskManager {
+ public:
+  /**
+   * @param device the disk manager that actually stores the pages, not owned
+   * @param profile the latency and bandwidth to simulate
+   */
+  SimulatedDiskManager(DiskManager *device, const DeviceProfile &profile) : device_(device), profile_(profile) {}
+
+  ~SimulatedDiskManager() override = default;
+
+  void ShutDown() override { device_->ShutDown(); }
+
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  void Prefetch(page_id_t page_id, int num_pages) override { device_->Prefetch(page_id, num_pages); }
+
+  void AddTablespace(page_id_t start_page_id, page_id_t end_page_id,
+                     const std::vector<std::string> &file_names) override {
+    device_->AddTablespace(start_page_id, end_page_id, file_names);
+  }
+
+  void SetReadAheadPages(int read_ahead_pages) override { device_->SetReadAheadPages(read_ahead_pages); }
+
+  void WriteLog(char *log_data, int size) override;
+
+  bool ReadLog(char *log_data, int size, int offset) override;
+
+  page_id_t AllocatePage() override { return device_->AllocatePage(); }
+
+  void DeallocatePage(page_id_t page_id) override { device_->DeallocatePage(page_id); }
+
+ private:
+  /** Block the caller until a request of the given size and latency would have completed. */
+  void Delay(std::chrono::microseconds latency, uint64_t bytes);
+
+  DiskManager *device_;
+  DeviceProfile profile_;
+  /** Serializes the transfer channel. */
+  std::mutex channel_latch_;
+  /** When the transfer channel finishes its last queued transfer. */
+  std::chrono::steady_clock::time_point channel_free_at_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,141 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tablespace.h
+//
+// Identification: src/include/storage/disk/tablespace.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "storage/disk/disk_stats.h"
+
+namespace bustub {
+
+/**
+ * Tablespace maps a contiguous range of page ids [start_page_id, end_page_id) onto one or more database files.
+ * When a tablespace has several files, its pages are striped across them round-robin, so that page
+ * start_page_id + i lives in file (i % n) at page offset (i / n). Putting the files on different devices lets
+ * reads and writes of neighbouring pages proceed in parallel.
+ *
+ * Every file has its own stream and latch, so I/O against different files never serializes.
+ *
+ * Each file also detects ascending read streams: once a read continues right after the previous one, the file reads
+ * the next read_ahead_pages pages in one larger I/O and stages them in a small buffer that serves the following
+ * ReadPage calls without touching the file.
+ */
+class Tablespace {
+ public:
+  /**
+   * Creates a new tablespace, opening (or creating) all of its files.
+   * @param start_page_id first page id served by this tablespace
+   * @param end_page_id one past the last page id served by this tablespace
+   * @param file_names the files the pages are striped across, in stripe order
+   */
+  Tablespace(page_id_t start_page_id, page_id_t end_page_id, const std::vector<std::string> &file_names);
+
+  ~Tablespace() { ShutDown(); }
+
+  /** @return true if the page belongs to this tablespace */
+  inline bool Contains(page_id_t page_id) const { return start_page_id_ <= page_id && page_id < end_page_id_; }
+
+  /**
+   * Write a page to the file it is striped onto.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   */
+  void WritePage(page_id_t page_id, const char *page_data);
+
+  /**
+   * Read a page from the file it is striped onto, or from its read-ahead buffer. Pages beyond the end of the file
+   * are left untouched.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer
+   */
+  void ReadPage(page_id_t page_id, char *page_data);
+
+  /**
+   * Hint that the pages [page_id, page_id + num_pages) are about to be read in order. Stages (up to the read-ahead
+   * window of) them in the read-ahead buffers right away.
+   * @param page_id first page that will be read
+   * @param num_pages number of pages that will be read
+   */
+  void Prefetch(page_id_t page_id, int num_pages);
+
+  /** @param read_ahead_pages number of pages read at once for sequential streams, 1 disables read-ahead */
+  inline void SetReadAheadPages(int read_ahead_pages) { read_ahead_pages_ = std::max(read_ahead_pages, 1); }
+
+  /** Close all the files of this tablespace. */
+  void ShutDown();
+
+  /** @return the first page id served by this tablespace */
+  inline page_id_t GetStartPageId() const { return start_page_id_; }
+
+  /** @return one past the last page id served by this tablespace */
+  inline page_id_t GetEndPageId() const { return end_page_id_; }
+
+  /** @return the number of files the pages are striped across */
+  inline size_t GetNumFiles() const { return files_.size(); }
+
+  /** @return the name of the i-th file of this tablespace */
+  inline const std::string &GetFileName(size_t i) const { return files_[i]->name_; }
+
+  /** @return the I/O statistics of the i-th file of this tablespace */
+  inline DiskStatsSnapshot GetFileStats(size_t i) const { return files_[i]->stats_.GetSnapshot(); }
+
+ private:
+  /** One file of the tablespace, with the latch that serializes its stream. */
+  struct DataFile {
+    std::string name_;
+    std::fstream io_;
+    std::mutex latch_;
+    DiskStats stats_;
+    /** Staged copies of the file pages [read_ahead_start_, read_ahead_start_ + read_ahead_count_). */
+    std::vector<char> read_ahead_;
+    size_t read_ahead_start_{0};
+    size_t read_ahead_count_{0};
+    /** The file page that continues the current ascending read stream. */
+    size_t next_read_page_{SIZE_MAX};
+  };
+
+  /**
+   * Find the file holding a page, and the byte offset of the page inside that file.
+   * @param page_id id of the page
+   * @param[out] offset byte offset of the page within the returned file
+   * @return the file the page is striped onto
+   */
+  DataFile *Locate(page_id_t page_id, size_t *offset) const;
+
+  /**
+   * Replace the read-ahead buffer of a file with the pages starting at file_page, in one read.
+   * @return the number of pages staged
+   */
+  size_t ReadAhead(DataFile *file, size_t file_page, size_t num_pages);
+
+  /**
+   * Read consecutive pages of a file. The last page is zero-filled if the file ends inside it.
+   * @return the number of pages read
+   */
+  size_t ReadFromFile(DataFile *file, size_t offset, char *data, size_t num_pages);
+
+  page_id_t start_page_id_;
+  page_id_t end_page_id_;
+  // set by the disk manager while pages are read, which take no tablespace-wide latch
+  std::atomic<int> read_ahead_pages_{READ_AHEAD_PAGES};
+  std::vector<std::unique_ptr<DataFile>> files_;
+};
+
+}  // namespace bustub
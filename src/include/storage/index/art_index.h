@@ -0,0 +1,52 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// art_index.h
+//
+// Identification: src/include/storage/index/art_index.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+#include "storage/index/art_tree.h"
+#include "storage/index/index.h"
+
+namespace bustub {
+
+#define ART_INDEX_TYPE ArtIndex<KeyType, ValueType, KeyComparator>
+
+/**
+ * Index on an in-memory adaptive radix tree (see ArtTree), for the hot tables whose point and short range lookups
+ * must not pay for the buffer pool. The tree is not persisted: it is built from the table when the index is created.
+ * The key schema must be one that normalizes (see GenericKey::CanNormalize()).
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class ArtIndex : public Index {
+ public:
+  /** @param unique whether a key maps to a single RID, otherwise an entry is only a duplicate if its RID is too */
+  explicit ArtIndex(IndexMetadata *metadata, bool unique = true);
+
+  void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
+
+  /** Read the RIDs of the keys from low_key to high_key in key order, both included, and nullptr for no bound. */
+  void ScanRange(const Tuple *low_key, const Tuple *high_key, std::vector<RID> *result);
+
+  /** Build the normalized index key of a key tuple. */
+  KeyType MakeIndexKey(const Tuple &key) const;
+
+ protected:
+  // comparator for key
+  KeyComparator comparator_;
+  // container
+  ArtTree<KeyType, ValueType, KeyComparator> container_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,185 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// art_tree.h
+//
+// Identification: src/include/storage/index/art_tree.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "storage/index/epoch_manager.h"
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+#define ARTTREE_TYPE ArtTree<KeyType, ValueType, KeyComparator>
+
+/**
+ * In-memory adaptive radix tree (ART), after Leis et al., over the bytes of normalized keys.
+ *
+ * Keys set by SetNormalizedFromKey() compare byte by byte, so the tree branches on one key byte per level, in nodes
+ * of 4, 16, 48 or 256 children that grow as children are added. A node stores the bytes all keys below it share as
+ * its prefix, and a key whose bytes no other key shares ends in a leaf right away. All keys have the same length,
+ * the normalized size of the key schema, so no key is the prefix of another.
+ *
+ * Nodes are synchronized by optimistic lock coupling: readers never write to shared memory, they read a node, then
+ * check that its version did not change meanwhile, and restart otherwise. Writers lock only the nodes they change,
+ * by upgrading the version they read. Leaves are immutable, a new value replaces the leaf of its key. Replaced
+ * leaves and grown nodes are freed by epoch-based reclamation (see EpochManager). Nodes are not shrunk when their
+ * children are removed.
+ *
+ * A unique tree maps a key to a single value, a non-unique tree keeps every distinct value of a key. The tree lives in
+ * memory only, nothing goes through the buffer pool.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class ArtTree {
+ public:
+  /** @param comparator comparator of normalized keys, the keys are compared as the bytes of its KeyLength() */
+  explicit ArtTree(std::string name, const KeyComparator &comparator, bool unique = true);
+
+  ~ArtTree();
+
+  ArtTree(const ArtTree &) = delete;
+  ArtTree &operator=(const ArtTree &) = delete;
+
+  // Insert a key-value pair, false if the key (or for a non-unique tree, the pair) is already in the tree.
+  bool Insert(const KeyType &key, const ValueType &value);
+
+  // Remove a key and its values.
+  void Remove(const KeyType &key);
+
+  // Remove a value of a key.
+  void Remove(const KeyType &key, const ValueType &value);
+
+  // Return the values associated with a given key.
+  bool GetValue(const KeyType &key, std::vector<ValueType> *result);
+
+  /**
+   * Read the entries with keys from low_key to high_key in key order, both included, and nullptr for no bound. The
+   * scan is not atomic: it sees each node as it is when the scan reaches it.
+   * The children of a node are prefetched together, so a short range costs about a point lookup plus one round of
+   * overlapping cache misses for its leaves.
+   */
+  void Scan(const KeyType *low_key, const KeyType *high_key, std::vector<MappingType> *result);
+
+ private:
+  enum class NodeType : uint8_t { NODE4, NODE16, NODE48, NODE256, LEAF };
+
+  /**
+   * Inner node or leaf. The version of an inner node counts its changes, with bit LOCKED set while a writer holds it
+   * and bit OBSOLETE once it is replaced. Everything a reader reads of an inner node is atomic, since a writer may
+   * change it meanwhile.
+   */
+  struct Node : public EpochGarbage {
+    explicit Node(NodeType type) : type_(type) {}
+    const NodeType type_;
+    std::atomic<uint64_t> version_{0};
+    std::atomic<uint16_t> count_{0};
+    std::atomic<uint32_t> prefix_length_{0};
+    std::atomic<uint8_t> prefix_[sizeof(KeyType)]{};
+  };
+
+  // the children of NODE4 and NODE16 are sorted by their key byte
+  template <NodeType Type, int Capacity>
+  struct SortedNode : public Node {
+    SortedNode() : Node(Type) {}
+    static constexpr int CAPACITY = Capacity;
+    std::atomic<uint8_t> keys_[Capacity]{};
+    std::atomic<Node *> children_[Capacity]{};
+  };
+  using Node4 = SortedNode<NodeType::NODE4, 4>;
+  using Node16 = SortedNode<NodeType::NODE16, 16>;
+
+  // the child of a key byte is at child_index_ - 1, 0 for no child
+  struct Node48 : public Node {
+    Node48() : Node(NodeType::NODE48) {}
+    static constexpr int CAPACITY = 48;
+    std::atomic<uint8_t> child_index_[256]{};
+    std::atomic<Node *> children_[CAPACITY]{};
+  };
+
+  struct Node256 : public Node {
+    Node256() : Node(NodeType::NODE256) {}
+    std::atomic<Node *> children_[256]{};
+  };
+
+  // the values of a leaf follow it in the same allocation (see NewLeaf()), so reading a leaf misses the cache once
+  struct Leaf : public Node {
+    Leaf(const KeyType &key, size_t size) : Node(NodeType::LEAF), key_(key), size_(size) {}
+    static void operator delete(void *leaf) { ::operator delete(leaf); }
+    const ValueType *begin() const { return reinterpret_cast<const ValueType *>(this + 1); }
+    const ValueType *end() const { return begin() + size_; }
+    const KeyType key_;
+    const size_t size_;
+  };
+
+  static constexpr uint64_t OBSOLETE = 1;
+  static constexpr uint64_t LOCKED = 2;
+
+  // wait for a writer to unlock the node, false if the node is obsolete
+  static bool ReadLock(Node *node, uint64_t *version);
+  static bool Validate(Node *node, uint64_t version) { return node->version_ == version; }
+  // lock the node for writing, false if it changed since version was read
+  static bool Upgrade(Node *node, uint64_t version) {
+    return node->version_.compare_exchange_strong(version, version + LOCKED);
+  }
+  static void WriteUnlock(Node *node) { node->version_ += LOCKED; }
+  static void WriteUnlockObsolete(Node *node) { node->version_ += LOCKED + OBSOLETE; }
+
+  uint8_t KeyByte(const KeyType &key, size_t index) const { return static_cast<uint8_t>(key.data_[index]); }
+  // whether two keys are equal in their first key_length_ bytes
+  bool KeysEqual(const KeyType &lhs, const KeyType &rhs) const;
+
+  // the children of a node read at once, kept on the stack so that a scan allocates nothing per node it visits
+  struct Children {
+    int count_{0};
+    uint8_t bytes_[256];
+    Node *nodes_[256];
+  };
+
+  static Node *FindChild(Node *node, uint8_t byte);
+  // the children of a node in key byte order, with key bytes from low to high
+  static void ReadChildren(Node *node, int low, int high, Children *children);
+  static bool IsFull(Node *node);
+  // add a child to a node that is not full, the caller holds the lock of the node
+  static void AddChild(Node *node, uint8_t byte, Node *child);
+  static void ReplaceChild(Node *node, uint8_t byte, Node *child);
+  static void RemoveChild(Node *node, uint8_t byte);
+  static Leaf *NewLeaf(const KeyType &key, const std::vector<ValueType> &values);
+  // a copy of a full node with room for more children
+  static Node *Grow(Node *node);
+  static void CopyPrefix(Node *from, Node *to, uint32_t begin, uint32_t end);
+  static void DeleteTree(Node *node);
+
+  // the attempts of an operation, false when a node changed under it and the operation must restart
+  bool TryInsert(const KeyType &key, const ValueType &value, EpochGuard *guard, bool *inserted);
+  bool TryRemove(const KeyType &key, const ValueType *value, EpochGuard *guard);
+  bool TryGetValue(const KeyType &key, std::vector<ValueType> *result);
+  /**
+   * Scan the subtree of a node at a level, each bound only while the keys of the subtree share their bytes above the
+   * level with it. Leaves whose key is not above after, if set, are skipped.
+   */
+  bool TryScan(Node *node, size_t level, const KeyType *low_key, const KeyType *high_key, const KeyType *after,
+               std::vector<MappingType> *result);
+  // compare the first key_length_ bytes of two keys
+  int CompareKeys(const KeyType &lhs, const KeyType &rhs) const;
+
+  std::string index_name_;
+  bool unique_;
+  // the number of leading key bytes that are set
+  size_t key_length_;
+  // never replaced, and with no prefix
+  Node256 *root_;
+  EpochManager epoch_manager_;
+};
+
+}  // namespace bustub
@@ -10,8 +10,18 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
 #include <queue>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "concurrency/transaction.h"
@@ -24,12 +34,67 @@ namespace bustub {
 #define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, KeyComparator>
 
     enum class Operation { READ = 0, INSERT, DELETE };
+
+/** Page count and fill of one level of a B+ tree. */
+struct BPlusTreeLevelStats {
+  int64_t page_count_{0};
+  // keys of a leaf level, children of an internal level
+  int64_t entry_count_{0};
+  /** The mean fill factor (size / max size) of the pages of the level. */
+  double fill_factor_{0};
+};
+
+/**
+ * Structural statistics of a B+ tree, see BPlusTree::CollectStats().
+ */
+template <typename KeyType>
+struct BPlusTreeStats {
+  /** The number of levels, 0 for an empty tree. */
+  int height_{0};
+  /** The levels from the root down to the leaves. */
+  std::vector<BPlusTreeLevelStats> levels_;
+  /** Leaf-chain links to a page with a lower page id than their leaf, which a range scan reads out of order. */
+  int64_t out_of_order_leaf_links_{0};
+  /**
+   * The first key of every key_sample_stride_-th leaf, in key order: the leaves between two samples hold about the
+   * same number of keys, so the samples bound about equally populated key ranges.
+   */
+  std::vector<KeyType> key_samples_;
+  int64_t key_sample_stride_{1};
+
+  /** @return the number of pages of all levels, not counting posting pages */
+  int64_t PageCount() const {
+    int64_t page_count = 0;
+    for (const auto &level : levels_) {
+      page_count += level.page_count_;
+    }
+    return page_count;
+  }
+
+  /** @return the fraction of the leaf-chain links that are out of order, 0 for a tree of a single leaf */
+  double LeafFragmentation() const {
+    int64_t links = levels_.empty() ? 0 : levels_.back().page_count_ - 1;
+    return links <= 0 ? 0 : static_cast<double>(out_of_order_leaf_links_) / links;
+  }
+};
+
+/** Lookups and hits of the adaptive hash index of a B+ tree, see BPlusTree::SetAdaptiveHashIndex(). */
+struct BPlusTreeAdaptiveHashStats {
+  /** The GetValue() calls since the adaptive hash index was enabled. */
+  int64_t lookups_{0};
+  /** The lookups answered from the leaf of a hash entry, without a descent from the root. */
+  int64_t hits_{0};
+
+  /** @return the fraction of the lookups that hit, 0 without lookups */
+  double HitRate() const { return 0 == lookups_ ? 0 : static_cast<double>(hits_) / lookups_; }
+};
+
 /**
  * Main class providing the API for the Interactive B+ Tree.
  *
  * Implementation of simple b+ tree data structure where internal pages direct
  * the search and leaf pages contain actual data.
- * (1) We only support unique key
+ * (1) Keys are unique, unless the tree is created non-unique: then a key maps to the posting list of its values
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
@@ -41,33 +106,117 @@ class BPlusTree {
 
  public:
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE,
+                     bool unique = true);
+
+  ~BPlusTree();
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
 
-  // Insert a key-value pair into this B+ tree.
+  // Insert a key-value pair into this B+ tree. A non-unique tree adds the value to those of the key.
   bool Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
 
-  // Remove a key and its value from this B+ tree.
+  /**
+   * Build this empty B+ tree bottom-up from a stream of key & value pairs in increasing key order. Leaves are filled
+   * left to right to fill_factor of their max size, and each internal level is then built in one pass.
+   * Of pairs with equal keys, a unique tree keeps the first one and a non-unique tree keeps them all.
+   * @param next returns the next pair, or false when there is none left
+   * @return false if the tree is not empty
+   */
+  bool BulkLoad(const std::function<bool(MappingType *)> &next, double fill_factor = 1.0,
+                Transaction *transaction = nullptr);
+
+  // Remove a key and its values from this B+ tree.
   void Remove(const KeyType &key, Transaction *transaction = nullptr);
 
-  // return the value associated with a given key
+  // Remove a value of a key from this B+ tree, and the key once it has no values left.
+  void Remove(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
+
+  // return the values associated with a given key, all of them read in a single visit of its leaf
   bool GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr);
 
+  /**
+   * Look up a batch of keys: the keys are probed in increasing order, and a leaf is reused for all the keys that fall
+   * into it, or reached from the leaf before it, so the batch costs about one traversal per distinct leaf.
+   * @param[out] results the values of each key, at the position of the key, and empty for a key that is not found
+   */
+  void GetValues(const std::vector<KeyType> &keys, std::vector<std::vector<ValueType>> *results,
+                 Transaction *transaction = nullptr);
+
   // index iterator
   INDEXITERATOR_TYPE begin();
   INDEXITERATOR_TYPE Begin(const KeyType &key);
+  /**
+   * Iterator over the keys from low_key to high_key, each bound included or not, and nullptr for no bound. A reverse
+   * iterator starts at the high end of the range and moves down through the prev-links of the leaves.
+   */
+  INDEXITERATOR_TYPE Begin(const KeyType *low_key, bool low_inclusive, const KeyType *high_key, bool high_inclusive,
+                           bool reverse = false);
   INDEXITERATOR_TYPE end();
 
+  /**
+   * Collect the structural statistics of this tree: each level is walked left to right along the right-links, read
+   * latching a page at a time, so writers only wait for the page being read. The statistics are not an atomic snapshot
+   * of a tree that changes meanwhile; a change of the root restarts the walk.
+   * @param max_key_samples the maximum number of key samples
+   */
+  BPlusTreeStats<KeyType> CollectStats(int max_key_samples = 64);
+
+  /**
+   * Compact the leaves online: runs of sparse neighbor leaves are merged, and rewritten together with leaves that are
+   * out of page order (if relocate is set) into new pages allocated in key order, filled to fill_factor of their max
+   * size. One parent is write-latched at a time, with a few of its leaves, so readers and writers of the rest of the
+   * tree continue.
+   * @return the number of leaves freed
+   */
+  int Compact(double fill_factor = 0.9, bool relocate = true, Transaction *transaction = nullptr);
+
+  /**
+   * Set how empty a page may get before a remove merges it with a sibling, or takes entries from it: below threshold
+   * times its max size, and at the latest once it is empty. The default 0.5 merges a page as soon as it is less than
+   * half full; a lower threshold lets pages under delete-insert churn shrink and grow again without merges and splits.
+   * @param threshold in [0, 0.5], a higher one would have merged pages split again right away
+   */
+  void SetMergeThreshold(double threshold) { merge_threshold_ = std::min(std::max(threshold, 0.0), 0.5); }
+
+  /**
+   * Clean up after lazy merges in the background: every interval, the leaves are compacted (without relocating them,
+   * see Compact()) if removes left any of them less than half full since the last run.
+   */
+  void StartBackgroundCleanup(std::chrono::milliseconds interval, double fill_factor = 0.9);
+
+  // stop the background cleanup and wait for a running compaction to finish
+  void StopBackgroundCleanup();
+
+  /**
+   * Enable or disable the adaptive hash index, as InnoDB has it. Once GetValue() found a key ADAPTIVE_HASH_HOT_LOOKUPS
+   * times, the page id, slot and version of its leaf are kept in an in-memory table by the hash of the key, and later
+   * lookups of the key read that leaf without a descent from the root. An entry is used only while the version of
+   * its leaf is unchanged, that is while no split, merge or redistribution moved keys in or out of the leaf, so the
+   * leaf still holds the key if the tree does; the slot is only a hint, the leaf is searched if the key moved within
+   * it. The table has a fixed number of entries, and a hot key replaces the entry of another key with the same slot.
+   * Both enabling and disabling drop all entries and reset the statistics.
+   */
+  void SetAdaptiveHashIndex(bool enable);
+
+  bool IsAdaptiveHashIndexEnabled() const { return adaptive_hash_enabled_; }
+
+  BPlusTreeAdaptiveHashStats GetAdaptiveHashStats() const {
+    return BPlusTreeAdaptiveHashStats{adaptive_hash_lookup_count_, adaptive_hash_hit_count_};
+  }
+
+  // a key gets an adaptive hash entry once it was found by this many lookups
+  static constexpr uint8_t ADAPTIVE_HASH_HOT_LOOKUPS = 3;
+
   void Print(BufferPoolManager *bpm) {
-    ToString(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(root_page_id_)->GetData()), bpm);
+    ToString(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(GetRootPageId())->GetData()), bpm);
   }
 
   void Draw(BufferPoolManager *bpm, const std::string &outf) {
     std::ofstream out(outf);
     out << "digraph G {" << std::endl;
-    ToGraph(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(root_page_id_)->GetData()), bpm, out);
+    ToGraph(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(GetRootPageId())->GetData()), bpm, out);
     out << "}" << std::endl;
     out.close();
   }
@@ -81,28 +230,125 @@ class BPlusTree {
   Page *FindLeafPage(const KeyType &key, bool leftMost = false, Operation operation = Operation::READ,
           Transaction* transaction = nullptr, std::deque<Page*>* lock_page_que = nullptr);
 
+  /**
+   * Find the leaf page for a write without write-latching any internal page: internal pages are read-latched hand
+   * over hand, and only the leaf is write-latched. A full leaf is split without latching its parent (see
+   * InsertIntoParent()), but since a merge of the leaf would need to change its parent, a delete must check the leaf
+   * is safe and otherwise release it and restart with FindLeafPage(), which write-latches the whole unsafe path.
+   * Pages split but not yet posted to their parent are passed by following right-links (see BPlusTreePage).
+   * @return the pinned and write-latched leaf, or nullptr if the tree is empty
+   */
+  Page *FindLeafPageOptimistic(const KeyType &key);
+
+  /**
+   * Find the rightmost leaf, read-latching hand over hand.
+   * @return the pinned and read-latched leaf, or nullptr if the tree is empty
+   */
+  Page *FindLastLeafPage();
+
+  /**
+   * Fast path of inserts of increasing keys: the cached rightmost leaf, if it still is the rightmost leaf of the tree
+   * and the key is greater than all of its keys, so that the key belongs into it without a descent from the root.
+   * @return the pinned and write-latched leaf, or nullptr if the key has to be looked up
+   */
+  Page *FindRightmostLeafPage(const KeyType &key);
+
  private:
   void StartNewTree(const KeyType &key, const ValueType &value);
 
   bool InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
 
-  void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
+  void InsertIntoParent(page_id_t old_page_id, const KeyType &key, page_id_t new_page_id,
                         Transaction *transaction = nullptr);
 
+  page_id_t PostedPredecessor(const InternalPage *parent, page_id_t old_page_id, page_id_t new_page_id);
+
   template <typename N>
-  N *Split(N *node);
+  N *Split(N *node, bool append = false);
+
+  void RemoveEntry(const KeyType &key, const ValueType *value, Transaction *transaction);
+
+  /**
+   * Remove the key, or only the given value of it, from the write-latched leaf. A key with a posting list is never
+   * removed along with one of its values, since its last value but one stays in the entry itself.
+   * @param may_shrink whether the leaf may lose an entry, otherwise nothing is removed if it would
+   * @param[out] shrinks whether the leaf loses (or would lose) an entry
+   * @return whether the leaf was changed
+   */
+  bool RemoveFromLeaf(LeafPage *leaf, const KeyType &key, const ValueType *value, bool may_shrink, bool *shrinks);
+
+  /* Posting lists of a non-unique tree, see BPlusTreePostingPage. They are accessed under the latch of their leaf. */
+
+  // add a value to the RIDs of a leaf entry value, @return false if it is among them already
+  bool InsertIntoPostingList(ValueType *entry_value, const ValueType &value);
+
+  // remove a value from the posting list a leaf entry value references, @return false if it is not in the list
+  bool RemoveFromPostingList(ValueType *entry_value, const ValueType &value);
+
+  // build a posting list for increasing values and return the leaf entry value for it
+  ValueType BuildPostingList(const std::vector<ValueType> &values);
+
+  // append the RIDs of a leaf entry value, reading its posting list in a non-unique tree
+  void ReadValues(const ValueType &entry_value, std::vector<ValueType> *result);
+
+  // delete the pages of the posting list a leaf entry value references, if it references one
+  void DeletePostingList(const ValueType &entry_value);
 
   template <typename N>
-  bool CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr);
+  bool CoalesceOrRedistribute(N *node, const std::deque<Page *> &lock_page_que, std::vector<page_id_t> *deleted_pages,
+                              bool *retry, Transaction *transaction = nullptr);
 
   template <typename N>
   bool Coalesce(N **neighbor_node, N **node, BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent,
-                int index, Transaction *transaction = nullptr);
+                int index, const std::deque<Page *> &lock_page_que, std::vector<page_id_t> *deleted_pages,
+                bool *retry, Transaction *transaction = nullptr);
 
   template <typename N>
   void Redistribute(N *neighbor_node, N *node, int index);
 
-  bool AdjustRoot(BPlusTreePage *node);
+  bool AdjustRoot(BPlusTreePage *node, std::vector<page_id_t> *deleted_pages);
+
+  // delete a page of deleted_pages once it is unlatched: bump its version if it is a leaf, then flush and delete it
+  void DeleteLeaf(page_id_t page_id);
+
+  // latch the leaf and set its prev-link, the caller holds the latch of the leaf before it
+  void SetPrevPageId(page_id_t page_id, page_id_t prev_page_id);
+
+  // the leftmost page of the level above the leaves, write-latched, or nullptr if the root is a leaf
+  Page *LatchFirstLeafParent();
+
+  // compact the leaves of the write-latched parent, see Compact(), and add the emptied leaves to deleted_pages
+  int CompactLeaves(InternalPage *parent, double fill_factor, bool relocate, std::vector<page_id_t> *deleted_pages);
+
+  // the number of entries a leaf is filled to by a bulk load or a compaction, at least half of its max size
+  int LeafFillSize(const LeafPage *leaf, double fill_factor) const;
+
+  // the size below which a page is merged, see SetMergeThreshold()
+  int MergeSize(const BPlusTreePage *page) const;
+
+  // the loop of the background cleanup thread
+  void RunBackgroundCleanup(std::chrono::milliseconds interval, double fill_factor);
+
+  // the leaf of a key, as an adaptive hash entry remembers it
+  struct AdaptiveHashEntry {
+    size_t hash_{0};
+    page_id_t page_id_{INVALID_PAGE_ID};
+    int slot_{0};
+    uint64_t version_{0};
+  };
+
+  /**
+   * Look the key up in the leaf of its adaptive hash entry.
+   * @param[out] found whether the key is in the tree
+   * @return false if the key has no entry, or the entry is no longer valid
+   */
+  bool GetValueByHash(const KeyType &key, size_t hash, std::vector<ValueType> *result, bool *found);
+
+  // count a lookup that found the key in the read-latched leaf, and add the entry of the key once it is hot
+  void CountAdaptiveHashLookup(const KeyType &key, size_t hash, LeafPage *leaf);
+
+  // the configured max size of pages of the kind of the given one, pages that compress keys may hold fewer
+  int MaxSize(const BPlusTreePage *page) const;
 
   void UpdateRootPageId(int insert_record = 0);
 
@@ -111,38 +357,91 @@ class BPlusTree {
 
   void ToString(BPlusTreePage *page, BufferPoolManager *bpm) const;
 
+  // unlatch and unpin the pages, in the order they were latched
   void UnlockPages(Operation op, std::deque<Page *>& deque) const ;
 
   bool IsSafe(Operation op, Page* cur) const;
 
-  void CrabingFetchPage(const Operation &op, Transaction *transaction, std::deque<Page *> *lock_page_que,
-                        Page *child);
+  Page *CrabingFetchPage(const Operation &op, const KeyType &key, bool leftMost, std::deque<Page *> *lock_page_que,
+                         Page *child);
+
+  // whether the key is beyond the high key of the page, that is it was moved to a right sibling by a split
+  bool ShouldMoveRight(Page *page, const KeyType &key) const;
+  bool ShouldMoveRight(BPlusTreePage *node, const KeyType &key) const;
+
+  // latch the right sibling of the page in the same mode, then unlatch and unpin the page
+  Page *MoveRight(Page *page, bool exclusive);
+
+  // whether the split of the child at index is posted to the (latched) parent, and so the child can be merged
+  template <typename N>
+  bool IsSettled(const InternalPage *parent, int index, const N *child) const;
 
-    inline void LockRootPage(bool exclusive) {
-    if (!root_lock) {
-        // std::cout<<"LockRootPage:"<<std::this_thread::get_id()<<std::endl;
-      root_page_mutex_.lock();
-      root_lock = true;
+  inline void LatchPage(Page *page, bool exclusive) const {
+    if (exclusive) {
+      page->WLatch();
+    } else {
+      page->RLatch();
     }
   }
 
-  inline void UnlockRootPage(bool exclusive) {
-      if (root_lock) {
-          // std::cout<<"UnlockRootPage:"<<std::this_thread::get_id()<<std::endl;
-        root_page_mutex_.unlock();
-        root_lock = false;
-      }
+  inline void UnlatchPage(Page *page, bool exclusive) const {
+    if (exclusive) {
+      page->WUnlatch();
+    } else {
+      page->RUnlatch();
     }
+  }
+
+  // a snapshot of the root page id, which may change as soon as it is read
+  page_id_t GetRootPageId() const { return static_cast<page_id_t>(static_cast<uint32_t>(root_.load())); }
+
+  // publish a new root page id with the next version, only under root_latch_
+  void SetRootPageId(page_id_t root_page_id);
+
+  /**
+   * Fetch and latch the current root page without taking root_latch_: the root page id is read, its page latched, and
+   * the read is repeated if the root changed meanwhile. A leaf root is write-latched if exclusive_leaf is set.
+   * @return the pinned and latched root page, or nullptr if the tree is empty
+   */
+  Page *LatchRootPage(bool exclusive, bool exclusive_leaf);
+
   // member variable
   std::string index_name_;
-  page_id_t root_page_id_;
+  // the root page id in the low 32 bits, and the number of root changes in the high ones
+  std::atomic<uint64_t> root_{static_cast<uint32_t>(INVALID_PAGE_ID)};
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
-  std::mutex root_page_mutex_;
-  static thread_local bool root_lock;
-  int node_size_;
+  bool unique_;
+  // the rightmost leaf last seen by an insert, only a hint (see FindRightmostLeafPage())
+  std::atomic<page_id_t> rightmost_leaf_page_id_{INVALID_PAGE_ID};
+  std::atomic<double> merge_threshold_{0.5};
+  // removes that left a leaf less than half full without merging it, since the last background cleanup
+  std::atomic<int64_t> deferred_merges_{0};
+  // the background cleanup runs while enabled, which is protected by cleanup_latch_ and signalled on cleanup_cv_
+  bool enable_background_cleanup_{false};
+  std::mutex cleanup_latch_;
+  std::condition_variable cleanup_cv_;
+  std::thread cleanup_thread_;
+  // the most leaves a compaction rewrites at once
+  static constexpr size_t COMPACT_WINDOW = 8;
+  // attempts of a merge before it backs off, and before its page is left underfull for the background cleanup
+  static constexpr int MERGE_SPIN_RETRIES = 16;
+  static constexpr int MERGE_RETRIES = 1024;
+  // taken by the root changes only: a new tree, a root split and a root collapse (AdjustRoot()), and a bulk load
+  std::mutex root_latch_;
+  // the adaptive hash index, allocated when it is first enabled and then kept, entries are read under the latch of
+  // their partition
+  static constexpr size_t ADAPTIVE_HASH_SIZE = 1 << 14;
+  static constexpr size_t ADAPTIVE_HASH_PARTITIONS = 16;
+  std::atomic<bool> adaptive_hash_enabled_{false};
+  std::unique_ptr<AdaptiveHashEntry[]> adaptive_hash_;
+  // lookups of the keys of each entry slot that found their key since the slot last got an entry
+  std::unique_ptr<std::atomic<uint8_t>[]> adaptive_hash_lookups_;
+  std::mutex adaptive_hash_latches_[ADAPTIVE_HASH_PARTITIONS];
+  std::atomic<int64_t> adaptive_hash_lookup_count_{0};
+  std::atomic<int64_t> adaptive_hash_hit_count_{0};
 };
 
 }  // namespace bustub
@@ -13,10 +13,12 @@
 
 #include <map>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "storage/index/b_plus_tree.h"
 #include "storage/index/index.h"
+#include "storage/table/table_heap.h"
 
 namespace bustub {
 
@@ -25,7 +27,14 @@ namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
  public:
-  BPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager);
+  /**
+   * @param unique whether a key maps to a single RID, otherwise the RIDs of a key are kept in a posting list and an
+   * entry is only a duplicate if both its key and its RID are
+   * The included columns of the key schema, if any, are stored in the tree keys after the key columns, so the tree is
+   * ordered by both and the RIDs of a posting list share their included values too. They need a key schema that can
+   * be normalized, lookups then search for the range of tree keys that start with the key columns.
+   */
+  BPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager, bool unique = true);
 
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
@@ -33,13 +42,67 @@ class BPlusTreeIndex : public Index {
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  // ScanKey() for a batch of key tuples, probed in key order in one walk of the tree, see BPlusTree::GetValues()
+  void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results, Transaction *transaction);
+
   INDEXITERATOR_TYPE GetBeginIterator();
 
   INDEXITERATOR_TYPE GetBeginIterator(const KeyType &key);
 
   INDEXITERATOR_TYPE GetEndIterator();
 
+  // the structural statistics of the tree, see BPlusTree::CollectStats()
+  BPlusTreeStats<KeyType> CollectStats(int max_key_samples = 64) { return container_.CollectStats(max_key_samples); }
+
+  // enable or disable the adaptive hash index of the tree for ScanKey(), see BPlusTree::SetAdaptiveHashIndex()
+  void SetAdaptiveHashIndex(bool enable) { container_.SetAdaptiveHashIndex(enable); }
+
+  // the hit rate of the adaptive hash index
+  BPlusTreeAdaptiveHashStats GetAdaptiveHashStats() const { return container_.GetAdaptiveHashStats(); }
+
+  /**
+   * Iterator over the keys from low_key to high_key, tuples of the key schema that are each included or not, and
+   * nullptr for no bound. The included columns of the bounds are ignored. A reverse iterator returns the keys from
+   * the high end of the range down.
+   */
+  INDEXITERATOR_TYPE GetRangeIterator(const Tuple *low_key, bool low_inclusive, const Tuple *high_key,
+                                      bool high_inclusive, bool reverse = false);
+
+  /**
+   * Build the index key of a key tuple. Keys are stored in their normalized encoding whenever the key schema allows
+   * it, so that they compare without deserializing values.
+   */
+  KeyType MakeIndexKey(const Tuple &key) const;
+
+  /** @return the value of a column of the key schema in an index key, such as the key of an iterator item */
+  Value GetKeyValue(const KeyType &index_key, uint32_t column_idx) const;
+
+  /**
+   * Populate this empty index with every tuple of a table: the keys are collected and sorted, and the tree is then
+   * bulk loaded bottom-up instead of inserting them one at a time. Of tuples with equal keys, a unique index keeps the
+   * first one.
+   * The table is scanned by several threads, which claim ranges of pages of the page chain in turn and each sort the
+   * keys of their pages into a run; the runs are then merged into the bulk load. Tuples are only read in parallel
+   * when they are read without locks, the lock sets of a transaction are not shared between threads.
+   * @param table_schema schema of the tuples in table_heap
+   * @param threads the number of threads scanning the table
+   * @return false if the index is not empty
+   */
+  bool BulkLoad(TableHeap *table_heap, const Schema &table_schema, Transaction *transaction,
+                double fill_factor = 1.0, size_t threads = std::thread::hardware_concurrency());
+
  protected:
+  /**
+   * Build the index key bounding the index keys of a key tuple: the key itself, or for an index with included columns
+   * the smallest (or with max, the largest) index key with the key columns of the tuple.
+   */
+  KeyType MakeBoundKey(const Tuple &key, bool max) const;
+
+  // the number of pages of the table a thread building the index claims at a time
+  static constexpr size_t SCAN_RANGE_PAGES = 8;
+
+  // whether a key maps to a single RID
+  bool unique_;
   // comparator for key
   KeyComparator comparator_;
   // container
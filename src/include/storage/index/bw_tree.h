@@ -0,0 +1,205 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bw_tree.h
+//
+// Identification: src/include/storage/index/bw_tree.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "storage/index/epoch_manager.h"
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+#define BWTREE_TYPE BwTree<KeyType, ValueType, KeyComparator>
+
+// logical id of a Bw-tree node, the index of its slot in the mapping table
+using bw_node_id_t = int32_t;
+static constexpr bw_node_id_t INVALID_NODE_ID = -1;
+
+/**
+ * Header of the page a consolidated Bw-tree node is written to, followed by the high key and the entries:
+ *  -----------------------------------------------------------------------------------
+ * | Version (8) | Level (4) | Size (4) | RightNodeId (4) | HasHighKey (4) | HighKey | ...
+ *  -----------------------------------------------------------------------------------
+ */
+#define BW_TREE_PAGE_HEADER_SIZE 24
+
+/**
+ * Latch-free B+ tree (Bw-tree), after Levandoski et al.
+ *
+ * Nodes are reached through a mapping table from logical node ids to the node in memory, so that a node is changed by
+ * a single compare-and-swap of its slot: an insert or a delete prepends a delta record to the chain of deltas of its
+ * leaf, and a new separator prepends a separator delta to its inner node. Readers walk the chain down to the base node
+ * it applies to. Once a chain grows to CONSOLIDATE_LENGTH deltas, it is replaced by a new base node with the deltas
+ * applied; a base node that outgrows its max size is split in the same step, its upper part moved to new right
+ * siblings, whose separators are then posted to the parent. Like the B-link tree, every node keeps its high key and
+ * right sibling, so a thread that reaches a node before the separator of its split is posted moves right.
+ * Nodes are never merged, a leaf emptied by deletes stays in the tree.
+ *
+ * Unlinked chains are freed by epoch-based reclamation (see EpochManager). Every consolidated base node is also
+ * written to the page of its node through the buffer pool, so the pages hold the last consolidated image of the tree.
+ *
+ * A unique tree maps a key to a single value, a non-unique tree keeps every distinct value of a key.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class BwTree {
+ public:
+  explicit BwTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+                  bool unique = true, int leaf_max_size = 0, int inner_max_size = 0);
+
+  ~BwTree();
+
+  BwTree(const BwTree &) = delete;
+  BwTree &operator=(const BwTree &) = delete;
+
+  // Insert a key-value pair, false if the key (or for a non-unique tree, the pair) is already in the tree.
+  bool Insert(const KeyType &key, const ValueType &value);
+
+  // Remove a key and its values.
+  void Remove(const KeyType &key);
+
+  // Remove a value of a key.
+  void Remove(const KeyType &key, const ValueType &value);
+
+  // Return the values associated with a given key.
+  bool GetValue(const KeyType &key, std::vector<ValueType> *result);
+
+  /**
+   * Read the entries with keys from low_key to high_key in key order, both included, and nullptr for no bound. The
+   * scan reads one leaf at a time, so it sees a consistent state of each leaf but not of the whole range.
+   */
+  void Scan(const KeyType *low_key, const KeyType *high_key, std::vector<MappingType> *result);
+
+  /** @return the number of nodes unlinked by consolidations and freed since */
+  uint64_t GetFreedNodeCount() const { return epoch_manager_.GetFreedCount(); }
+
+  /** @return the number of levels of the tree, 1 for a single leaf */
+  int GetHeight();
+
+  // consolidate a chain of this many deltas
+  static constexpr int CONSOLIDATE_LENGTH = 8;
+
+ private:
+  enum class NodeType { LEAF, INNER, INSERT, DELETE, SEPARATOR };
+
+  using InnerEntry = std::pair<KeyType, bw_node_id_t>;
+
+  /**
+   * Base node or delta record. Every node carries the level, high key and right sibling of the node it is the head
+   * of, so they are read from the head of a chain without walking it.
+   */
+  struct Node : public EpochGarbage {
+    NodeType type_;
+    int level_{0};
+    // the number of deltas from this node down to the base node
+    int chain_length_{0};
+    // increases with every consolidation of the node
+    uint64_t version_{0};
+    bool has_high_key_{false};
+    KeyType high_key_;
+    bw_node_id_t right_{INVALID_NODE_ID};
+    // the node a delta applies to
+    Node *next_{nullptr};
+  };
+
+  struct LeafNode : public Node {
+    std::vector<MappingType> entries_;
+  };
+
+  // the key of the first child is the low key of the node, no key below it is searched for in the node
+  struct InnerNode : public Node {
+    std::vector<InnerEntry> children_;
+  };
+
+  /**
+   * INSERT of the entry key_ & value_, DELETE of the value value_ of key_, or without has_value_ of every value of
+   * key_, or SEPARATOR of child_, which holds the keys from key_ up to next_key_ (without has_next_key_, all of them).
+   */
+  struct DeltaNode : public Node {
+    KeyType key_;
+    ValueType value_;
+    bool has_value_{true};
+    bw_node_id_t child_{INVALID_NODE_ID};
+    bool has_next_key_{false};
+    KeyType next_key_;
+  };
+
+  // the slots of the mapping table are allocated MAPPING_CHUNK_SIZE at a time
+  static constexpr size_t MAPPING_CHUNK_SIZE = 1024;
+  static constexpr size_t MAPPING_CHUNK_COUNT = 4096;
+
+  struct MappingChunk {
+    std::atomic<Node *> nodes_[MAPPING_CHUNK_SIZE]{};
+    page_id_t page_ids_[MAPPING_CHUNK_SIZE];
+  };
+
+  std::atomic<Node *> &Slot(bw_node_id_t node_id);
+  page_id_t &PageIdOf(bw_node_id_t node_id);
+  // allocate a node id and its page, and publish the node in its slot
+  bw_node_id_t NewNodeId(Node *node);
+  // release the node id of a node that was never reachable, and delete the node
+  void DeleteUnreachable(bw_node_id_t node_id);
+
+  // a delta applied to head, with the level, high key and right sibling of head
+  DeltaNode *NewDelta(NodeType type, Node *head);
+
+  /**
+   * Find the node at the given level whose keys include key, or the leftmost node of the level if key is nullptr.
+   * @param[out] head the head of the node
+   * @return INVALID_NODE_ID if the tree has fewer levels
+   */
+  bw_node_id_t FindNode(const KeyType *key, int level, Node **head);
+  // the child of an inner node whose keys include key
+  bw_node_id_t SearchInner(Node *head, const KeyType &key);
+  static Node *BaseOf(Node *head);
+  // whether a key is below the high key of the node
+  bool Covers(const Node *head, const KeyType &key) const;
+
+  // the values of a key in a leaf
+  void ReadValues(Node *head, const KeyType &key, std::vector<ValueType> *result);
+  // the entries of a leaf, or the children of an inner node, in key order with the chain applied
+  void ReadEntries(Node *head, std::vector<MappingType> *entries);
+  void ReadChildren(Node *head, std::vector<InnerEntry> *children);
+
+  // prepend a delta to a leaf, unless the leaf already has (or for a DELETE, lacks) its entry
+  bool UpdateLeaf(NodeType type, const KeyType &key, const ValueType *value);
+
+  /**
+   * Replace the chain of a node with a new base node, split into right siblings if it outgrows its max size, and post
+   * the separators of the siblings. Nothing is changed if the chain changes meanwhile.
+   */
+  void Consolidate(bw_node_id_t node_id, EpochGuard *guard);
+  // post the separator of a new node at level, from key to the next key if there is one
+  void PostSeparator(int level, const KeyType &key, bw_node_id_t child, const KeyType *next_key,
+                     EpochGuard *guard);
+
+  // write a base node to the page of its node, unless the page holds a later version already
+  void WriteNode(bw_node_id_t node_id, const Node *base);
+
+  static void DeleteChain(Node *head);
+
+  std::string index_name_;
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+  bool unique_;
+  int leaf_max_size_;
+  int inner_max_size_;
+  std::atomic<bw_node_id_t> root_id_{INVALID_NODE_ID};
+  std::atomic<bw_node_id_t> next_node_id_{0};
+  std::atomic<MappingChunk *> mapping_table_[MAPPING_CHUNK_COUNT]{};
+  EpochManager epoch_manager_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,48 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bw_tree_index.h
+//
+// Identification: src/include/storage/index/bw_tree_index.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+#include "storage/index/bw_tree.h"
+#include "storage/index/index.h"
+
+namespace bustub {
+
+#define BWTREE_INDEX_TYPE BwTreeIndex<KeyType, ValueType, KeyComparator>
+
+/**
+ * Index on a latch-free Bw-tree (see BwTree), for indexes updated by many threads at once. It supports the point
+ * operations of Index, range scans go through BPlusTreeIndex.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class BwTreeIndex : public Index {
+ public:
+  /** @param unique whether a key maps to a single RID, otherwise an entry is only a duplicate if its RID is too */
+  BwTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager, bool unique = true);
+
+  void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
+
+  /** Build the index key of a key tuple, normalized whenever the key schema allows it, as BPlusTreeIndex does. */
+  KeyType MakeIndexKey(const Tuple &key) const;
+
+ protected:
+  // comparator for key
+  KeyComparator comparator_;
+  // container
+  BwTree<KeyType, ValueType, KeyComparator> container_;
+};
+
+}  // namespace bustub
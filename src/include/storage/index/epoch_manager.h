@@ -0,0 +1,87 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// epoch_manager.h
+//
+// Identification: src/include/storage/index/epoch_manager.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>  // NOLINT
+
+namespace bustub {
+
+/** Memory a latch-free index unlinks while other threads may still read it, freed by an EpochManager. */
+class EpochGarbage {
+ public:
+  virtual ~EpochGarbage() = default;
+
+ private:
+  friend class EpochManager;
+  EpochGarbage *garbage_next_{nullptr};
+};
+
+/**
+ * Epoch-based reclamation of the nodes of the latch-free indexes (BwTree, ArtTree).
+ *
+ * Every operation on an index runs inside an epoch, from JoinEpoch() to LeaveEpoch(), and retires the nodes it
+ * unlinks into the garbage of its epoch. The global epoch only advances past an epoch once no thread is in the epoch
+ * before it, so threads are only ever in the last two epochs, and the garbage of an epoch is freed two epochs later:
+ * by then every thread that could have reached its nodes has left. Epochs are advanced every ADVANCE_INTERVAL
+ * operations by whichever thread leaves its epoch, there is no background thread.
+ */
+class EpochManager {
+ public:
+  EpochManager() = default;
+  ~EpochManager();
+
+  /** @return the epoch the calling thread entered */
+  uint64_t JoinEpoch();
+
+  void LeaveEpoch(uint64_t epoch);
+
+  /** Free the garbage once no thread can reach it anymore, the caller must be in the given epoch. */
+  void Retire(uint64_t epoch, EpochGarbage *garbage);
+
+  /** @return the number of garbage objects freed so far */
+  uint64_t GetFreedCount() const { return freed_count_; }
+
+ private:
+  void TryAdvance();
+  void FreeGarbage(EpochGarbage *garbage);
+
+  // the last epochs, by their number modulo EPOCH_SLOTS: threads are in the last two, the third one is being freed
+  static constexpr uint64_t EPOCH_SLOTS = 3;
+  static constexpr uint64_t ADVANCE_INTERVAL = 64;
+
+  std::atomic<uint64_t> epoch_{0};
+  std::atomic<int64_t> active_[EPOCH_SLOTS]{};
+  std::atomic<EpochGarbage *> garbage_[EPOCH_SLOTS]{};
+  std::atomic<uint64_t> leave_count_{0};
+  std::atomic<uint64_t> freed_count_{0};
+  std::mutex advance_latch_;
+};
+
+/** Keeps the calling thread in an epoch while it is in scope. */
+class EpochGuard {
+ public:
+  explicit EpochGuard(EpochManager *epoch_manager)
+      : epoch_manager_(epoch_manager), epoch_(epoch_manager->JoinEpoch()) {}
+  ~EpochGuard() { epoch_manager_->LeaveEpoch(epoch_); }
+
+  EpochGuard(const EpochGuard &) = delete;
+  EpochGuard &operator=(const EpochGuard &) = delete;
+
+  void Retire(EpochGarbage *garbage) { epoch_manager_->Retire(epoch_, garbage); }
+
+ private:
+  EpochManager *epoch_manager_;
+  uint64_t epoch_;
+};
+
+}  // namespace bustub
@@ -12,10 +12,12 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstring>
 
 #include "storage/table/tuple.h"
 #include "type/value.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -35,6 +37,94 @@ class GenericKey {
     memcpy(data_, tuple.GetData(), tuple.GetLength());
   }
 
+  /**
+   * Set the key to the normalized encoding of a key tuple. Every column is stored as a null-prefix byte (0 for NULL,
+   * so that NULLs sort first, 1 otherwise) followed by its value in big-endian order, with the sign bit of integers
+   * flipped and the bits of negative decimals inverted. Normalized keys therefore compare like their tuples when
+   * compared byte by byte, see GenericComparator.
+   * The key schema must satisfy CanNormalize().
+   */
+  inline void SetNormalizedFromKey(const Tuple &tuple, const Schema *key_schema) {
+    memset(data_, 0, KeySize);
+    EncodeNormalized(tuple, key_schema, key_schema->GetColumnCount());
+  }
+
+  /**
+   * Set the key to the smallest (or with max, the largest) normalized key whose first column_count columns are those
+   * of the key tuple: the bytes after them are all 0 (or all 1). Keys with those columns sort between the two.
+   */
+  inline void SetNormalizedPrefixFromKey(const Tuple &tuple, const Schema *key_schema, uint32_t column_count,
+                                         bool max) {
+    memset(data_, 0, KeySize);
+    uint32_t length = EncodeNormalized(tuple, key_schema, column_count);
+    if (max) {
+      memset(data_ + length, 0xFF, KeySize - length);
+    }
+  }
+
+  /** @return the value of a column of a key set by SetNormalizedFromKey() */
+  inline Value ToNormalizedValue(const Schema *key_schema, uint32_t column_idx) const {
+    const char *in = data_;
+    for (uint32_t i = 0; i < column_idx; i++) {
+      in += 1 + NormalizedLength(key_schema->GetColumn(i).GetType());
+    }
+    const TypeId type = key_schema->GetColumn(column_idx).GetType();
+    const uint32_t length = NormalizedLength(type);
+    if (*in++ == 0) {
+      return ValueFactory::GetNullValueByType(type);
+    }
+    uint64_t bits = 0;
+    for (uint32_t b = 0; b < length; b++) {
+      bits = bits << 8 | static_cast<uint8_t>(in[b]);
+    }
+    switch (type) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        return Value(type, static_cast<int8_t>(bits ^ 0x80U));
+      case TypeId::SMALLINT:
+        return Value(type, static_cast<int16_t>(bits ^ 0x8000U));
+      case TypeId::INTEGER:
+        return Value(type, static_cast<int32_t>(bits ^ 0x80000000U));
+      case TypeId::BIGINT:
+        return Value(type, static_cast<int64_t>(bits ^ (1ULL << 63U)));
+      case TypeId::TIMESTAMP:
+        return Value(type, bits);
+      case TypeId::DECIMAL: {
+        bits = (bits >> 63U) != 0 ? bits & ~(1ULL << 63U) : ~bits;
+        double decimal;
+        memcpy(&decimal, &bits, sizeof(decimal));
+        return Value(type, decimal);
+      }
+      default:
+        return ValueFactory::GetNullValueByType(type);
+    }
+  }
+
+  /**
+   * @return true iff every column of the key schema has a fixed-size normalized encoding and the encoded key,
+   * including the null-prefix bytes, fits in KeySize bytes
+   */
+  static bool CanNormalize(const Schema *key_schema) {
+    uint32_t length = 0;
+    for (uint32_t i = 0; i < key_schema->GetColumnCount(); i++) {
+      uint32_t column_length = NormalizedLength(key_schema->GetColumn(i).GetType());
+      if (column_length == 0) {
+        return false;
+      }
+      length += 1 + column_length;
+    }
+    return length <= KeySize;
+  }
+
+  /** @return the size of the normalized encoding of keys of the key schema, see SetNormalizedFromKey() */
+  static uint32_t NormalizedSize(const Schema *key_schema) {
+    uint32_t length = 0;
+    for (uint32_t i = 0; i < key_schema->GetColumnCount(); i++) {
+      length += 1 + NormalizedLength(key_schema->GetColumn(i).GetType());
+    }
+    return length;
+  }
+
   // NOTE: for test purpose only
   inline void SetFromInteger(int64_t key) {
     memset(data_, 0, KeySize);
@@ -68,6 +158,73 @@ class GenericKey {
 
   // actual location of data, extends past the end.
   char data_[KeySize];
+
+ private:
+  /** Encode the first column_count columns of the key tuple into the zeroed key, @return the encoded length */
+  inline uint32_t EncodeNormalized(const Tuple &tuple, const Schema *key_schema, uint32_t column_count) {
+    char *out = data_;
+    for (uint32_t i = 0; i < column_count; i++) {
+      const TypeId type = key_schema->GetColumn(i).GetType();
+      const uint32_t length = NormalizedLength(type);
+      Value value = tuple.GetValue(key_schema, i);
+      if (value.IsNull()) {
+        out += 1 + length;
+        continue;
+      }
+      *out++ = 1;
+      uint64_t bits = 0;
+      switch (type) {
+        case TypeId::BOOLEAN:
+        case TypeId::TINYINT:
+          bits = static_cast<uint8_t>(value.GetAs<int8_t>()) ^ 0x80U;
+          break;
+        case TypeId::SMALLINT:
+          bits = static_cast<uint16_t>(value.GetAs<int16_t>()) ^ 0x8000U;
+          break;
+        case TypeId::INTEGER:
+          bits = static_cast<uint32_t>(value.GetAs<int32_t>()) ^ 0x80000000U;
+          break;
+        case TypeId::BIGINT:
+          bits = static_cast<uint64_t>(value.GetAs<int64_t>()) ^ (1ULL << 63U);
+          break;
+        case TypeId::TIMESTAMP:
+          bits = value.GetAs<uint64_t>();
+          break;
+        case TypeId::DECIMAL: {
+          double decimal = value.GetAs<double>();
+          memcpy(&bits, &decimal, sizeof(bits));
+          bits = (bits >> 63U) != 0 ? ~bits : bits | (1ULL << 63U);
+          break;
+        }
+        default:
+          break;
+      }
+      for (uint32_t b = 0; b < length; b++) {
+        out[b] = static_cast<char>(bits >> (8 * (length - 1 - b)));
+      }
+      out += length;
+    }
+    return static_cast<uint32_t>(out - data_);
+  }
+
+  /** @return the size of the normalized encoding of a value of the given type, 0 if it has no fixed-size encoding */
+  static uint32_t NormalizedLength(TypeId type) {
+    switch (type) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        return 1;
+      case TypeId::SMALLINT:
+        return 2;
+      case TypeId::INTEGER:
+        return 4;
+      case TypeId::BIGINT:
+      case TypeId::DECIMAL:
+      case TypeId::TIMESTAMP:
+        return 8;
+      default:
+        return 0;
+    }
+  }
 };
 
 /**
@@ -77,6 +234,9 @@ template <size_t KeySize>
 class GenericComparator {
  public:
   inline int operator()(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) const {
+    if (normalized_) {
+      return CompareNormalized(lhs, rhs);
+    }
     uint32_t column_count = key_schema_->GetColumnCount();
 
     for (uint32_t i = 0; i < column_count; i++) {
@@ -94,13 +254,64 @@ class GenericComparator {
     return 0;
   }
 
-  GenericComparator(const GenericComparator &other) : key_schema_{other.key_schema_} {}
+  GenericComparator(const GenericComparator &other)
+      : key_schema_{other.key_schema_}, normalized_{other.normalized_}, key_length_{other.key_length_} {}
+
+  /**
+   * @param key_schema schema of the keys
+   * @param normalized true iff the keys are set by GenericKey::SetNormalizedFromKey(), they are then compared
+   * byte-wise instead of column by column
+   */
+  explicit GenericComparator(Schema *key_schema, bool normalized = false)
+      : key_schema_(key_schema), normalized_(normalized), key_length_(KeyLength(key_schema, normalized)) {}
 
-  // constructor
-  explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
+  /** @return true iff this comparator compares normalized keys */
+  inline bool IsNormalized() const { return normalized_; }
+
+  /**
+   * @return the number of leading bytes of the keys that may be set, the other bytes of a GenericKey are always zero:
+   * the size of the normalized encoding, or of the key tuple if it has no variable-length columns
+   */
+  inline size_t KeyLength() const { return key_length_; }
 
  private:
+  /** Byte-wise comparison of normalized keys, a word at a time. */
+  static inline int CompareNormalized(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) {
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= KeySize; i += sizeof(uint64_t)) {
+      uint64_t lhs_word;
+      uint64_t rhs_word;
+      memcpy(&lhs_word, lhs.data_ + i, sizeof(uint64_t));
+      memcpy(&rhs_word, rhs.data_ + i, sizeof(uint64_t));
+      if (lhs_word != rhs_word) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        // the words hold big-endian bytes
+        lhs_word = __builtin_bswap64(lhs_word);
+        rhs_word = __builtin_bswap64(rhs_word);
+#endif
+        return lhs_word < rhs_word ? -1 : 1;
+      }
+    }
+    if (i < KeySize) {
+      int cmp = memcmp(lhs.data_ + i, rhs.data_ + i, KeySize - i);
+      return (cmp > 0) - (cmp < 0);
+    }
+    return 0;
+  }
+
+  static size_t KeyLength(const Schema *key_schema, bool normalized) {
+    if (nullptr == key_schema) {
+      return KeySize;
+    }
+    if (normalized) {
+      return std::min<size_t>(GenericKey<KeySize>::NormalizedSize(key_schema), KeySize);
+    }
+    return key_schema->IsInlined() ? std::min<size_t>(key_schema->GetLength(), KeySize) : KeySize;
+  }
+
   Schema *key_schema_;
+  bool normalized_;
+  size_t key_length_;
 };
 
 }  // namespace bustub
@@ -30,15 +30,26 @@ namespace bustub {
  * index, since the external callers does not know the actual structure of
  * the index key, so it is the index's responsibility to maintain such a
  * mapping relation and does the conversion between tuple key and index key
+ *
+ * The index key may end with included columns: they are stored in the index entries, so that a query that only needs
+ * indexed columns is answered from the index, but they are not part of the key a lookup searches for.
  */
 class Transaction;
 class IndexMetadata {
  public:
   IndexMetadata() = delete;
 
+  /**
+   * @param key_attrs the columns of the tuple that make up the key
+   * @param included_attrs the columns of the tuple stored after them in the index key, see GetIncludedColumnCount()
+   */
   IndexMetadata(std::string index_name, std::string table_name, const Schema *tuple_schema,
-                std::vector<uint32_t> key_attrs)
-      : name_(std::move(index_name)), table_name_(std::move(table_name)), key_attrs_(std::move(key_attrs)) {
+                std::vector<uint32_t> key_attrs, const std::vector<uint32_t> &included_attrs = {})
+      : name_(std::move(index_name)),
+        table_name_(std::move(table_name)),
+        key_attrs_(std::move(key_attrs)),
+        included_column_count_(static_cast<uint32_t>(included_attrs.size())) {
+    key_attrs_.insert(key_attrs_.end(), included_attrs.begin(), included_attrs.end());
     key_schema_ = Schema::CopySchema(tuple_schema, key_attrs_);
   }
 
@@ -48,7 +59,7 @@ class IndexMetadata {
 
   inline const std::string &GetTableName() { return table_name_; }
 
-  // Returns a schema object pointer that represents the indexed key
+  // Returns a schema object pointer that represents the indexed key, its included columns last
   inline Schema *GetKeySchema() const { return key_schema_; }
 
   // Return the number of columns inside index key (not in tuple key)
@@ -56,6 +67,9 @@ class IndexMetadata {
   // because it uses the member of catalog::Schema which is not known here
   uint32_t GetIndexColumnCount() const { return static_cast<uint32_t>(key_attrs_.size()); }
 
+  // Return the number of included columns at the end of the index key
+  uint32_t GetIncludedColumnCount() const { return included_column_count_; }
+
   //  Returns the mapping relation between indexed columns  and base table
   //  columns
   inline const std::vector<uint32_t> &GetKeyAttrs() const { return key_attrs_; }
@@ -77,7 +91,9 @@ class IndexMetadata {
   std::string name_;
   std::string table_name_;
   // The mapping relation between key schema and tuple schema
-  const std::vector<uint32_t> key_attrs_;
+  std::vector<uint32_t> key_attrs_;
+  // The number of included columns at the end of the key
+  uint32_t included_column_count_;
   // schema of the indexed key
   Schema *key_schema_;
 };
@@ -117,6 +133,8 @@ class Index {
 
   const std::vector<uint32_t> &GetKeyAttrs() const { return metadata_->GetKeyAttrs(); }
 
+  uint32_t GetIncludedColumnCount() const { return metadata_->GetIncludedColumnCount(); }
+
   // Get a string representation for debugging
   std::string ToString() const {
     std::stringstream os;
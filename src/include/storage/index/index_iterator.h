@@ -13,18 +13,52 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include <vector>
+
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+/**
+ * Iterator over the entries of the B+ tree leaves, in key order or in reverse key order, optionally bounded by a
+ * low and a high key.
+ *
+ * The iterator holds neither a latch nor a pin between calls. Each step read-latches the current leaf and finds the
+ * entry after the last one returned by its key, following right-links (and read-latching hand over hand) when the
+ * leaf split or was merged away meanwhile, so concurrent inserts and deletes never make it skip or repeat an entry.
+ * A key with a posting list yields an entry for each of its values, which are read along with the key.
+ *
+ * A reverse iterator steps to the left sibling through its prev-link, after releasing the current leaf since leaves
+ * are only latched left to right. The prev-link may be stale by then, so the iterator moves right from the page it
+ * reached as long as that page is not the left sibling and its keys end below the current key.
+ * The iterator ends at the first entry beyond its far bound, without reading leaves the range ends before.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
     using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
  public:
-  // you may define your own constructor based on your member variables
-  IndexIterator(page_id_t cur_page_id, int idx, BufferPoolManager* buffer_pool_manager);
+  /** Create an end iterator. */
+  explicit IndexIterator(BufferPoolManager *buffer_pool_manager);
+
+  /**
+   * Create an iterator at the first entry at or after index idx of a leaf, or at the first entry of the leaves to its
+   * right if there is none. The pinned and read-latched leaf is released here.
+   * The comparator must outlive the iterator. Values are read as posting list references only if the tree is not unique.
+   */
+  IndexIterator(Page *leaf_page, int idx, BufferPoolManager *buffer_pool_manager, const KeyComparator *comparator,
+                bool unique);
+
+  /**
+   * Create an iterator that ends before the first entry beyond bound, a high key (or a low key, if reverse) that is
+   * included or not, and nullptr for no bound. A forward iterator starts as above, a reverse one at the last entry at
+   * or before index idx (which may be -1) of the leaf, or at the last entry of the leaves to its left, whose keys are
+   * then below start_key (nullptr for any).
+   */
+  IndexIterator(Page *leaf_page, int idx, BufferPoolManager *buffer_pool_manager, const KeyComparator *comparator,
+                bool unique, const KeyType *bound, bool bound_inclusive, bool reverse,
+                const KeyType *start_key = nullptr);
   ~IndexIterator();
 
   bool isEnd();
@@ -34,7 +68,7 @@ class IndexIterator {
   IndexIterator &operator++();
 
   bool operator==(const IndexIterator &itr) const {
-    return cur_page_id_==itr.cur_page_id_ && idx_==itr.idx_;
+    return cur_page_id_==itr.cur_page_id_ && idx_==itr.idx_ && value_idx_==itr.value_idx_;
   }
 
   bool operator!=(const IndexIterator &itr) const {
@@ -42,10 +76,50 @@ class IndexIterator {
   }
 
  private:
+  /**
+   * Settle on the first entry at or after idx_ of the read-latched leaf or of its right siblings, and release the leaf.
+   * Right siblings are searched by the key of the current entry if after_item, and from their start otherwise.
+   */
+  void Settle(Page *page, bool after_item);
+
+  /**
+   * Settle on the last entry at or before idx_ of the read-latched leaf or of the leaves to its left, and release the
+   * leaf. The leaves to the left are searched for the last key below key, or for their last key if key is nullptr.
+   */
+  void SettleBackward(Page *page, const KeyType *key);
+
+  /**
+   * Take the entry at idx_ of the read-latched leaf as the current one, unless it is beyond the far bound, which ends
+   * the iterator. The leaf is released.
+   */
+  void SetItem(Page *page);
+
+  /** End the iterator and release the read-latched leaf. */
+  void SetEnd(Page *page);
+
+  /** @return the index of the first key of the leaf greater than the key of the current entry */
+  int IndexAfterItem(const LeafPage *leaf) const;
+
+  /** @return whether no key of the leaves right of the leaf (or left of it, if reverse_) is within the far bound */
+  bool RangeEndsIn(const LeafPage *leaf) const;
+
   // add your own private member variables here
     page_id_t  cur_page_id_;
     int   idx_;
+    // the current entry, copied out of the leaf; pages keyed by IntKey do not store (key, value) pairs
+    MappingType item_;
+    // the values of the current key if it has a posting list, and the index of the current one among them
+    std::vector<ValueType> values_;
+    size_t value_idx_;
     BufferPoolManager *buffer_pool_manager_;
+    const KeyComparator *comparator_;
+    // whether the tree is unique, whose values are never posting list references
+    bool unique_;
+    bool reverse_;
+    // the bound the iterator moves towards, the high key (or the low key, if reverse_) of the range
+    bool has_bound_;
+    bool bound_inclusive_;
+    KeyType bound_;
 };
 
 }  // namespace bustub
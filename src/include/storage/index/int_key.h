@@ -0,0 +1,134 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// int_key.h
+//
+// Identification: src/include/storage/index/int_key.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * Key of a single INTEGER (KeySize 4) or BIGINT (KeySize 8) column.
+ *
+ * B+ tree pages keyed by IntKey keep their keys in a contiguous array, separate from the values, and search it with
+ * SIMD compares (see BPlusTreePageEntries). They always order keys by their integer value. Catalog::CreateIndex()
+ * keys B+ tree indexes on a single INTEGER or BIGINT column by IntKey.
+ */
+template <size_t KeySize>
+class IntKey {
+  static_assert(KeySize == 4 || KeySize == 8, "IntKey holds an INTEGER or a BIGINT");
+
+ public:
+  using IntType = std::conditional_t<KeySize == 4, int32_t, int64_t>;
+
+  inline void SetFromKey(const Tuple &tuple) { memcpy(&value_, tuple.GetData(), KeySize); }
+
+  /** IntKeys already compare natively, they have no separate normalized form. */
+  inline void SetNormalizedFromKey(const Tuple &tuple, const Schema *key_schema) { SetFromKey(tuple); }
+  inline void SetNormalizedPrefixFromKey(const Tuple &tuple, const Schema *key_schema, uint32_t column_count,
+                                         bool max) {
+    SetFromKey(tuple);
+  }
+
+  /** @return the value of the key, an IntKey holds the only column of its key schema */
+  inline Value ToValue(Schema *schema, uint32_t column_idx) const {
+    return Value(schema->GetColumn(column_idx).GetType(), value_);
+  }
+  inline Value ToNormalizedValue(const Schema *key_schema, uint32_t column_idx) const {
+    return ToValue(const_cast<Schema *>(key_schema), column_idx);
+  }
+
+  static bool CanNormalize(const Schema *key_schema) { return false; }
+
+  // NOTE: for test purpose only
+  inline void SetFromInteger(int64_t key) { value_ = static_cast<IntType>(key); }
+
+  inline IntType GetValue() const { return value_; }
+
+  // NOTE: for test purpose only
+  inline int64_t ToString() const { return value_; }
+
+  // NOTE: for test purpose only
+  friend std::ostream &operator<<(std::ostream &os, const IntKey &key) {
+    os << key.ToString();
+    return os;
+  }
+
+  IntType value_;
+};
+
+/**
+ * Function object comparing IntKeys by value.
+ */
+template <size_t KeySize>
+class IntKeyComparator {
+ public:
+  inline int operator()(const IntKey<KeySize> &lhs, const IntKey<KeySize> &rhs) const {
+    return (lhs.value_ > rhs.value_) - (lhs.value_ < rhs.value_);
+  }
+
+  /** Takes the same arguments as GenericComparator, both are ignored. */
+  explicit IntKeyComparator(Schema *key_schema = nullptr, bool normalized = false) {}
+
+  inline bool IsNormalized() const { return false; }
+};
+
+/**
+ * Count the keys of a sorted run that are smaller than (or_equal: not greater than) the given key, that is the
+ * lower (upper) bound of the key in the run. Compares 8 (AVX2) or 4 (SSE4.2) 32-bit keys, or 4 (AVX2) or 2 (SSE4.2)
+ * 64-bit keys per instruction, depending on what the build targets.
+ */
+template <typename IntType>
+inline int CountKeysBelow(const IntType *keys, int n, IntType key, bool or_equal) {
+  // counting the keys greater than the key covers both bounds: n - greater is the upper bound, and for the lower
+  // bound the keys equal to the key are counted separately
+  int greater = 0;
+  int equal = 0;
+  int i = 0;
+#if defined(__AVX2__)
+  constexpr int lanes = 32 / sizeof(IntType);
+  const __m256i needle = sizeof(IntType) == 4 ? _mm256_set1_epi32(key) : _mm256_set1_epi64x(key);
+  for (; i + lanes <= n; i += lanes) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+    __m256i gt = sizeof(IntType) == 4 ? _mm256_cmpgt_epi32(block, needle) : _mm256_cmpgt_epi64(block, needle);
+    __m256i eq = sizeof(IntType) == 4 ? _mm256_cmpeq_epi32(block, needle) : _mm256_cmpeq_epi64(block, needle);
+    greater += __builtin_popcount(_mm256_movemask_epi8(gt)) / sizeof(IntType);
+    equal += __builtin_popcount(_mm256_movemask_epi8(eq)) / sizeof(IntType);
+  }
+#elif defined(__SSE4_2__)
+  constexpr int lanes = 16 / sizeof(IntType);
+  const __m128i needle = sizeof(IntType) == 4 ? _mm_set1_epi32(key) : _mm_set1_epi64x(key);
+  for (; i + lanes <= n; i += lanes) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+    __m128i gt = sizeof(IntType) == 4 ? _mm_cmpgt_epi32(block, needle) : _mm_cmpgt_epi64(block, needle);
+    __m128i eq = sizeof(IntType) == 4 ? _mm_cmpeq_epi32(block, needle) : _mm_cmpeq_epi64(block, needle);
+    greater += __builtin_popcount(_mm_movemask_epi8(gt)) / sizeof(IntType);
+    equal += __builtin_popcount(_mm_movemask_epi8(eq)) / sizeof(IntType);
+  }
+#endif
+  for (; i < n; i++) {
+    greater += keys[i] > key ? 1 : 0;
+    equal += keys[i] == key ? 1 : 0;
+  }
+  return or_equal ? n - greater : n - greater - equal;
+}
+
+}  // namespace bustub
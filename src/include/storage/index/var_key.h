@@ -0,0 +1,123 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// var_key.h
+//
+// Identification: src/include/storage/index/var_key.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+#include "common/exception.h"
+#include "storage/table/tuple.h"
+#include "type/value.h"
+
+namespace bustub {
+
+/**
+ * Key of variable length: the key tuple as it is serialized, with its length, up to KeySize bytes.
+ *
+ * Unlike GenericKey, B+ tree pages keyed by VarKey store only the bytes a key has, in a slot directory (see
+ * BPlusTreePageEntries), so KeySize is only the bound of the longest key: short keys pack densely, and a long
+ * VARCHAR key is stored whole instead of being truncated to a fixed key size.
+ */
+template <size_t KeySize>
+class VarKey {
+  static_assert(KeySize <= UINT16_MAX, "VarKey lengths are 16-bit");
+
+ public:
+  /** Set the key to the key tuple, which must not be longer than KeySize. */
+  inline void SetFromKey(const Tuple &tuple) {
+    if (tuple.GetLength() > KeySize) {
+      throw Exception(ExceptionType::OUT_OF_RANGE, "key tuple is longer than the VarKey");
+    }
+    size_ = static_cast<uint16_t>(tuple.GetLength());
+    memcpy(data_, tuple.GetData(), size_);
+  }
+
+  /** VarKeys are always compared column by column, they have no separate normalized form. */
+  inline void SetNormalizedFromKey(const Tuple &tuple, const Schema *key_schema) { SetFromKey(tuple); }
+  inline void SetNormalizedPrefixFromKey(const Tuple &tuple, const Schema *key_schema, uint32_t column_count,
+                                         bool max) {
+    SetFromKey(tuple);
+  }
+
+  inline Value ToValue(Schema *schema, uint32_t column_idx) const {
+    const auto &col = schema->GetColumn(column_idx);
+    const char *data_ptr = data_ + col.GetOffset();
+    if (!col.IsInlined()) {
+      int32_t offset;
+      memcpy(&offset, data_ptr, sizeof(offset));
+      data_ptr = data_ + offset;
+    }
+    return Value::DeserializeFrom(data_ptr, col.GetType());
+  }
+  inline Value ToNormalizedValue(const Schema *key_schema, uint32_t column_idx) const {
+    return ToValue(const_cast<Schema *>(key_schema), column_idx);
+  }
+
+  static bool CanNormalize(const Schema *key_schema) { return false; }
+
+  // NOTE: for test purpose only
+  inline void SetFromInteger(int64_t key) {
+    size_ = sizeof(int64_t);
+    memcpy(data_, &key, sizeof(int64_t));
+  }
+
+  // NOTE: for test purpose only
+  // interpret the first 8 bytes as int64_t from data vector
+  inline int64_t ToString() const {
+    int64_t value = 0;
+    memcpy(&value, data_, std::min<size_t>(size_, sizeof(value)));
+    return value;
+  }
+
+  // NOTE: for test purpose only
+  friend std::ostream &operator<<(std::ostream &os, const VarKey &key) {
+    os << key.ToString();
+    return os;
+  }
+
+  // the number of bytes of data_ that are set
+  uint16_t size_;
+  char data_[KeySize];
+};
+
+/**
+ * Function object comparing VarKeys column by column, as GenericComparator compares keys that are not normalized.
+ */
+template <size_t KeySize>
+class VarKeyComparator {
+ public:
+  inline int operator()(const VarKey<KeySize> &lhs, const VarKey<KeySize> &rhs) const {
+    uint32_t column_count = key_schema_->GetColumnCount();
+    for (uint32_t i = 0; i < column_count; i++) {
+      Value lhs_value = lhs.ToValue(key_schema_, i);
+      Value rhs_value = rhs.ToValue(key_schema_, i);
+      if (lhs_value.CompareLessThan(rhs_value) == CmpBool::CmpTrue) {
+        return -1;
+      }
+      if (lhs_value.CompareGreaterThan(rhs_value) == CmpBool::CmpTrue) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  /** Takes the same arguments as GenericComparator, VarKeys are never normalized. */
+  explicit VarKeyComparator(Schema *key_schema, bool normalized = false) : key_schema_(key_schema) {}
+
+  inline bool IsNormalized() const { return false; }
+
+ private:
+  Schema *key_schema_;
+};
+
+}  // namespace bustub
@@ -13,12 +13,13 @@
 #include <queue>
 
 #include "storage/page/b_plus_tree_page.h"
+#include "storage/page/b_plus_tree_page_entries.h"
 
 namespace bustub {
 
 #define B_PLUS_TREE_INTERNAL_PAGE_TYPE BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>
-#define INTERNAL_PAGE_HEADER_SIZE 24
-#define INTERNAL_PAGE_SIZE ((PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (sizeof(MappingType)))
+#define INTERNAL_PAGE_HEADER_SIZE (28 + sizeof(KeyType))
+#define INTERNAL_PAGE_SIZE (BPlusTreePageEntries<KeyType, ValueType, INTERNAL_PAGE_HEADER_SIZE>::MAX_SIZE)
 /**
  * Store n indexed keys and n+1 child pointers (page_id) within internal page.
  * Pointer PAGE_ID(i) points to a subtree in which all keys K satisfy:
@@ -31,29 +32,51 @@ namespace bustub {
  *  --------------------------------------------------------------------------
  * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
  *  --------------------------------------------------------------------------
+ *
+ * The header is the one of BPlusTreePage followed by the high key of the page.
+ *
+ * Pages keyed by IntKey store all keys before all page ids instead, pages keyed by GenericKey store compressed keys,
+ * and pages keyed by VarKey store keys of variable length, see BPlusTreePageEntries and BPlusTreeLeafPage.
  */
  const int INVALID_VALUE_INDEX = -1;    // invalid value index
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeInternalPage : public BPlusTreePage {
  public:
   // must call initialize method after "create" a new node
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = INTERNAL_PAGE_SIZE);
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = INTERNAL_PAGE_SIZE,
+            const KeyComparator *comparator = nullptr);
+
+  const KeyType &GetHighKey() const { return high_key_; }
+  void SetHighKey(const KeyType &high_key) { high_key_ = high_key; }
+  const KeyType *GetLowKey() const { return entries_.LowKey(); }
+  void SetKeyRange(const KeyType *low_key, int max_size);
+  int MaxSizeFor(const KeyType *low_key, const KeyType *high_key, int max_size) const;
+  // see BPlusTreeLeafPage::UpdateMaxSize()
+  void UpdateMaxSize(int max_size);
+  // whether the key is not below the high key, that is it belongs to a right sibling
+  bool ShouldMoveRight(const KeyType &key, const KeyComparator &comparator) const {
+    return HasHighKey() && comparator(key, high_key_) >= 0;
+  }
 
   KeyType KeyAt(int index) const;
   void SetKeyAt(int index, const KeyType &key);
   int ValueIndex(const ValueType &value) const;
   ValueType ValueAt(int index) const;
+  void SetValueAt(int index, const ValueType &value);
   ValueType FindSibling(const ValueType& value) const;
 
   ValueType Lookup(const KeyType &key, const KeyComparator &comparator) const;
   void PopulateNewRoot(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
   int InsertNodeAfter(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
+  // append an entry after the last one, for pages filled in key order; the key of the first entry is not used
+  void Append(const KeyType &key, const ValueType &value);
   void Remove(int index);
   ValueType RemoveAndReturnOnlyChild();
 
   // Split and Merge utility methods
   void MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key, BufferPoolManager *buffer_pool_manager);
   void MoveHalfTo(BPlusTreeInternalPage *recipient, BufferPoolManager *buffer_pool_manager);
+  void MoveTailTo(BPlusTreeInternalPage *recipient, int index, BufferPoolManager *buffer_pool_manager);
   void MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                         BufferPoolManager *buffer_pool_manager);
   void MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
@@ -61,10 +84,11 @@ class BPlusTreeInternalPage : public BPlusTreePage {
 
 
  private:
-  void CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager);
+  void CopyNFrom(const BPlusTreeInternalPage *donor, int index, int size, BufferPoolManager *buffer_pool_manager);
   void CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
   void CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
 
-  MappingType array[0];
+  KeyType high_key_;
+  BPlusTreePageEntries<KeyType, ValueType, INTERNAL_PAGE_HEADER_SIZE> entries_;
 };
 }  // namespace bustub
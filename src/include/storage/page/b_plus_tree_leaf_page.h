@@ -14,43 +14,80 @@
 #include <vector>
 
 #include "storage/page/b_plus_tree_page.h"
+#include "storage/page/b_plus_tree_page_entries.h"
 
 namespace bustub {
 
 #define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>
-#define LEAF_PAGE_HEADER_SIZE 28
-#define LEAF_PAGE_SIZE ((PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
+#define LEAF_PAGE_HEADER_SIZE (40 + sizeof(KeyType))
+// one entry stays free for the insert that overflows a full leaf right before it is split
+#define LEAF_PAGE_SIZE (BPlusTreePageEntries<KeyType, ValueType, LEAF_PAGE_HEADER_SIZE>::MAX_SIZE - 1)
 
 /**
  * Store indexed key and record id(record id = page id combined with slot id,
  * see include/common/rid.h for detailed implementation) together within leaf
- * page. Only support unique key.
+ * page. Keys are unique within the tree, the RIDs of a key of a non-unique tree are kept in a posting list the entry
+ * of the key references (see BPlusTreePostingPage).
  *
  * Leaf page format (keys are stored in order):
  *  ----------------------------------------------------------------------
  * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
  *  ----------------------------------------------------------------------
  *
- *  Header format (size in byte, 28 bytes in total):
+ *  Header format (size in byte, 40 bytes + key size in total):
  *  ---------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  *  ---------------------------------------------------------------------
- *  -----------------------------------------------
- * | ParentPageId (4) | PageId (4) | NextPageId (4)
- *  -----------------------------------------------
+ *  ---------------------------------------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | PrevPageId (4) | Version (8) | HighKey (key) |
+ *  ---------------------------------------------------------------------------------------------
+ *
+ * The prev-link of a leaf is a hint for reverse scans: it is updated when the left sibling splits or is merged
+ * away, but only under the latch of the leaf, so a reader following it must check it reached the left sibling.
+ *
+ * The version of a leaf changes whenever entries move in or out of it by a split, merge or redistribution, so that
+ * a page id and version remembered from an earlier visit still locate the leaf of a key as long as they match (see
+ * BPlusTree::SetAdaptiveHashIndex()). Inserts and removes of entries within the leaf keep it.
+ *
+ * Pages keyed by IntKey store all keys before all RIDs instead, pages keyed by GenericKey store compressed keys, and
+ * pages keyed by VarKey store keys of variable length in a slot directory, see BPlusTreePageEntries. The max size of
+ * a page with compressed or variable-length keys is the max size of the tree, or as many entries as fit the page for
+ * its key range and keys if that is less.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeLeafPage : public BPlusTreePage {
  public:
   // After creating a new leaf page from buffer pool, must call initialize
   // method to set default values
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = LEAF_PAGE_SIZE);
+  // keys are compressed as the comparator allows, see BPlusTreePageEntries
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = LEAF_PAGE_SIZE,
+            const KeyComparator *comparator = nullptr);
   // helper methods
-  page_id_t GetNextPageId() const;
-  void SetNextPageId(page_id_t next_page_id);
+  const KeyType &GetHighKey() const { return high_key_; }
+  void SetHighKey(const KeyType &high_key) { high_key_ = high_key; }
+  page_id_t GetPrevPageId() const { return prev_page_id_; }
+  void SetPrevPageId(page_id_t prev_page_id) { prev_page_id_ = prev_page_id; }
+  uint64_t GetVersion() const { return version_; }
+  // mark a change of the entries the leaf holds, other than an insert or remove of one of its keys
+  void BumpVersion() { version_++; }
+  // the low key, only kept by pages that compress keys, nullptr if there is none
+  const KeyType *GetLowKey() const { return entries_.LowKey(); }
+  // set the key range to [low_key, high key), once the right-link and the high key are set
+  void SetKeyRange(const KeyType *low_key, int max_size);
+  // the max size of the page once its key range is [low_key, high_key)
+  int MaxSizeFor(const KeyType *low_key, const KeyType *high_key, int max_size) const;
+  // update the max size after entries were added, removed or replaced, pages of variable-length keys fit more
+  // entries the shorter their keys are
+  void UpdateMaxSize(int max_size);
+  // whether the key is not below the high key, that is it belongs to a right sibling
+  bool ShouldMoveRight(const KeyType &key, const KeyComparator &comparator) const {
+    return HasHighKey() && comparator(key, high_key_) >= 0;
+  }
   KeyType KeyAt(int index) const;
   int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
-  const MappingType &GetItem(int index);
+  MappingType GetItem(int index);
+  ValueType ValueAt(int index) const;
+  void SetValueAt(int index, const ValueType &value);
 
   // insert and delete methods
   int Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator);
@@ -58,15 +95,18 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   int RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator);
   // Split and Merge utility methods
   void MoveHalfTo(BPlusTreeLeafPage *recipient);
+  void MoveTailTo(BPlusTreeLeafPage *recipient, int index);
   void MoveAllTo(BPlusTreeLeafPage *recipient);
   void MoveFirstToEndOf(BPlusTreeLeafPage *recipient);
   void MoveLastToFrontOf(BPlusTreeLeafPage *recipient);
 
  private:
-  void CopyNFrom(MappingType *items, int size);
+  void CopyNFrom(const BPlusTreeLeafPage *donor, int index, int size);
   void CopyLastFrom(const MappingType &item);
   void CopyFirstFrom(const MappingType &item);
-  page_id_t next_page_id_;
-  MappingType array[0];
+  page_id_t prev_page_id_;
+  uint64_t version_;
+  KeyType high_key_;
+  BPlusTreePageEntries<KeyType, ValueType, LEAF_PAGE_HEADER_SIZE> entries_;
 };
 }  // namespace bustub
@@ -33,12 +33,17 @@ enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
  * It actually serves as a header part for each B+ tree page and
  * contains information shared by both leaf page and internal page.
  *
- * Header format (size in byte, 24 bytes in total):
+ * Header format (size in byte, 28 bytes in total):
  * ----------------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  * ----------------------------------------------------------------------------
- * | ParentPageId (4) | PageId(4) |
+ * | ParentPageId (4) | PageId(4) | NextPageId (4) |
  * ----------------------------------------------------------------------------
+ *
+ * Pages of every level are linked to their right sibling through NextPageId, and the derived pages store the high
+ * key of the page after the header, that is the first key of the right sibling (Lehman & Yao's B-link tree). A page
+ * without a right sibling has no high key. A reader that reaches a page after it was split, but before the split
+ * was posted to the parent, moves right while its key is not below the high key, see ShouldMoveRight().
  */
 class BPlusTreePage {
  public:
@@ -60,6 +65,11 @@ class BPlusTreePage {
   page_id_t GetPageId() const;
   void SetPageId(page_id_t page_id);
 
+  page_id_t GetNextPageId() const;
+  void SetNextPageId(page_id_t next_page_id);
+  // the high key is only valid if there is a right sibling
+  bool HasHighKey() const { return next_page_id_ != INVALID_PAGE_ID; }
+
   void SetLSN(lsn_t lsn = INVALID_LSN);
 
  private:
@@ -70,6 +80,7 @@ class BPlusTreePage {
   int max_size_ __attribute__((__unused__));
   page_id_t parent_page_id_ __attribute__((__unused__));
   page_id_t page_id_ __attribute__((__unused__));
+  page_id_t next_page_id_ __attribute__((__unused__));
 };
 
 }  // namespace bustub
@@ -0,0 +1,555 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_page_entries.h
+//
+// Identification: src/include/storage/page/b_plus_tree_page_entries.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "common/config.h"
+#include "storage/index/generic_key.h"
+#include "storage/index/int_key.h"
+#include "storage/index/var_key.h"
+
+namespace bustub {
+
+/**
+ * The key & value entries of a B+ tree page, which fill the page after its header of HeaderSize bytes.
+ *
+ * Leaf and internal pages only touch their entries through this class, so that the storage layout can be chosen by
+ * key type. By default the entries are an array of (key, value) pairs, searched with a branch-free binary search that
+ * calls the comparator once per probe.
+ *
+ * The capacity of a page only changes with its key range, except for pages keyed by VarKey, whose capacity follows
+ * the bytes its entries take.
+ */
+template <typename KeyType, typename ValueType, size_t HeaderSize>
+class BPlusTreePageEntries {
+  static constexpr int CAPACITY = (PAGE_SIZE - HeaderSize) / sizeof(MappingType);
+
+ public:
+  /** The most entries a page may hold. */
+  static constexpr int MAX_SIZE = CAPACITY;
+
+  /**
+   * Keys are stored as they are, whatever the comparator and key range of the page: the page always holds CAPACITY
+   * entries, and has no low key.
+   */
+  template <typename KeyComparator>
+  inline void Init(const KeyComparator *comparator) {}
+  inline int Capacity() const { return CAPACITY; }
+  inline int CapacityFor(const KeyType *low_key, const KeyType *high_key) const { return CAPACITY; }
+  inline const KeyType *LowKey() const { return nullptr; }
+  inline void SetKeyRange(const KeyType *low_key, const KeyType *high_key, int size) {}
+
+  inline const KeyType &KeyAt(int index) const { return array_[index].first; }
+  inline void SetKeyAt(int index, const KeyType &key) { array_[index].first = key; }
+  inline const ValueType &ValueAt(int index) const { return array_[index].second; }
+  inline void SetValueAt(int index, const ValueType &value) { array_[index].second = value; }
+  inline MappingType ItemAt(int index) const { return array_[index]; }
+  inline void SetItemAt(int index, const MappingType &item) { array_[index] = item; }
+
+  /** Move the size entries starting at from to start at to, the ranges may overlap. */
+  inline void Move(int to, int from, int size) {
+    if (to < from) {
+      std::move(array_ + from, array_ + from + size, array_ + to);
+    } else {
+      std::move_backward(array_ + from, array_ + from + size, array_ + to + size);
+    }
+  }
+
+  /** Copy the size entries of another page starting at from to start at to. */
+  inline void CopyFrom(int to, const BPlusTreePageEntries &other, int from, int size) {
+    std::copy(other.array_ + from, other.array_ + from + size, array_ + to);
+  }
+
+  /**
+   * @return the first index i in [begin, end) so that KeyAt(i) >= key (or_equal: KeyAt(i) > key), end if there is none
+   * The candidate range is halved without an early exit, so that every probe costs exactly one comparator call and
+   * the loop body compiles to a conditional move rather than a data-dependent branch.
+   */
+  template <typename KeyComparator>
+  inline int Search(int begin, int end, const KeyType &key, const KeyComparator &comparator, bool or_equal) const {
+    int n = end - begin;
+    if (n <= 0) {
+      return begin;
+    }
+    const int limit = or_equal ? 0 : -1;
+    const MappingType *base = array_ + begin;
+    while (n > 1) {
+      int half = n / 2;
+      base = comparator(base[half].first, key) <= limit ? base + half : base;
+      n -= half;
+    }
+    return static_cast<int>(base - array_) + (comparator(base->first, key) <= limit ? 1 : 0);
+  }
+
+ private:
+  MappingType array_[0];
+};
+
+/**
+ * Entries of pages keyed by IntKey: all keys in one contiguous array followed by all values, so that a search only
+ * touches key bytes and compares several keys per SIMD instruction.
+ *
+ * The arrays hold as many entries as fit the page. A search narrows the range by binary search until it fits a few
+ * SIMD registers, and then counts the keys below the search key in it (see CountKeysBelow()). The comparator is not
+ * called, IntKey pages are always ordered by integer value.
+ */
+template <size_t KeySize, typename ValueType, size_t HeaderSize>
+class BPlusTreePageEntries<IntKey<KeySize>, ValueType, HeaderSize> {
+  using KeyType = IntKey<KeySize>;
+  using IntType = typename KeyType::IntType;
+  static constexpr size_t ENTRIES_OFFSET = (HeaderSize + alignof(KeyType) - 1) / alignof(KeyType) * alignof(KeyType);
+  static constexpr int CAPACITY = (PAGE_SIZE - ENTRIES_OFFSET) / (sizeof(KeyType) + sizeof(ValueType));
+  /** Ranges of up to this many keys are scanned with SIMD compares instead of being halved further. */
+  static constexpr int SCAN_KEYS = 64 / sizeof(IntType);
+
+ public:
+  static constexpr int MAX_SIZE = CAPACITY;
+
+  template <typename KeyComparator>
+  inline void Init(const KeyComparator *comparator) {}
+  inline int Capacity() const { return CAPACITY; }
+  inline int CapacityFor(const KeyType *low_key, const KeyType *high_key) const { return CAPACITY; }
+  inline const KeyType *LowKey() const { return nullptr; }
+  inline void SetKeyRange(const KeyType *low_key, const KeyType *high_key, int size) {}
+
+  inline const KeyType &KeyAt(int index) const { return keys_[index]; }
+  inline void SetKeyAt(int index, const KeyType &key) { keys_[index] = key; }
+  inline const ValueType &ValueAt(int index) const { return values_[index]; }
+  inline void SetValueAt(int index, const ValueType &value) { values_[index] = value; }
+  inline MappingType ItemAt(int index) const { return {keys_[index], values_[index]}; }
+  inline void SetItemAt(int index, const MappingType &item) {
+    keys_[index] = item.first;
+    values_[index] = item.second;
+  }
+
+  inline void Move(int to, int from, int size) {
+    memmove(static_cast<void *>(keys_ + to), keys_ + from, size * sizeof(KeyType));
+    memmove(static_cast<void *>(values_ + to), values_ + from, size * sizeof(ValueType));
+  }
+
+  inline void CopyFrom(int to, const BPlusTreePageEntries &other, int from, int size) {
+    memcpy(static_cast<void *>(keys_ + to), other.keys_ + from, size * sizeof(KeyType));
+    memcpy(static_cast<void *>(values_ + to), other.values_ + from, size * sizeof(ValueType));
+  }
+
+  template <typename KeyComparator>
+  inline int Search(int begin, int end, const KeyType &key, const KeyComparator &comparator, bool or_equal) const {
+    const IntType needle = key.value_;
+    int n = end - begin;
+    const KeyType *base = keys_ + begin;
+    while (n > SCAN_KEYS) {
+      int half = n / 2;
+      base = (or_equal ? base[half].value_ <= needle : base[half].value_ < needle) ? base + half : base;
+      n -= half;
+    }
+    static_assert(sizeof(KeyType) == sizeof(IntType), "IntKey must be a plain integer");
+    return static_cast<int>(base - keys_) +
+           CountKeysBelow(reinterpret_cast<const IntType *>(base), std::max(n, 0), needle, or_equal);
+  }
+
+ private:
+  KeyType keys_[CAPACITY];
+  ValueType values_[CAPACITY];
+};
+
+/**
+ * Entries of pages keyed by GenericKey, compressed so that a page holds as many of them as the actual keys allow:
+ *
+ * - Only the first KeyLength() bytes of a key are stored (see GenericComparator), the rest of a GenericKey is zero
+ *   padding. An index on an INTEGER column stores 5 bytes of every GenericKey<64>.
+ * - For normalized keys, which are ordered byte by byte, every key of the key range [low key, high key) of the page
+ *   starts with the common prefix of the two fences, and this prefix is stored once instead of in every key (a
+ *   prefix B-tree). The page keeps its low key for that, the high key is kept by the page itself; the first page of
+ *   a level has no low key, the last one no high key, and neither compresses a prefix.
+ *
+ * Every entry is the remaining suffix of its key followed by its value, so the number of entries that fit the page
+ * changes with its key range: the prefix only grows when the range shrinks (a split), and the tree checks the
+ * capacity of a page for its new key range before the range grows (a merge or redistribution).
+ * Searches of normalized keys compare the search key with the prefix once, and then with the stored suffixes only.
+ */
+template <size_t KeySize, typename ValueType, size_t HeaderSize>
+class BPlusTreePageEntries<GenericKey<KeySize>, ValueType, HeaderSize> {
+  using KeyType = GenericKey<KeySize>;
+  static constexpr size_t DATA_SIZE = PAGE_SIZE - HeaderSize - 2 * sizeof(uint16_t) - 2 * sizeof(bool) - KeySize;
+
+ public:
+  /** The most entries a page may hold, once all of their bytes are in the prefix. */
+  static constexpr int MAX_SIZE = DATA_SIZE / sizeof(ValueType);
+
+  /**
+   * Store keys as the comparator allows: the first KeyLength() bytes of them, and their common prefix once if they
+   * are normalized. Without comparator every byte of the keys is stored. The page has no key range yet.
+   */
+  template <typename KeyComparator>
+  inline void Init(const KeyComparator *comparator) {
+    key_size_ = nullptr == comparator ? KeySize : comparator->KeyLength();
+    prefix_size_ = 0;
+    compress_prefix_ = nullptr != comparator && comparator->IsNormalized();
+    has_low_key_ = false;
+  }
+
+  /** @return the most entries that fit the page at its current key range */
+  inline int Capacity() const { return CapacityOf(prefix_size_); }
+
+  /** @return the most entries that fit the page once its key range is [low_key, high_key) */
+  inline int CapacityFor(const KeyType *low_key, const KeyType *high_key) const {
+    return CapacityOf(PrefixSize(low_key, high_key));
+  }
+
+  inline const KeyType *LowKey() const { return has_low_key_ ? &low_key_ : nullptr; }
+
+  /**
+   * Set the key range of the page to [low_key, high_key), either is nullptr if the range is unbounded on that side,
+   * and encode the first size entries for it. All of them must be in the range, and fit the page.
+   */
+  inline void SetKeyRange(const KeyType *low_key, const KeyType *high_key, int size) {
+    int prefix_size = PrefixSize(low_key, high_key);
+    // the bytes that leave the prefix are taken from the old low key, they are the same in every key of the range
+    if (prefix_size > prefix_size_) {
+      int drop = prefix_size - prefix_size_;
+      for (int i = 0; i < size; i++) {
+        memmove(data_ + i * EntrySize(prefix_size), data_ + i * EntrySize() + drop, EntrySize(prefix_size));
+      }
+    } else if (prefix_size < prefix_size_) {
+      int add = prefix_size_ - prefix_size;
+      for (int i = size - 1; i >= 0; i--) {
+        char *entry = data_ + i * EntrySize(prefix_size);
+        memmove(entry + add, data_ + i * EntrySize(), EntrySize());
+        memcpy(entry, low_key_.data_ + prefix_size, add);
+      }
+    }
+    prefix_size_ = prefix_size;
+    has_low_key_ = nullptr != low_key;
+    if (has_low_key_ && low_key != &low_key_) {
+      low_key_ = *low_key;
+    }
+  }
+
+  inline KeyType KeyAt(int index) const {
+    KeyType key;
+    memcpy(key.data_, low_key_.data_, prefix_size_);
+    memcpy(key.data_ + prefix_size_, data_ + index * EntrySize(), SuffixSize());
+    memset(key.data_ + key_size_, 0, KeySize - key_size_);
+    return key;
+  }
+  inline void SetKeyAt(int index, const KeyType &key) {
+    memcpy(data_ + index * EntrySize(), key.data_ + prefix_size_, SuffixSize());
+  }
+  inline ValueType ValueAt(int index) const {
+    ValueType value;
+    memcpy(static_cast<void *>(&value), data_ + index * EntrySize() + SuffixSize(), sizeof(ValueType));
+    return value;
+  }
+  inline void SetValueAt(int index, const ValueType &value) {
+    memcpy(data_ + index * EntrySize() + SuffixSize(), static_cast<const void *>(&value), sizeof(ValueType));
+  }
+  inline MappingType ItemAt(int index) const { return {KeyAt(index), ValueAt(index)}; }
+  inline void SetItemAt(int index, const MappingType &item) {
+    SetKeyAt(index, item.first);
+    SetValueAt(index, item.second);
+  }
+
+  inline void Move(int to, int from, int size) {
+    memmove(data_ + to * EntrySize(), data_ + from * EntrySize(), size * EntrySize());
+  }
+
+  inline void CopyFrom(int to, const BPlusTreePageEntries &other, int from, int size) {
+    if (other.key_size_ == key_size_ && other.prefix_size_ == prefix_size_) {
+      memcpy(data_ + to * EntrySize(), other.data_ + from * EntrySize(), size * EntrySize());
+      return;
+    }
+    for (int i = 0; i < size; i++) {
+      SetItemAt(to + i, other.ItemAt(from + i));
+    }
+  }
+
+  template <typename KeyComparator>
+  inline int Search(int begin, int end, const KeyType &key, const KeyComparator &comparator, bool or_equal) const {
+    int n = end - begin;
+    if (n <= 0) {
+      return begin;
+    }
+    const int limit = or_equal ? 0 : -1;
+    int base = begin;
+    if (!comparator.IsNormalized()) {
+      while (n > 1) {
+        int half = n / 2;
+        base = comparator(KeyAt(base + half), key) <= limit ? base + half : base;
+        n -= half;
+      }
+      return base + (comparator(KeyAt(base), key) <= limit ? 1 : 0);
+    }
+    // a key outside of the prefix is before or after every key of the page
+    int cmp = memcmp(key.data_, low_key_.data_, prefix_size_);
+    if (cmp != 0) {
+      return cmp < 0 ? begin : end;
+    }
+    const char *suffix = key.data_ + prefix_size_;
+    const size_t suffix_size = SuffixSize();
+    const size_t entry_size = EntrySize();
+    // a search key with bytes after the stored ones is greater than a stored key with the same suffix
+    const bool longer = std::any_of(key.data_ + key_size_, key.data_ + KeySize, [](char c) { return c != 0; });
+    auto compare = [&](int index) {
+      int c = memcmp(data_ + index * entry_size, suffix, suffix_size);
+      return c != 0 ? c : (longer ? -1 : 0);
+    };
+    while (n > 1) {
+      int half = n / 2;
+      base = compare(base + half) <= limit ? base + half : base;
+      n -= half;
+    }
+    return base + (compare(base) <= limit ? 1 : 0);
+  }
+
+ private:
+  inline size_t SuffixSize() const { return key_size_ - prefix_size_; }
+  inline size_t EntrySize(int prefix_size) const { return key_size_ - prefix_size + sizeof(ValueType); }
+  inline size_t EntrySize() const { return EntrySize(prefix_size_); }
+  inline int CapacityOf(int prefix_size) const { return DATA_SIZE / EntrySize(prefix_size); }
+
+  inline int PrefixSize(const KeyType *low_key, const KeyType *high_key) const {
+    if (!compress_prefix_ || nullptr == low_key || nullptr == high_key) {
+      return 0;
+    }
+    int size = 0;
+    while (size < key_size_ && low_key->data_[size] == high_key->data_[size]) {
+      size++;
+    }
+    return size;
+  }
+
+  uint16_t key_size_;
+  uint16_t prefix_size_;
+  bool compress_prefix_;
+  bool has_low_key_;
+  KeyType low_key_;
+  char data_[DATA_SIZE];
+};
+
+
+/**
+ * Entries of pages keyed by VarKey, in a slot directory like the one of TablePage: the slots grow from the start of
+ * the page, each with the offset and length of its key and the value, and the key bytes grow from the end of the
+ * page. A key takes only the bytes it has.
+ *
+ * Every slot owns the bytes of its key. A key that is replaced or removed leaves a hole, which is reclaimed when a
+ * key does not fit in front of the keys anymore: the keys are then compacted to the end of the page. Entries moved
+ * to another page leave their slots behind, past the size of the page; those are released when the key range of
+ * the page is set, which the tree does after every such move.
+ *
+ * The capacity of the page is the number of its entries plus the number of entries with the longest key that still
+ * fit, less one: an internal page can then always take a longer separator in place of one of its keys. Inserting
+ * an entry never lowers the capacity, but removing one, or replacing a key by a longer one, may lower it by one, so
+ * the max size of the page is updated after every change of its entries (see BPlusTreeLeafPage::UpdateMaxSize()).
+ */
+template <size_t KeySize, typename ValueType, size_t HeaderSize>
+class BPlusTreePageEntries<VarKey<KeySize>, ValueType, HeaderSize> {
+  using KeyType = VarKey<KeySize>;
+  static constexpr size_t DATA_SIZE = PAGE_SIZE - HeaderSize - 3 * sizeof(uint16_t);
+  // offset (2) | length (2) | value
+  static constexpr size_t SLOT_SIZE = 2 * sizeof(uint16_t) + sizeof(ValueType);
+  static constexpr size_t MAX_ENTRY_SIZE = SLOT_SIZE + KeySize;
+  static_assert(DATA_SIZE >= 3 * MAX_ENTRY_SIZE, "a page must fit a few of the longest keys");
+
+ public:
+  /** The most entries a page may hold, if all of their keys are empty. */
+  static constexpr int MAX_SIZE = DATA_SIZE / SLOT_SIZE;
+
+  template <typename KeyComparator>
+  inline void Init(const KeyComparator *comparator) {
+    slot_count_ = 0;
+    keys_begin_ = DATA_SIZE;
+    free_keys_size_ = 0;
+  }
+
+  inline int Capacity() const { return slot_count_ + static_cast<int>(FreeSize() / MAX_ENTRY_SIZE) - 1; }
+  inline int CapacityFor(const KeyType *low_key, const KeyType *high_key) const { return Capacity(); }
+  inline const KeyType *LowKey() const { return nullptr; }
+
+  /** Keys are stored whole whatever the key range, only the slots past the size of the page are released. */
+  inline void SetKeyRange(const KeyType *low_key, const KeyType *high_key, int size) {
+    for (int i = size; i < slot_count_; i++) {
+      Release(i);
+    }
+    slot_count_ = std::min<int>(slot_count_, size);
+  }
+
+  inline KeyType KeyAt(int index) const {
+    KeyType key;
+    key.size_ = 0;
+    if (index < slot_count_) {
+      key.size_ = LengthAt(index);
+      memcpy(key.data_, data_ + OffsetAt(index), key.size_);
+    }
+    return key;
+  }
+  inline void SetKeyAt(int index, const KeyType &key) { Assign(index, key.data_, key.size_); }
+  inline ValueType ValueAt(int index) const {
+    ValueType value;
+    memcpy(static_cast<void *>(&value), data_ + index * SLOT_SIZE + 2 * sizeof(uint16_t), sizeof(ValueType));
+    return value;
+  }
+  inline void SetValueAt(int index, const ValueType &value) {
+    Reserve(index + 1);
+    memcpy(data_ + index * SLOT_SIZE + 2 * sizeof(uint16_t), static_cast<const void *>(&value), sizeof(ValueType));
+  }
+  inline MappingType ItemAt(int index) const { return {KeyAt(index), ValueAt(index)}; }
+  inline void SetItemAt(int index, const MappingType &item) {
+    SetKeyAt(index, item.first);
+    SetValueAt(index, item.second);
+  }
+
+  /**
+   * Move the slots, the keys stay where they are. Moving down drops the entries in [to, from); moving up leaves
+   * [from, to) without keys, to be set by the caller.
+   */
+  inline void Move(int to, int from, int size) {
+    if (to < from) {
+      for (int i = to; i < from; i++) {
+        Release(i);
+      }
+      memmove(data_ + to * SLOT_SIZE, data_ + from * SLOT_SIZE, size * SLOT_SIZE);
+      // the slots behind the moved ones are copies of them now
+      for (int i = to + size; i < std::min<int>(from + size, slot_count_); i++) {
+        SetLengthAt(i, 0);
+      }
+      if (from + size >= slot_count_) {
+        slot_count_ = to + size;
+      }
+    } else if (to > from) {
+      for (int i = std::max(from + size, to); i < to + size; i++) {
+        Release(i);
+      }
+      Reserve(to + size);
+      memmove(data_ + to * SLOT_SIZE, data_ + from * SLOT_SIZE, size * SLOT_SIZE);
+      for (int i = from; i < to; i++) {
+        SetLengthAt(i, 0);
+      }
+    }
+  }
+
+  inline void CopyFrom(int to, const BPlusTreePageEntries &other, int from, int size) {
+    for (int i = 0; i < size; i++) {
+      Assign(to + i, other.data_ + other.OffsetAt(from + i), other.LengthAt(from + i));
+      SetValueAt(to + i, other.ValueAt(from + i));
+    }
+  }
+
+  template <typename KeyComparator>
+  inline int Search(int begin, int end, const KeyType &key, const KeyComparator &comparator, bool or_equal) const {
+    int n = end - begin;
+    if (n <= 0) {
+      return begin;
+    }
+    const int limit = or_equal ? 0 : -1;
+    int base = begin;
+    while (n > 1) {
+      int half = n / 2;
+      base = comparator(KeyAt(base + half), key) <= limit ? base + half : base;
+      n -= half;
+    }
+    return base + (comparator(KeyAt(base), key) <= limit ? 1 : 0);
+  }
+
+ private:
+  inline uint16_t OffsetAt(int index) const {
+    uint16_t offset;
+    memcpy(&offset, data_ + index * SLOT_SIZE, sizeof(offset));
+    return offset;
+  }
+  inline uint16_t LengthAt(int index) const {
+    uint16_t length;
+    memcpy(&length, data_ + index * SLOT_SIZE + sizeof(uint16_t), sizeof(length));
+    return length;
+  }
+  inline void SetOffsetAt(int index, uint16_t offset) { memcpy(data_ + index * SLOT_SIZE, &offset, sizeof(offset)); }
+  inline void SetLengthAt(int index, uint16_t length) {
+    memcpy(data_ + index * SLOT_SIZE + sizeof(uint16_t), &length, sizeof(length));
+  }
+
+  /** @return the bytes not taken by slots or keys, including the holes between keys */
+  inline size_t FreeSize() const { return keys_begin_ - slot_count_ * SLOT_SIZE + free_keys_size_; }
+
+  /** Release the key of a slot, the slot keeps its value. */
+  inline void Release(int index) {
+    if (index >= slot_count_) {
+      return;
+    }
+    uint16_t length = LengthAt(index);
+    if (OffsetAt(index) == keys_begin_) {
+      keys_begin_ += length;
+    } else {
+      free_keys_size_ += length;
+    }
+    SetLengthAt(index, 0);
+  }
+
+  /** Grow the slot directory to count slots, the new ones without key. */
+  inline void Reserve(int count) {
+    if (count <= slot_count_) {
+      return;
+    }
+    if (count * SLOT_SIZE > keys_begin_) {
+      Compact();
+      if (count * SLOT_SIZE > keys_begin_) {
+        throw "B+ tree page overflow";
+      }
+    }
+    memset(data_ + slot_count_ * SLOT_SIZE, 0, (count - slot_count_) * SLOT_SIZE);
+    slot_count_ = count;
+  }
+
+  /** Set the key of a slot to a copy of the given bytes. */
+  inline void Assign(int index, const char *key, uint16_t length) {
+    Reserve(index + 1);
+    Release(index);
+    if (keys_begin_ < slot_count_ * SLOT_SIZE + length) {
+      Compact();
+      if (keys_begin_ < slot_count_ * SLOT_SIZE + length) {
+        throw "B+ tree page overflow";
+      }
+    }
+    keys_begin_ -= length;
+    memcpy(data_ + keys_begin_, key, length);
+    SetOffsetAt(index, keys_begin_);
+    SetLengthAt(index, length);
+  }
+
+  /** Move the keys of all slots to the end of the page, closing the holes between them. */
+  inline void Compact() {
+    char keys[DATA_SIZE];
+    size_t end = DATA_SIZE;
+    for (int i = 0; i < slot_count_; i++) {
+      uint16_t length = LengthAt(i);
+      end -= length;
+      memcpy(keys + end, data_ + OffsetAt(i), length);
+      SetOffsetAt(i, static_cast<uint16_t>(end));
+    }
+    memcpy(data_ + end, keys + end, DATA_SIZE - end);
+    keys_begin_ = static_cast<uint16_t>(end);
+    free_keys_size_ = 0;
+  }
+
+  // the number of slots, including slots past the size of the page that are not released yet
+  uint16_t slot_count_;
+  // the offset of the first key byte, keys are stored from there to the end of the page
+  uint16_t keys_begin_;
+  // the bytes of released keys between keys_begin_ and the end of the page
+  uint16_t free_keys_size_;
+  char data_[DATA_SIZE];
+};
+
+}  // namespace bustub
@@ -0,0 +1,81 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_posting_page.h
+//
+// Identification: src/include/storage/page/b_plus_tree_posting_page.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/config.h"
+#include "common/rid.h"
+
+namespace bustub {
+
+#define POSTING_PAGE_HEADER_SIZE 12
+#define POSTING_PAGE_SIZE ((PAGE_SIZE - POSTING_PAGE_HEADER_SIZE) / sizeof(RID))
+
+/**
+ * Posting list of a key of a non-unique B+ tree: the RIDs of the key, in increasing order, in a chain of posting
+ * pages. The leaf entry of a key with a single RID stores the RID itself, a key with more stores a reference to the
+ * first page of its posting list instead (see Reference()). Each page of the chain holds a sorted run of RIDs, all
+ * of them smaller than the RIDs of the pages after it; a full page is split into two.
+ *
+ * Posting pages are only reached through the leaf entry of their key, so they are protected by the latch of the leaf.
+ *
+ * Posting page format (RIDs are stored in order):
+ *  ----------------------------------------------------------------------------
+ * | PageId (4) | NextPageId (4) | CurrentSize (4) | RID(1) | RID(2) | ... | RID(n)
+ *  ----------------------------------------------------------------------------
+ */
+class BPlusTreePostingPage {
+ public:
+  // After creating a new posting page from buffer pool, must call initialize method to set default values
+  void Init(page_id_t page_id);
+
+  page_id_t GetPageId() const { return page_id_; }
+  page_id_t GetNextPageId() const { return next_page_id_; }
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+  int GetSize() const { return size_; }
+  bool IsFull() const { return size_ >= static_cast<int>(POSTING_PAGE_SIZE); }
+  const RID &ValueAt(int index) const { return values_[index]; }
+
+  // the index of the first RID not smaller than the given one
+  int ValueIndex(const RID &value) const;
+  // insert a RID that is not in the page yet into a page that is not full
+  void Insert(const RID &value);
+  // @return false if the RID is not in the page
+  bool Remove(const RID &value);
+  // move the upper half of the RIDs into an empty page, which is linked in after this one
+  void MoveHalfTo(BPlusTreePostingPage *recipient);
+  // append the RIDs of the page after this one, and unlink it from the chain
+  void MoveAllFrom(BPlusTreePostingPage *donor);
+
+  /** @return the leaf entry value referencing the posting list that starts at the given page */
+  static RID Reference(page_id_t page_id) { return RID(page_id, REFERENCE_SLOT); }
+
+  /** @return whether a leaf entry value references a posting list, instead of being the only RID of its key */
+  static bool IsReference(const RID &value) { return value.GetSlotNum() == REFERENCE_SLOT; }
+
+  /** Append the RIDs of a leaf entry value to the result, reading its posting list if the value references one. */
+  static void ReadValues(const RID &value, BufferPoolManager *buffer_pool_manager, std::vector<RID> *result);
+
+ private:
+  // no table page has this many slots
+  static constexpr uint32_t REFERENCE_SLOT = std::numeric_limits<uint32_t>::max();
+
+  page_id_t page_id_;
+  page_id_t next_page_id_;
+  int size_;
+  RID values_[0];
+};
+
+}  // namespace bustub
@@ -51,6 +51,9 @@ class Page {
   /** Acquire the page write latch. */
   inline void WLatch() { rwlatch_.WLock(); }
 
+  /** Acquire the page write latch if no one holds a latch on the page, without waiting. @return true on success */
+  inline bool TryWLatch() { return rwlatch_.TryWLock(); }
+
   /** Release the page write latch. */
   inline void WUnlatch() { rwlatch_.WUnlock(); }
 
@@ -12,8 +12,10 @@
 
 #include <sys/stat.h>
 #include <cassert>
+#include <chrono>  // NOLINT
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <thread>  // NOLINT
 
@@ -30,7 +32,11 @@ static char *buffer_used;
  * @input db_file: database file name
  */
 DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+    : flush_log_(false), flush_log_f_(nullptr), file_name_(db_file), next_page_id_(0) {
+  // the db file serves every page that no other tablespace claims
+  default_tablespace_ = std::make_unique<Tablespace>(0, std::numeric_limits<page_id_t>::max(),
+                                                     std::vector<std::string>{db_file});
+
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
@@ -52,27 +58,27 @@ DiskManager::DiskManager(const std::string &db_file)
     }
   }
 
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-    if (!db_io_.is_open()) {
-      throw Exception("can't open db file");
-    }
-  }
   buffer_used = nullptr;
 }
 
+/**
+ * Constructor for backends without files: no db file & log file are opened
+ */
+DiskManager::DiskManager()
+    : flush_log_(false), flush_log_f_(nullptr), next_page_id_(0) {}
+
 /**
  * Close all file streams
  */
 void DiskManager::ShutDown() {
-  db_io_.close();
+  if (default_tablespace_ != nullptr) {
+    default_tablespace_->ShutDown();
+  }
+  tablespace_latch_.RLock();
+  for (auto &entry : tablespaces_) {
+    entry.second->ShutDown();
+  }
+  tablespace_latch_.RUnlock();
   log_io_.close();
 }
 
@@ -80,48 +86,25 @@ void DiskManager::ShutDown() {
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
-  // set write cursor to offset
-  num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
-    return;
-  }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  auto start = std::chrono::steady_clock::now();
+  GetTablespace(page_id)->WritePage(page_id, page_data);
+  stats_.RecordWrite(page_id, std::chrono::steady_clock::now() - start);
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    if (db_io_.bad()) {
-      LOG_DEBUG("I/O error while reading");
-      return;
-    }
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
-    }
-  }
+  auto start = std::chrono::steady_clock::now();
+  GetTablespace(page_id)->ReadPage(page_id, page_data);
+  stats_.RecordRead(page_id, std::chrono::steady_clock::now() - start);
 }
 
+/**
+ * Stage the pages of a scan in the read-ahead buffers of the tablespace holding them
+ */
+void DiskManager::Prefetch(page_id_t page_id, int num_pages) { GetTablespace(page_id)->Prefetch(page_id, num_pages); }
+
 /**
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
@@ -142,17 +125,19 @@ void DiskManager::WriteLog(char *log_data, int size) {
     assert(flush_log_f_->wait_for(std::chrono::seconds(10)) == std::future_status::ready);
   }
 
-  num_flushes_ += 1;
+  auto start = std::chrono::steady_clock::now();
   // sequence write
   log_io_.write(log_data, size);
 
   // check for I/O error
   if (log_io_.bad()) {
     LOG_DEBUG("I/O error while writing log");
+    stats_.RecordLogWrite(size, std::chrono::steady_clock::now() - start);
     return;
   }
   // needs to flush to keep disk file in sync
   log_io_.flush();
+  stats_.RecordLogWrite(size, std::chrono::steady_clock::now() - start);
   flush_log_ = false;
 }
 
@@ -197,15 +182,81 @@ page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
  */
 void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {}
 
+/**
+ * Add a tablespace serving the page ids [start_page_id, end_page_id)
+ */
+void DiskManager::AddTablespace(page_id_t start_page_id, page_id_t end_page_id,
+                                const std::vector<std::string> &file_names) {
+  auto tablespace = std::make_unique<Tablespace>(start_page_id, end_page_id, file_names);
+  tablespace_latch_.WLock();
+  tablespace->SetReadAheadPages(read_ahead_pages_);
+  for (const auto &entry : tablespaces_) {
+    if (start_page_id < entry.second->GetEndPageId() && entry.second->GetStartPageId() < end_page_id) {
+      tablespace_latch_.WUnlock();
+      throw Exception("tablespace overlaps an existing tablespace");
+    }
+  }
+  tablespaces_[start_page_id] = std::move(tablespace);
+  tablespace_latch_.WUnlock();
+}
+
+void DiskManager::SetReadAheadPages(int read_ahead_pages) {
+  tablespace_latch_.WLock();
+  read_ahead_pages_ = read_ahead_pages;
+  if (default_tablespace_ != nullptr) {
+    default_tablespace_->SetReadAheadPages(read_ahead_pages);
+  }
+  for (auto &entry : tablespaces_) {
+    entry.second->SetReadAheadPages(read_ahead_pages);
+  }
+  tablespace_latch_.WUnlock();
+}
+
+/**
+ * Find the tablespace a page is routed to, falling back to the db file
+ * Tablespaces are never dropped, so the returned pointer stays valid after unlatching.
+ */
+Tablespace *DiskManager::GetTablespace(page_id_t page_id) {
+  Tablespace *tablespace = default_tablespace_.get();
+  tablespace_latch_.RLock();
+  auto it = tablespaces_.upper_bound(page_id);
+  if (it != tablespaces_.begin() && (--it)->second->Contains(page_id)) {
+    tablespace = it->second.get();
+  }
+  tablespace_latch_.RUnlock();
+  return tablespace;
+}
+
 /**
  * Returns number of flushes made so far
  */
-int DiskManager::GetNumFlushes() const { return num_flushes_; }
+int DiskManager::GetNumFlushes() const { return static_cast<int>(stats_.GetLogFlushes()); }
 
 /**
  * Returns number of Writes made so far
  */
-int DiskManager::GetNumWrites() const { return num_writes_; }
+int DiskManager::GetNumWrites() const { return static_cast<int>(stats_.GetPagesWritten()); }
+
+/**
+ * Returns the I/O statistics of every db file, keyed by file name
+ */
+std::map<std::string, DiskStatsSnapshot> DiskManager::GetFileStats() {
+  std::map<std::string, DiskStatsSnapshot> file_stats;
+  auto add_tablespace = [&file_stats](const Tablespace &tablespace) {
+    for (size_t i = 0; i < tablespace.GetNumFiles(); i++) {
+      file_stats[tablespace.GetFileName(i)] = tablespace.GetFileStats(i);
+    }
+  };
+  if (default_tablespace_ != nullptr) {
+    add_tablespace(*default_tablespace_);
+  }
+  tablespace_latch_.RLock();
+  for (const auto &entry : tablespaces_) {
+    add_tablespace(*entry.second);
+  }
+  tablespace_latch_.RUnlock();
+  return file_stats;
+}
 
 /**
  * Returns true if the log is currently being flushed
@@ -0,0 +1,122 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_stats.cpp
+//
+// Identification: src/storage/disk/disk_stats.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <sstream>
+#include <string>
+
+#include "storage/disk/disk_stats.h"
+
+namespace bustub {
+
+uint64_t LatencyHistogramSnapshot::PercentileMicros(double fraction) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  auto target = static_cast<uint64_t>(fraction * count_);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    seen += buckets_[i];
+    if (seen > target || seen == count_) {
+      return 1UL << i;
+    }
+  }
+  return 1UL << (LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) {
+  auto micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+  size_t bucket = 0;
+  while (micros != 0 && bucket + 1 < LATENCY_HISTOGRAM_BUCKETS) {
+    micros >>= 1U;
+    bucket++;
+  }
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  total_ns_.fetch_add(latency.count(), std::memory_order_relaxed);
+}
+
+LatencyHistogramSnapshot LatencyHistogram::GetSnapshot() const {
+  LatencyHistogramSnapshot snapshot;
+  for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    snapshot.buckets_[i] = buckets_[i].load(std::memory_order_relaxed);
+    snapshot.count_ += snapshot.buckets_[i];
+  }
+  snapshot.total_ns_ = total_ns_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+void DiskStats::RecordRead(page_id_t page_id, std::chrono::nanoseconds latency) {
+  pages_read_.fetch_add(1, std::memory_order_relaxed);
+  page_id_t last_page_id = last_read_page_id_.exchange(page_id, std::memory_order_relaxed);
+  if (last_page_id != INVALID_PAGE_ID && page_id == last_page_id + 1) {
+    sequential_reads_.fetch_add(1, std::memory_order_relaxed);
+  }
+  read_latency_.Record(latency);
+}
+
+void DiskStats::RecordWrite(page_id_t page_id, std::chrono::nanoseconds latency) {
+  pages_written_.fetch_add(1, std::memory_order_relaxed);
+  page_id_t last_page_id = last_written_page_id_.exchange(page_id, std::memory_order_relaxed);
+  if (last_page_id != INVALID_PAGE_ID && page_id == last_page_id + 1) {
+    sequential_writes_.fetch_add(1, std::memory_order_relaxed);
+  }
+  write_latency_.Record(latency);
+}
+
+void DiskStats::RecordLogWrite(int size, std::chrono::nanoseconds latency) {
+  log_flushes_.fetch_add(1, std::memory_order_relaxed);
+  log_bytes_written_.fetch_add(size, std::memory_order_relaxed);
+  log_latency_.Record(latency);
+}
+
+void DiskStats::RecordReadAheadIO(size_t num_pages) {
+  read_ahead_ios_.fetch_add(1, std::memory_order_relaxed);
+  read_ahead_pages_.fetch_add(num_pages, std::memory_order_relaxed);
+}
+
+void DiskStats::RecordReadAheadHit() { read_ahead_hits_.fetch_add(1, std::memory_order_relaxed); }
+
+DiskStatsSnapshot DiskStats::GetSnapshot() const {
+  DiskStatsSnapshot snapshot;
+  snapshot.pages_read_ = pages_read_.load(std::memory_order_relaxed);
+  snapshot.pages_written_ = pages_written_.load(std::memory_order_relaxed);
+  snapshot.bytes_read_ = snapshot.pages_read_ * PAGE_SIZE;
+  snapshot.bytes_written_ = snapshot.pages_written_ * PAGE_SIZE;
+  snapshot.log_bytes_written_ = log_bytes_written_.load(std::memory_order_relaxed);
+  snapshot.log_flushes_ = log_flushes_.load(std::memory_order_relaxed);
+  snapshot.sequential_reads_ = sequential_reads_.load(std::memory_order_relaxed);
+  snapshot.random_reads_ = snapshot.pages_read_ - snapshot.sequential_reads_;
+  snapshot.sequential_writes_ = sequential_writes_.load(std::memory_order_relaxed);
+  snapshot.random_writes_ = snapshot.pages_written_ - snapshot.sequential_writes_;
+  snapshot.read_ahead_ios_ = read_ahead_ios_.load(std::memory_order_relaxed);
+  snapshot.read_ahead_pages_ = read_ahead_pages_.load(std::memory_order_relaxed);
+  snapshot.read_ahead_hits_ = read_ahead_hits_.load(std::memory_order_relaxed);
+  snapshot.read_latency_ = read_latency_.GetSnapshot();
+  snapshot.write_latency_ = write_latency_.GetSnapshot();
+  snapshot.log_latency_ = log_latency_.GetSnapshot();
+  return snapshot;
+}
+
+std::string DiskStatsSnapshot::ToString() const {
+  std::ostringstream os;
+  os << "reads: " << pages_read_ << " pages (" << sequential_reads_ << " seq, " << random_reads_ << " rand), "
+     << "mean " << read_latency_.MeanMicros() << "us, p99 < " << read_latency_.PercentileMicros(0.99) << "us\n"
+     << "read-ahead: " << read_ahead_ios_ << " ios, " << read_ahead_pages_ << " pages staged, " << read_ahead_hits_
+     << " hits\n"
+     << "writes: " << pages_written_ << " pages (" << sequential_writes_ << " seq, " << random_writes_ << " rand), "
+     << "mean " << write_latency_.MeanMicros() << "us, p99 < " << write_latency_.PercentileMicros(0.99) << "us\n"
+     << "log: " << log_flushes_ << " flushes, " << log_bytes_written_ << " bytes, "
+     << "mean " << log_latency_.MeanMicros() << "us, p99 < " << log_latency_.PercentileMicros(0.99) << "us\n";
+  return os.str();
+}
+
+}  // namespace bustub
@@ -0,0 +1,76 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// memory_disk_manager.cpp
+//
+// Identification: src/storage/disk/memory_disk_manager.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstring>
+
+#include "storage/disk/memory_disk_manager.h"
+
+namespace bustub {
+
+void MemoryDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::scoped_lock latch{latch_};
+    auto &page = pages_[page_id];
+    if (page == nullptr) {
+      page = std::make_unique<PageData>();
+    }
+    memcpy(page->data(), page_data, PAGE_SIZE);
+  }
+  stats_.RecordWrite(page_id, std::chrono::steady_clock::now() - start);
+}
+
+void MemoryDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::scoped_lock latch{latch_};
+    auto it = pages_.find(page_id);
+    if (it == pages_.end()) {
+      memset(page_data, 0, PAGE_SIZE);
+    } else {
+      memcpy(page_data, it->second->data(), PAGE_SIZE);
+    }
+  }
+  stats_.RecordRead(page_id, std::chrono::steady_clock::now() - start);
+}
+
+void MemoryDiskManager::WriteLog(char *log_data, int size) {
+  if (size == 0) {  // no effect on num_flushes_ if log buffer is empty
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::scoped_lock latch{latch_};
+    log_.insert(log_.end(), log_data, log_data + size);
+  }
+  stats_.RecordLogWrite(size, std::chrono::steady_clock::now() - start);
+}
+
+bool MemoryDiskManager::ReadLog(char *log_data, int size, int offset) {
+  std::scoped_lock latch{latch_};
+  if (offset < 0 || static_cast<size_t>(offset) >= log_.size()) {
+    return false;
+  }
+  int read_count = std::min(size, static_cast<int>(log_.size() - offset));
+  memcpy(log_data, log_.data() + offset, read_count);
+  memset(log_data + read_count, 0, size - read_count);
+  return true;
+}
+
+size_t MemoryDiskManager::GetNumPages() {
+  std::scoped_lock latch{latch_};
+  return pages_.size();
+}
+
+}  // namespace bustub
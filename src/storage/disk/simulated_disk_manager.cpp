@@ -0,0 +1,61 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// simulated_disk_manager.cpp
+//
+// Identification: src/storage/disk/simulated_disk_manager.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <thread>  // NOLINT
+
+#include "storage/disk/simulated_disk_manager.h"
+
+namespace bustub {
+
+void SimulatedDiskManager::Delay(std::chrono::microseconds latency, uint64_t bytes) {
+  auto now = std::chrono::steady_clock::now();
+  auto done_at = now;
+  if (profile_.bandwidth_ != 0) {
+    auto transfer = std::chrono::nanoseconds(bytes * 1000000000UL / profile_.bandwidth_);
+    std::scoped_lock latch{channel_latch_};
+    channel_free_at_ = std::max(channel_free_at_, now) + transfer;
+    done_at = channel_free_at_;
+  }
+  std::this_thread::sleep_until(done_at + latency);
+}
+
+void SimulatedDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  auto start = std::chrono::steady_clock::now();
+  Delay(profile_.write_latency_, PAGE_SIZE);
+  device_->WritePage(page_id, page_data);
+  stats_.RecordWrite(page_id, std::chrono::steady_clock::now() - start);
+}
+
+void SimulatedDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  auto start = std::chrono::steady_clock::now();
+  Delay(profile_.read_latency_, PAGE_SIZE);
+  device_->ReadPage(page_id, page_data);
+  stats_.RecordRead(page_id, std::chrono::steady_clock::now() - start);
+}
+
+void SimulatedDiskManager::WriteLog(char *log_data, int size) {
+  if (size == 0) {  // no effect on num_flushes_ if log buffer is empty
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  Delay(profile_.write_latency_, size);
+  device_->WriteLog(log_data, size);
+  stats_.RecordLogWrite(size, std::chrono::steady_clock::now() - start);
+}
+
+bool SimulatedDiskManager::ReadLog(char *log_data, int size, int offset) {
+  Delay(profile_.read_latency_, size);
+  return device_->ReadLog(log_data, size, offset);
+}
+
+}  // namespace bustub
@@ -0,0 +1,191 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tablespace.cpp
+//
+// Identification: src/storage/disk/tablespace.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "storage/disk/tablespace.h"
+
+namespace bustub {
+
+/**
+ * Open a database file for reading and writing, creating it if it does not exist yet.
+ */
+static void OpenDataFile(std::fstream *io, const std::string &file_name) {
+  io->open(file_name, std::ios::binary | std::ios::in | std::ios::out);
+  // directory or file does not exist
+  if (!io->is_open()) {
+    io->clear();
+    // create a new file
+    io->open(file_name, std::ios::binary | std::ios::trunc | std::ios::out);
+    io->close();
+    // reopen with original mode
+    io->open(file_name, std::ios::binary | std::ios::in | std::ios::out);
+    if (!io->is_open()) {
+      throw Exception("can't open db file " + file_name);
+    }
+  }
+}
+
+/**
+ * Private helper function to get disk file size
+ */
+static size_t GetFileSize(const std::string &file_name) {
+  struct stat stat_buf;
+  int rc = stat(file_name.c_str(), &stat_buf);
+  return rc == 0 ? static_cast<size_t>(stat_buf.st_size) : 0;
+}
+
+Tablespace::Tablespace(page_id_t start_page_id, page_id_t end_page_id, const std::vector<std::string> &file_names)
+    : start_page_id_(start_page_id), end_page_id_(end_page_id) {
+  if (start_page_id < 0 || end_page_id <= start_page_id) {
+    throw Exception("invalid tablespace page range");
+  }
+  if (file_names.empty()) {
+    throw Exception("a tablespace needs at least one file");
+  }
+  for (const auto &file_name : file_names) {
+    auto file = std::make_unique<DataFile>();
+    file->name_ = file_name;
+    OpenDataFile(&file->io_, file_name);
+    files_.push_back(std::move(file));
+  }
+}
+
+Tablespace::DataFile *Tablespace::Locate(page_id_t page_id, size_t *offset) const {
+  auto local_page_id = static_cast<size_t>(page_id - start_page_id_);
+  *offset = (local_page_id / files_.size()) * PAGE_SIZE;
+  return files_[local_page_id % files_.size()].get();
+}
+
+void Tablespace::WritePage(page_id_t page_id, const char *page_data) {
+  size_t offset;
+  DataFile *file = Locate(page_id, &offset);
+  std::scoped_lock latch{file->latch_};
+  auto start = std::chrono::steady_clock::now();
+  // keep a staged copy of the page coherent with the file
+  size_t file_page = offset / PAGE_SIZE;
+  if (file->read_ahead_start_ <= file_page && file_page < file->read_ahead_start_ + file->read_ahead_count_) {
+    memcpy(&file->read_ahead_[(file_page - file->read_ahead_start_) * PAGE_SIZE], page_data, PAGE_SIZE);
+  }
+  // set write cursor to offset
+  file->io_.seekp(offset);
+  file->io_.write(page_data, PAGE_SIZE);
+  // check for I/O error
+  if (file->io_.bad()) {
+    LOG_DEBUG("I/O error while writing");
+    file->stats_.RecordWrite(static_cast<page_id_t>(file_page), std::chrono::steady_clock::now() - start);
+    return;
+  }
+  // needs to flush to keep disk file in sync
+  file->io_.flush();
+  // the stats of a file see its pages in file order, a striped stream is sequential within each file
+  file->stats_.RecordWrite(static_cast<page_id_t>(file_page), std::chrono::steady_clock::now() - start);
+}
+
+void Tablespace::ReadPage(page_id_t page_id, char *page_data) {
+  size_t offset;
+  DataFile *file = Locate(page_id, &offset);
+  std::scoped_lock latch{file->latch_};
+  auto start = std::chrono::steady_clock::now();
+  size_t file_page = offset / PAGE_SIZE;
+  bool sequential = file_page == file->next_read_page_;
+  file->next_read_page_ = file_page + 1;
+
+  // served from the read-ahead buffer, no I/O needed; the read-ahead that staged the page already counted it
+  if (file->read_ahead_start_ <= file_page && file_page < file->read_ahead_start_ + file->read_ahead_count_) {
+    memcpy(page_data, &file->read_ahead_[(file_page - file->read_ahead_start_) * PAGE_SIZE], PAGE_SIZE);
+    file->stats_.RecordReadAheadHit();
+    return;
+  }
+
+  // the second page of an ascending stream starts reading ahead
+  int read_ahead_pages = read_ahead_pages_;
+  if (sequential && read_ahead_pages > 1) {
+    if (ReadAhead(file, file_page, read_ahead_pages) > 0) {
+      memcpy(page_data, file->read_ahead_.data(), PAGE_SIZE);
+    } else {
+      ReadFromFile(file, offset, page_data, 1);
+    }
+  } else {
+    ReadFromFile(file, offset, page_data, 1);
+  }
+  file->stats_.RecordRead(static_cast<page_id_t>(file_page), std::chrono::steady_clock::now() - start);
+}
+
+void Tablespace::Prefetch(page_id_t page_id, int num_pages) {
+  page_id_t end_page_id = std::min(static_cast<int64_t>(end_page_id_), static_cast<int64_t>(page_id) + num_pages);
+  // each file holds a contiguous run of the requested pages; stage up to read_ahead_pages_ of them
+  for (page_id_t first = page_id; first < end_page_id && first < page_id + static_cast<int>(files_.size()); first++) {
+    size_t offset;
+    DataFile *file = Locate(first, &offset);
+    size_t file_pages = (end_page_id - first + files_.size() - 1) / files_.size();
+    std::scoped_lock latch{file->latch_};
+    ReadAhead(file, offset / PAGE_SIZE, std::min(file_pages, static_cast<size_t>(read_ahead_pages_)));
+    file->next_read_page_ = offset / PAGE_SIZE;
+  }
+}
+
+size_t Tablespace::ReadAhead(DataFile *file, size_t file_page, size_t num_pages) {
+  file->read_ahead_.resize(num_pages * PAGE_SIZE);
+  file->read_ahead_start_ = file_page;
+  file->read_ahead_count_ = ReadFromFile(file, file_page * PAGE_SIZE, file->read_ahead_.data(), num_pages);
+  file->read_ahead_.resize(file->read_ahead_count_ * PAGE_SIZE);
+  if (file->read_ahead_count_ > 0) {
+    file->stats_.RecordReadAheadIO(file->read_ahead_count_);
+  }
+  return file->read_ahead_count_;
+}
+
+size_t Tablespace::ReadFromFile(DataFile *file, size_t offset, char *data, size_t num_pages) {
+  // check if read beyond file length
+  if (offset > GetFileSize(file->name_)) {
+    LOG_DEBUG("I/O error reading past end of file");
+    return 0;
+  }
+  // set read cursor to offset
+  file->io_.seekp(offset);
+  file->io_.read(data, num_pages * PAGE_SIZE);
+  if (file->io_.bad()) {
+    LOG_DEBUG("I/O error while reading");
+    return 0;
+  }
+  // if file ends before reading all the pages, zero the rest of the last page
+  size_t read_count = file->io_.gcount();
+  if (read_count < num_pages * PAGE_SIZE) {
+    if (read_count < PAGE_SIZE) {
+      LOG_DEBUG("Read less than a page");
+    }
+    file->io_.clear();
+    size_t pages_read = (read_count + PAGE_SIZE - 1) / PAGE_SIZE;
+    memset(data + read_count, 0, std::max(pages_read, static_cast<size_t>(1)) * PAGE_SIZE - read_count);
+    return pages_read;
+  }
+  return num_pages;
+}
+
+void Tablespace::ShutDown() {
+  for (auto &file : files_) {
+    std::scoped_lock latch{file->latch_};
+    if (file->io_.is_open()) {
+      file->io_.close();
+    }
+  }
+}
+
+}  // namespace bustub
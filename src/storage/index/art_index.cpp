@@ -0,0 +1,72 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// art_index.cpp
+//
+// Identification: src/storage/index/art_index.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/exception.h"
+#include "storage/index/art_index.h"
+
+namespace bustub {
+
+INDEX_TEMPLATE_ARGUMENTS
+ART_INDEX_TYPE::ArtIndex(IndexMetadata *metadata, bool unique)
+    : Index(metadata),
+      comparator_(metadata->GetKeySchema(), KeyType::CanNormalize(metadata->GetKeySchema())),
+      container_(metadata->GetName(), comparator_, unique) {
+  if (GetIncludedColumnCount() > 0) {
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "included columns need a B+ tree index");
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType ART_INDEX_TYPE::MakeIndexKey(const Tuple &key) const {
+  KeyType index_key;
+  index_key.SetNormalizedFromKey(key, GetKeySchema());
+  return index_key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ART_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  container_.Insert(MakeIndexKey(key), rid);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ART_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  container_.Remove(MakeIndexKey(key), rid);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ART_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
+  container_.GetValue(MakeIndexKey(key), result);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ART_INDEX_TYPE::ScanRange(const Tuple *low_key, const Tuple *high_key, std::vector<RID> *result) {
+  KeyType low_index_key;
+  KeyType high_index_key;
+  if (nullptr != low_key) {
+    low_index_key = MakeIndexKey(*low_key);
+  }
+  if (nullptr != high_key) {
+    high_index_key = MakeIndexKey(*high_key);
+  }
+  std::vector<MappingType> entries;
+  container_.Scan(nullptr == low_key ? nullptr : &low_index_key, nullptr == high_key ? nullptr : &high_index_key,
+                  &entries);
+  for (const auto &entry : entries) {
+    result->push_back(entry.second);
+  }
+}
+
+template class ArtIndex<GenericKey<4>, RID, GenericComparator<4>>;
+template class ArtIndex<GenericKey<8>, RID, GenericComparator<8>>;
+template class ArtIndex<GenericKey<16>, RID, GenericComparator<16>>;
+template class ArtIndex<GenericKey<32>, RID, GenericComparator<32>>;
+template class ArtIndex<GenericKey<64>, RID, GenericComparator<64>>;
+
+}  // namespace bustub
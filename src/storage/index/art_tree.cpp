@@ -0,0 +1,669 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// art_tree.cpp
+//
+// Identification: src/storage/index/art_tree.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "storage/index/art_tree.h"
+
+namespace bustub {
+
+INDEX_TEMPLATE_ARGUMENTS
+ARTTREE_TYPE::ArtTree(std::string name, const KeyComparator &comparator, bool unique)
+    : index_name_(std::move(name)), unique_(unique), key_length_(comparator.KeyLength()), root_(new Node256) {
+  if (!comparator.IsNormalized()) {
+    delete root_;
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "an ART index needs a key schema that can be normalized");
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+ARTTREE_TYPE::~ArtTree() { DeleteTree(root_); }
+
+INDEX_TEMPLATE_ARGUMENTS
+void ARTTREE_TYPE::DeleteTree(Node *node) {
+  Children children;
+  if (NodeType::LEAF != node->type_) {
+    ReadChildren(node, 0, 255, &children);
+  }
+  for (int i = 0; i < children.count_; i++) {
+    DeleteTree(children.nodes_[i]);
+  }
+  delete node;
+}
+
+/*****************************************************************************
+ * NODES
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+bool ARTTREE_TYPE::ReadLock(Node *node, uint64_t *version) {
+  *version = node->version_;
+  while (0 != (*version & LOCKED)) {
+    *version = node->version_;
+  }
+  return 0 == (*version & OBSOLETE);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool ARTTREE_TYPE::KeysEqual(const KeyType &lhs, const KeyType &rhs) const {
+  return 0 == memcmp(lhs.data_, rhs.data_, key_length_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int ARTTREE_TYPE::CompareKeys(const KeyType &lhs, const KeyType &rhs) const {
+  return memcmp(lhs.data_, rhs.data_, key_length_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename ARTTREE_TYPE::Node *ARTTREE_TYPE::FindChild(Node *node, uint8_t byte) {
+  switch (node->type_) {
+    case NodeType::NODE4: {
+      auto sorted = static_cast<Node4 *>(node);
+      // the count may be read while a writer changes it
+      int count = std::min<int>(sorted->count_, Node4::CAPACITY);
+      for (int i = 0; i < count; i++) {
+        if (sorted->keys_[i] == byte) {
+          return sorted->children_[i];
+        }
+      }
+      return nullptr;
+    }
+    case NodeType::NODE16: {
+      auto sorted = static_cast<Node16 *>(node);
+      int count = std::min<int>(sorted->count_, Node16::CAPACITY);
+      for (int i = 0; i < count; i++) {
+        if (sorted->keys_[i] == byte) {
+          return sorted->children_[i];
+        }
+      }
+      return nullptr;
+    }
+    case NodeType::NODE48: {
+      auto indexed = static_cast<Node48 *>(node);
+      int index = indexed->child_index_[byte];
+      return 0 == index ? nullptr : indexed->children_[index - 1].load();
+    }
+    case NodeType::NODE256:
+      return static_cast<Node256 *>(node)->children_[byte];
+    default:
+      return nullptr;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ARTTREE_TYPE::ReadChildren(Node *node, int low, int high, Children *children) {
+  auto add = [children](uint8_t byte, Node *child) {
+    children->bytes_[children->count_] = byte;
+    children->nodes_[children->count_++] = child;
+  };
+  auto read_sorted = [&](auto sorted, int capacity) {
+    int count = std::min<int>(sorted->count_, capacity);
+    for (int i = 0; i < count; i++) {
+      uint8_t byte = sorted->keys_[i];
+      Node *child = sorted->children_[i];
+      if (byte >= low && byte <= high && nullptr != child) {
+        add(byte, child);
+      }
+    }
+  };
+  switch (node->type_) {
+    case NodeType::NODE4:
+      read_sorted(static_cast<Node4 *>(node), Node4::CAPACITY);
+      break;
+    case NodeType::NODE16:
+      read_sorted(static_cast<Node16 *>(node), Node16::CAPACITY);
+      break;
+    case NodeType::NODE48: {
+      auto indexed = static_cast<Node48 *>(node);
+      for (int byte = low; byte <= high; byte++) {
+        int index = indexed->child_index_[byte];
+        Node *child = 0 == index ? nullptr : indexed->children_[index - 1].load();
+        if (nullptr != child) {
+          add(byte, child);
+        }
+      }
+      break;
+    }
+    case NodeType::NODE256: {
+      auto full = static_cast<Node256 *>(node);
+      for (int byte = low; byte <= high; byte++) {
+        Node *child = full->children_[byte];
+        if (nullptr != child) {
+          add(byte, child);
+        }
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename ARTTREE_TYPE::Leaf *ARTTREE_TYPE::NewLeaf(const KeyType &key, const std::vector<ValueType> &values) {
+  static_assert(alignof(Leaf) % alignof(ValueType) == 0 && std::is_trivially_destructible_v<ValueType>,
+                "the values of a leaf are stored after it");
+  auto leaf = new (::operator new(sizeof(Leaf) + values.size() * sizeof(ValueType))) Leaf(key, values.size());
+  std::uninitialized_copy(values.begin(), values.end(), reinterpret_cast<ValueType *>(leaf + 1));
+  return leaf;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool ARTTREE_TYPE::IsFull(Node *node) {
+  switch (node->type_) {
+    case NodeType::NODE4:
+      return node->count_ >= Node4::CAPACITY;
+    case NodeType::NODE16:
+      return node->count_ >= Node16::CAPACITY;
+    case NodeType::NODE48:
+      return node->count_ >= Node48::CAPACITY;
+    default:
+      return false;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ARTTREE_TYPE::AddChild(Node *node, uint8_t byte, Node *child) {
+  auto add_sorted = [&](auto sorted) {
+    int count = sorted->count_;
+    int position = count;
+    while (position > 0 && sorted->keys_[position - 1] > byte) {
+      sorted->keys_[position] = sorted->keys_[position - 1].load();
+      sorted->children_[position] = sorted->children_[position - 1].load();
+      position--;
+    }
+    sorted->keys_[position] = byte;
+    sorted->children_[position] = child;
+  };
+  switch (node->type_) {
+    case NodeType::NODE4:
+      add_sorted(static_cast<Node4 *>(node));
+      break;
+    case NodeType::NODE16:
+      add_sorted(static_cast<Node16 *>(node));
+      break;
+    case NodeType::NODE48: {
+      auto indexed = static_cast<Node48 *>(node);
+      // removed children leave free slots anywhere
+      int slot = 0;
+      while (nullptr != indexed->children_[slot]) {
+        slot++;
+      }
+      indexed->children_[slot] = child;
+      indexed->child_index_[byte] = slot + 1;
+      break;
+    }
+    case NodeType::NODE256:
+      static_cast<Node256 *>(node)->children_[byte] = child;
+      break;
+    default:
+      break;
+  }
+  node->count_++;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ARTTREE_TYPE::ReplaceChild(Node *node, uint8_t byte, Node *child) {
+  auto replace_sorted = [&](auto sorted) {
+    for (int i = 0; i < sorted->count_; i++) {
+      if (sorted->keys_[i] == byte) {
+        sorted->children_[i] = child;
+        return;
+      }
+    }
+  };
+  switch (node->type_) {
+    case NodeType::NODE4:
+      replace_sorted(static_cast<Node4 *>(node));
+      break;
+    case NodeType::NODE16:
+      replace_sorted(static_cast<Node16 *>(node));
+      break;
+    case NodeType::NODE48: {
+      auto indexed = static_cast<Node48 *>(node);
+      indexed->children_[indexed->child_index_[byte] - 1] = child;
+      break;
+    }
+    case NodeType::NODE256:
+      static_cast<Node256 *>(node)->children_[byte] = child;
+      break;
+    default:
+      break;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ARTTREE_TYPE::RemoveChild(Node *node, uint8_t byte) {
+  auto remove_sorted = [&](auto sorted) {
+    int count = sorted->count_;
+    int position = 0;
+    while (sorted->keys_[position] != byte) {
+      position++;
+    }
+    for (; position + 1 < count; position++) {
+      sorted->keys_[position] = sorted->keys_[position + 1].load();
+      sorted->children_[position] = sorted->children_[position + 1].load();
+    }
+    sorted->children_[count - 1] = nullptr;
+  };
+  switch (node->type_) {
+    case NodeType::NODE4:
+      remove_sorted(static_cast<Node4 *>(node));
+      break;
+    case NodeType::NODE16:
+      remove_sorted(static_cast<Node16 *>(node));
+      break;
+    case NodeType::NODE48: {
+      auto indexed = static_cast<Node48 *>(node);
+      indexed->children_[indexed->child_index_[byte] - 1] = nullptr;
+      indexed->child_index_[byte] = 0;
+      break;
+    }
+    case NodeType::NODE256:
+      static_cast<Node256 *>(node)->children_[byte] = nullptr;
+      break;
+    default:
+      break;
+  }
+  node->count_--;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ARTTREE_TYPE::CopyPrefix(Node *from, Node *to, uint32_t begin, uint32_t end) {
+  for (uint32_t i = begin; i < end; i++) {
+    to->prefix_[i - begin] = from->prefix_[i].load();
+  }
+  to->prefix_length_ = end - begin;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename ARTTREE_TYPE::Node *ARTTREE_TYPE::Grow(Node *node) {
+  Node *bigger;
+  switch (node->type_) {
+    case NodeType::NODE4:
+      bigger = new Node16;
+      break;
+    case NodeType::NODE16:
+      bigger = new Node48;
+      break;
+    default:
+      bigger = new Node256;
+      break;
+  }
+  CopyPrefix(node, bigger, 0, node->prefix_length_);
+  Children children;
+  ReadChildren(node, 0, 255, &children);
+  for (int i = 0; i < children.count_; i++) {
+    AddChild(bigger, children.bytes_[i], children.nodes_[i]);
+  }
+  return bigger;
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+bool ARTTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result) {
+  EpochGuard guard(&epoch_manager_);
+  size_t size = result->size();
+  while (!TryGetValue(key, result)) {
+    result->resize(size);
+  }
+  return result->size() > size;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool ARTTREE_TYPE::TryGetValue(const KeyType &key, std::vector<ValueType> *result) {
+  Node *node = root_;
+  uint64_t version;
+  if (!ReadLock(node, &version)) {
+    return false;
+  }
+  size_t level = 0;
+  while (true) {
+    // the prefix is skipped without comparing it, the key of the leaf is compared instead
+    level += node->prefix_length_;
+    if (level >= key_length_) {
+      return false;
+    }
+    Node *child = FindChild(node, KeyByte(key, level));
+    if (!Validate(node, version)) {
+      return false;
+    }
+    if (nullptr == child) {
+      return true;
+    }
+    if (NodeType::LEAF == child->type_) {
+      auto leaf = static_cast<Leaf *>(child);
+      if (KeysEqual(leaf->key_, key)) {
+        result->insert(result->end(), leaf->begin(), leaf->end());
+      }
+      return true;
+    }
+    uint64_t child_version;
+    if (!ReadLock(child, &child_version) || !Validate(node, version)) {
+      return false;
+    }
+    node = child;
+    version = child_version;
+    level++;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ARTTREE_TYPE::Scan(const KeyType *low_key, const KeyType *high_key, std::vector<MappingType> *result) {
+  EpochGuard guard(&epoch_manager_);
+  // a scan that restarts resumes after the last key it read
+  KeyType after;
+  bool has_after = false;
+  while (true) {
+    size_t size = result->size();
+    if (TryScan(root_, 0, has_after ? &after : low_key, high_key, has_after ? &after : nullptr, result)) {
+      return;
+    }
+    if (result->size() > size) {
+      after = result->back().first;
+      has_after = true;
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool ARTTREE_TYPE::TryScan(Node *node, size_t level, const KeyType *low_key, const KeyType *high_key,
+                           const KeyType *after, std::vector<MappingType> *result) {
+  uint64_t version;
+  if (!ReadLock(node, &version)) {
+    return false;
+  }
+  uint32_t prefix_length = node->prefix_length_;
+  if (level + prefix_length >= key_length_) {
+    return false;
+  }
+  // a prefix below the low key, or above the high key, excludes the whole subtree
+  for (uint32_t i = 0; i < prefix_length && (nullptr != low_key || nullptr != high_key); i++) {
+    uint8_t byte = node->prefix_[i];
+    if (nullptr != low_key && byte != KeyByte(*low_key, level + i)) {
+      if (byte < KeyByte(*low_key, level + i)) {
+        return Validate(node, version);
+      }
+      low_key = nullptr;
+    }
+    if (nullptr != high_key && byte != KeyByte(*high_key, level + i)) {
+      if (byte > KeyByte(*high_key, level + i)) {
+        return Validate(node, version);
+      }
+      high_key = nullptr;
+    }
+  }
+  level += prefix_length;
+  Children children;
+  ReadChildren(node, nullptr == low_key ? 0 : KeyByte(*low_key, level),
+               nullptr == high_key ? 255 : KeyByte(*high_key, level), &children);
+  if (!Validate(node, version)) {
+    return false;
+  }
+  // the children are read one after the other, so start the cache misses of all of them at once
+  for (int i = 0; i < children.count_; i++) {
+    __builtin_prefetch(children.nodes_[i]);
+  }
+  for (int i = 0; i < children.count_; i++) {
+    uint8_t byte = children.bytes_[i];
+    Node *child = children.nodes_[i];
+    if (NodeType::LEAF == child->type_) {
+      auto leaf = static_cast<Leaf *>(child);
+      if ((nullptr != low_key && CompareKeys(leaf->key_, *low_key) < 0) ||
+          (nullptr != high_key && CompareKeys(leaf->key_, *high_key) > 0) ||
+          (nullptr != after && CompareKeys(leaf->key_, *after) <= 0)) {
+        continue;
+      }
+      for (const auto &value : *leaf) {
+        result->emplace_back(leaf->key_, value);
+      }
+      continue;
+    }
+    const KeyType *child_low_key = nullptr != low_key && byte == KeyByte(*low_key, level) ? low_key : nullptr;
+    const KeyType *child_high_key = nullptr != high_key && byte == KeyByte(*high_key, level) ? high_key : nullptr;
+    if (!TryScan(child, level + 1, child_low_key, child_high_key, after, result)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*****************************************************************************
+ * INSERTION & DELETION
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+bool ARTTREE_TYPE::Insert(const KeyType &key, const ValueType &value) {
+  EpochGuard guard(&epoch_manager_);
+  bool inserted;
+  while (!TryInsert(key, value, &guard, &inserted)) {
+  }
+  return inserted;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool ARTTREE_TYPE::TryInsert(const KeyType &key, const ValueType &value, EpochGuard *guard, bool *inserted) {
+  *inserted = true;
+  Node *parent = nullptr;
+  uint64_t parent_version = 0;
+  uint8_t parent_byte = 0;
+  Node *node = root_;
+  uint64_t version;
+  if (!ReadLock(node, &version)) {
+    return false;
+  }
+  size_t level = 0;
+  while (true) {
+    uint32_t prefix_length = node->prefix_length_;
+    if (level + prefix_length >= key_length_) {
+      return false;
+    }
+    uint32_t matched = 0;
+    while (matched < prefix_length && node->prefix_[matched] == KeyByte(key, level + matched)) {
+      matched++;
+    }
+    if (matched < prefix_length) {
+      // the key leaves the prefix: a new node takes the matched part of the prefix, and branches to the node and to
+      // the new leaf (the root has no prefix, so the node has a parent)
+      if (!Upgrade(parent, parent_version)) {
+        return false;
+      }
+      if (!Upgrade(node, version)) {
+        WriteUnlock(parent);
+        return false;
+      }
+      auto branch = new Node4;
+      CopyPrefix(node, branch, 0, matched);
+      AddChild(branch, KeyByte(key, level + matched), NewLeaf(key, {value}));
+      AddChild(branch, node->prefix_[matched], node);
+      CopyPrefix(node, node, matched + 1, prefix_length);
+      ReplaceChild(parent, parent_byte, branch);
+      WriteUnlock(node);
+      WriteUnlock(parent);
+      return true;
+    }
+    level += prefix_length;
+    uint8_t byte = KeyByte(key, level);
+    Node *child = FindChild(node, byte);
+    if (!Validate(node, version)) {
+      return false;
+    }
+
+    if (nullptr == child) {
+      if (IsFull(node)) {
+        // the root never fills, so the node has a parent
+        if (!Upgrade(parent, parent_version)) {
+          return false;
+        }
+        if (!Upgrade(node, version)) {
+          WriteUnlock(parent);
+          return false;
+        }
+        auto bigger = Grow(node);
+        AddChild(bigger, byte, NewLeaf(key, {value}));
+        ReplaceChild(parent, parent_byte, bigger);
+        WriteUnlockObsolete(node);
+        guard->Retire(node);
+        WriteUnlock(parent);
+        return true;
+      }
+      if (!Upgrade(node, version)) {
+        return false;
+      }
+      if (nullptr != parent && !Validate(parent, parent_version)) {
+        WriteUnlock(node);
+        return false;
+      }
+      AddChild(node, byte, NewLeaf(key, {value}));
+      WriteUnlock(node);
+      return true;
+    }
+    if (nullptr != parent && !Validate(parent, parent_version)) {
+      return false;
+    }
+
+    if (NodeType::LEAF == child->type_) {
+      auto leaf = static_cast<Leaf *>(child);
+      size_t differ = level + 1;
+      while (differ < key_length_ && KeyByte(leaf->key_, differ) == KeyByte(key, differ)) {
+        differ++;
+      }
+      if (differ == key_length_) {
+        if (unique_ || std::find(leaf->begin(), leaf->end(), value) != leaf->end()) {
+          *inserted = false;
+          return Validate(node, version);
+        }
+        if (!Upgrade(node, version)) {
+          return false;
+        }
+        std::vector<ValueType> new_values(leaf->begin(), leaf->end());
+        new_values.push_back(value);
+        ReplaceChild(node, byte, NewLeaf(key, new_values));
+        WriteUnlock(node);
+        guard->Retire(leaf);
+        return true;
+      }
+      // the two keys share the bytes up to differ, which become the prefix of a new node with both leaves
+      if (!Upgrade(node, version)) {
+        return false;
+      }
+      auto branch = new Node4;
+      for (size_t i = level + 1; i < differ; i++) {
+        branch->prefix_[i - level - 1] = KeyByte(key, i);
+      }
+      branch->prefix_length_ = differ - level - 1;
+      AddChild(branch, KeyByte(key, differ), NewLeaf(key, {value}));
+      AddChild(branch, KeyByte(leaf->key_, differ), leaf);
+      ReplaceChild(node, byte, branch);
+      WriteUnlock(node);
+      return true;
+    }
+
+    uint64_t child_version;
+    if (!ReadLock(child, &child_version) || !Validate(node, version)) {
+      return false;
+    }
+    parent = node;
+    parent_version = version;
+    parent_byte = byte;
+    node = child;
+    version = child_version;
+    level++;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ARTTREE_TYPE::Remove(const KeyType &key) {
+  EpochGuard guard(&epoch_manager_);
+  while (!TryRemove(key, nullptr, &guard)) {
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void ARTTREE_TYPE::Remove(const KeyType &key, const ValueType &value) {
+  EpochGuard guard(&epoch_manager_);
+  while (!TryRemove(key, &value, &guard)) {
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool ARTTREE_TYPE::TryRemove(const KeyType &key, const ValueType *value, EpochGuard *guard) {
+  Node *node = root_;
+  uint64_t version;
+  if (!ReadLock(node, &version)) {
+    return false;
+  }
+  size_t level = 0;
+  while (true) {
+    level += node->prefix_length_;
+    if (level >= key_length_) {
+      return false;
+    }
+    uint8_t byte = KeyByte(key, level);
+    Node *child = FindChild(node, byte);
+    if (!Validate(node, version)) {
+      return false;
+    }
+    if (nullptr == child) {
+      return true;
+    }
+    if (NodeType::LEAF == child->type_) {
+      auto leaf = static_cast<Leaf *>(child);
+      if (!KeysEqual(leaf->key_, key)) {
+        return true;
+      }
+      std::vector<ValueType> values;
+      if (nullptr != value) {
+        for (const auto &leaf_value : *leaf) {
+          if (!(leaf_value == *value)) {
+            values.push_back(leaf_value);
+          }
+        }
+        if (values.size() == leaf->size_) {
+          return true;
+        }
+      }
+      if (!Upgrade(node, version)) {
+        return false;
+      }
+      if (values.empty()) {
+        RemoveChild(node, byte);
+      } else {
+        ReplaceChild(node, byte, NewLeaf(key, values));
+      }
+      WriteUnlock(node);
+      guard->Retire(leaf);
+      return true;
+    }
+    uint64_t child_version;
+    if (!ReadLock(child, &child_version) || !Validate(node, version)) {
+      return false;
+    }
+    node = child;
+    version = child_version;
+    level++;
+  }
+}
+
+template class ArtTree<GenericKey<4>, RID, GenericComparator<4>>;
+template class ArtTree<GenericKey<8>, RID, GenericComparator<8>>;
+template class ArtTree<GenericKey<16>, RID, GenericComparator<16>>;
+template class ArtTree<GenericKey<32>, RID, GenericComparator<32>>;
+template class ArtTree<GenericKey<64>, RID, GenericComparator<64>>;
+
+}  // namespace bustub
@@ -9,57 +9,208 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <numeric>
 #include <string>
+#include <string_view>
+#include <thread>  // NOLINT
+#include <utility>
 
 #include "common/exception.h"
 #include "common/rid.h"
 #include "storage/index/b_plus_tree.h"
+#include "storage/page/b_plus_tree_posting_page.h"
 #include "storage/page/header_page.h"
 
 namespace bustub {
 
-    INDEX_TEMPLATE_ARGUMENTS thread_local bool BPLUSTREE_TYPE::root_lock = false;
+namespace {
+
+// the hash of a key for the adaptive hash index, over the bytes the key has set
+template <typename KeyType>
+size_t AdaptiveHashKey(const KeyType &key) {
+  return std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char *>(&key), sizeof(KeyType)));
+}
+
+template <size_t KeySize>
+size_t AdaptiveHashKey(const VarKey<KeySize> &key) {
+  return std::hash<std::string_view>()(std::string_view(key.data_, key.size_));
+}
+
+}  // namespace
 
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                          int leaf_max_size, int internal_max_size)
+                          int leaf_max_size, int internal_max_size, bool unique)
     : index_name_(std::move(name)),
-      root_page_id_(INVALID_PAGE_ID),
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
       leaf_max_size_(leaf_max_size),
       internal_max_size_(internal_max_size),
-      node_size_(0){}
+      unique_(unique) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+BPLUSTREE_TYPE::~BPlusTree() { StopBackgroundCleanup(); }
 
 /*
  * Helper function to decide whether current b+tree is empty
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::IsEmpty() const {
-    return root_page_id_ == INVALID_PAGE_ID;
+    return GetRootPageId() == INVALID_PAGE_ID;
 }
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 /*
- * Return the only value that associated with input key
+ * Return the values associated with input key, the only one of a unique tree
  * This method is used for point query
  * @return : true means key exists
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) {
-    std::deque<Page*> lock_page_deq;
-    auto leafPage = FindLeafPage(key, false, Operation::READ, transaction, &lock_page_deq);
-    if (nullptr == leafPage) {
-        UnlockPages(Operation::READ, lock_page_deq);
-        return false;
+  bool adaptive_hash = adaptive_hash_enabled_;
+  size_t hash = 0;
+  if (adaptive_hash) {
+    adaptive_hash_lookup_count_++;
+    hash = AdaptiveHashKey(key);
+    bool found;
+    if (GetValueByHash(key, hash, result, &found)) {
+      adaptive_hash_hit_count_++;
+      return found;
+    }
+  }
+  std::deque<Page *> lock_page_deq;
+  auto leafPage = FindLeafPage(key, false, Operation::READ, transaction, &lock_page_deq);
+  if (nullptr == leafPage) {
+    return false;
+  }
+  auto leafNode = reinterpret_cast<LeafPage *>(leafPage->GetData());
+  ValueType v;
+  bool res = leafNode->Lookup(key, &v, comparator_);
+  if (res) {
+    ReadValues(v, result);
+    if (adaptive_hash) {
+      CountAdaptiveHashLookup(key, hash, leafNode);
+    }
+  }
+  UnlockPages(Operation::READ, lock_page_deq);
+  return res;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::GetValueByHash(const KeyType &key, size_t hash, std::vector<ValueType> *result, bool *found) {
+  size_t index = hash % ADAPTIVE_HASH_SIZE;
+  AdaptiveHashEntry entry;
+  {
+    std::scoped_lock latch{adaptive_hash_latches_[index % ADAPTIVE_HASH_PARTITIONS]};
+    entry = adaptive_hash_[index];
+  }
+  if (INVALID_PAGE_ID == entry.page_id_ || entry.hash_ != hash) {
+    return false;
+  }
+  // page ids are not reused, and a deleted leaf is empty from the moment it is unlinked and changes its version
+  // before it is flushed (see DeleteLeaf()), so the page is either the leaf of the entry or a page the checks reject
+  auto page = buffer_pool_manager_->FetchPage(entry.page_id_);
+  if (nullptr == page) {
+    return false;
+  }
+  page->RLatch();
+  auto leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  bool valid = leaf->IsLeafPage() && leaf->GetSize() > 0 && leaf->GetVersion() == entry.version_ &&
+               !leaf->ShouldMoveRight(key, comparator_);
+  if (valid) {
+    ValueType value;
+    if (entry.slot_ < leaf->GetSize() && 0 == comparator_(leaf->KeyAt(entry.slot_), key)) {
+      value = leaf->ValueAt(entry.slot_);
+      *found = true;
+    } else {
+      // inserts and removes moved the key within the leaf, or removed it
+      *found = leaf->Lookup(key, &value, comparator_);
+    }
+    if (*found) {
+      ReadValues(value, result);
+    }
+  }
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  return valid;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::CountAdaptiveHashLookup(const KeyType &key, size_t hash, LeafPage *leaf) {
+  size_t index = hash % ADAPTIVE_HASH_SIZE;
+  if (++adaptive_hash_lookups_[index] < ADAPTIVE_HASH_HOT_LOOKUPS) {
+    return;
+  }
+  adaptive_hash_lookups_[index] = 0;
+  AdaptiveHashEntry entry;
+  entry.hash_ = hash;
+  entry.page_id_ = leaf->GetPageId();
+  entry.slot_ = leaf->KeyIndex(key, comparator_);
+  entry.version_ = leaf->GetVersion();
+  std::scoped_lock latch{adaptive_hash_latches_[index % ADAPTIVE_HASH_PARTITIONS]};
+  adaptive_hash_[index] = entry;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SetAdaptiveHashIndex(bool enable) {
+  std::vector<std::unique_lock<std::mutex>> latches;
+  for (auto &latch : adaptive_hash_latches_) {
+    latches.emplace_back(latch);
+  }
+  // the table is never freed, lookups that saw the index enabled may still read it
+  if (nullptr == adaptive_hash_) {
+    adaptive_hash_ = std::make_unique<AdaptiveHashEntry[]>(ADAPTIVE_HASH_SIZE);
+    adaptive_hash_lookups_ = std::make_unique<std::atomic<uint8_t>[]>(ADAPTIVE_HASH_SIZE);
+  }
+  for (size_t i = 0; i < ADAPTIVE_HASH_SIZE; i++) {
+    adaptive_hash_[i] = AdaptiveHashEntry();
+    adaptive_hash_lookups_[i] = 0;
+  }
+  adaptive_hash_lookup_count_ = 0;
+  adaptive_hash_hit_count_ = 0;
+  adaptive_hash_enabled_ = enable;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::GetValues(const std::vector<KeyType> &keys, std::vector<std::vector<ValueType>> *results,
+                               Transaction *transaction) {
+  results->assign(keys.size(), std::vector<ValueType>());
+  std::vector<size_t> order(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [this, &keys](size_t lhs, size_t rhs) { return comparator_(keys[lhs], keys[rhs]) < 0; });
+
+  // the latched leaf covers the keys from the previous probe up to its high key
+  Page *page = nullptr;
+  for (size_t i : order) {
+    const KeyType &key = keys[i];
+    if (nullptr != page && ShouldMoveRight(page, key)) {
+      // a key just past the leaf is likely in the right sibling, a key further away needs a new traversal
+      page = MoveRight(page, false);
+      if (ShouldMoveRight(page, key)) {
+        page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+        page = nullptr;
+      }
+    }
+    if (nullptr == page) {
+      std::deque<Page *> lock_page_deq;
+      page = FindLeafPage(key, false, Operation::READ, transaction, &lock_page_deq);
+      if (nullptr == page) {
+        return;
+      }
     }
-    auto leafNode = reinterpret_cast<LeafPage * >(leafPage->GetData());
     ValueType v;
-    bool  res = leafNode->Lookup(key,  &v, comparator_);
-    result->push_back(v);
-    UnlockPages(Operation::READ, lock_page_deq);
-    return res;
+    if (reinterpret_cast<LeafPage *>(page->GetData())->Lookup(key, &v, comparator_)) {
+      ReadValues(v, &(*results)[i]);
+    }
+  }
+  if (nullptr != page) {
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  }
 }
 
 /*****************************************************************************
@@ -69,24 +220,19 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
  * Insert constant key & value pair into b+ tree
  * if current tree is empty, start new tree, update root page id and insert
  * entry, otherwise insert into leaf page.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * @return: if user try to insert a duplicate key into a unique tree, or a duplicate
+ * key & value pair into a non-unique one, return false, otherwise return true.
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) {
-    LockRootPage(true);
-  if (INVALID_PAGE_ID == root_page_id_) {
-    StartNewTree(key, value);
-    node_size_++;
-    UnlockRootPage(true);
-    return true;
-  }
-  bool hasUnique = InsertIntoLeaf(key, value, transaction);
-  if (hasUnique) {
-      node_size_++;
+  if (IsEmpty()) {
+    std::scoped_lock root_latch{root_latch_};
+    if (IsEmpty()) {
+      StartNewTree(key, value);
+      return true;
+    }
   }
-  UnlockRootPage(true);
-    return hasUnique;
+  return InsertIntoLeaf(key, value, transaction);
 }
 /*
  * Insert constant key & value pair into an empty tree
@@ -96,17 +242,19 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
-  auto page = buffer_pool_manager_->NewPage(&root_page_id_);
+  page_id_t root_page_id;
+  auto page = buffer_pool_manager_->NewPage(&root_page_id);
   if (nullptr == page) {
     throw "out of memory";
   }
 
-  auto root = reinterpret_cast<LeafPage * >(page->GetData());
-  UpdateRootPageId(true);
-  root->Init(root_page_id_, INVALID_PAGE_ID, leaf_max_size_);
+  auto root = reinterpret_cast<LeafPage *>(page->GetData());
+  root->Init(root_page_id, INVALID_PAGE_ID, leaf_max_size_, &comparator_);
   root->Insert(key, value, comparator_);
+  SetRootPageId(root_page_id);
+  UpdateRootPageId(true);
 
-  buffer_pool_manager_->UnpinPage(root_page_id_, true);
+  buffer_pool_manager_->UnpinPage(root_page_id, true);
 }
 
 /*
@@ -114,32 +262,58 @@ void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
  * User needs to first find the right leaf page as insertion target, then look
  * through leaf page to see whether insert key exist or not. If exist, return
  * immdiately, otherwise insert entry. Remember to deal with split if necessary.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * Only the leaf is write-latched (see FindLeafPageOptimistic()). A full leaf is split under its own latch, and the
+ * split is posted to the parent after the latch is released (see InsertIntoParent()).
+ * A duplicate key of a non-unique tree only adds the value to the posting list of the key, the leaf does not grow.
+ * @return: if user try to insert a duplicate key into a unique tree, or a duplicate
+ * key & value pair into a non-unique one, return false, otherwise return true.
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction) {
-  std::deque<Page*> lock_page_deq;
-  auto leafPage = FindLeafPage(key, false, Operation::INSERT, transaction, &lock_page_deq);
-  auto leafNode = reinterpret_cast<LeafPage * >(leafPage->GetData());
-  ValueType v;
-  if (leafNode->Lookup(key,  &v, comparator_)) {
+  auto leafPage = FindRightmostLeafPage(key);
+  if (nullptr == leafPage) {
+    leafPage = FindLeafPageOptimistic(key);
+    if (nullptr == leafPage) {
+      // the tree was emptied meanwhile
+      return Insert(key, value, transaction);
+    }
+    if (INVALID_PAGE_ID == reinterpret_cast<LeafPage *>(leafPage->GetData())->GetNextPageId()) {
+      rightmost_leaf_page_id_ = leafPage->GetPageId();
+    }
+  }
+  auto leafNode = reinterpret_cast<LeafPage *>(leafPage->GetData());
+  int index = leafNode->KeyIndex(key, comparator_);
+  if (index < leafNode->GetSize() && comparator_(leafNode->KeyAt(index), key) == 0) {
     // key exist in leaf page
-      UnlockPages(Operation::INSERT, lock_page_deq);
-    return false;
+    ValueType entry_value = leafNode->ValueAt(index);
+    bool inserted = !unique_ && InsertIntoPostingList(&entry_value, value);
+    if (inserted) {
+      leafNode->SetValueAt(index, entry_value);
+    }
+    leafPage->WUnlatch();
+    buffer_pool_manager_->UnpinPage(leafPage->GetPageId(), inserted);
+    return inserted;
   }
   leafNode->Insert(key, value, comparator_);
-  if (leafNode->GetMaxSize() < leafNode->GetSize()) {
-    // to split
-    auto new_leaf_node = Split<LeafPage>(leafNode);
-    // insert leaf linked list
-    new_leaf_node->SetNextPageId(leafNode->GetNextPageId());
-    leafNode->SetNextPageId(new_leaf_node->GetPageId());
-
-    InsertIntoParent(leafNode, new_leaf_node->KeyAt(0), new_leaf_node, transaction);
+  leafNode->UpdateMaxSize(leaf_max_size_);
+  if (leafNode->GetSize() <= leafNode->GetMaxSize()) {
+    leafPage->WUnlatch();
+    buffer_pool_manager_->UnpinPage(leafPage->GetPageId(), true);
+    return true;
   }
-  // todo unlock flush all dirty page?
-    UnlockPages(Operation::INSERT, lock_page_deq);
+
+  // to split, the new leaf is reachable through the right-link as soon as the leaf is unlatched
+  bool append = INVALID_PAGE_ID == leafNode->GetNextPageId() &&
+                comparator_(leafNode->KeyAt(leafNode->GetSize() - 1), key) == 0;
+  auto new_leaf_node = Split<LeafPage>(leafNode, append);
+  KeyType separator = leafNode->GetHighKey();
+  // the frame of the leaf may hold another page once it is unpinned
+  page_id_t leaf_page_id = leafPage->GetPageId();
+  page_id_t new_page_id = new_leaf_node->GetPageId();
+  leafPage->WUnlatch();
+  buffer_pool_manager_->UnpinPage(leaf_page_id, true);
+  buffer_pool_manager_->UnpinPage(new_page_id, true);
+  InsertIntoParent(leaf_page_id, separator, new_page_id, transaction);
   return true;
 }
 
@@ -149,80 +323,778 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
  * an "out of memory" exception if returned value is nullptr), then move half
  * of key & value pairs from input page to newly created page
+ * The new page becomes the right sibling of the input page, and takes over its right-link and high key; the first
+ * key moved to it becomes the high key of the input page. It is returned pinned. The leaf after a new leaf is
+ * latched (left to right) to set its prev-link.
+ * An append, that is a split of the last page of its level after an insert at its end, moves only the tail instead:
+ * the input page of a leaf split is left full, and an internal page keeps 90% of its children. Pages filled by
+ * increasing keys then stay full instead of half full, as no key will be inserted into them anymore.
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-N *BPLUSTREE_TYPE::Split(N *node) {
+N *BPLUSTREE_TYPE::Split(N *node, bool append) {
   page_id_t new_page_id;
   auto new_page = buffer_pool_manager_->NewPage(&new_page_id);
-  if (nullptr==new_page) {
+  if (nullptr == new_page) {
     throw "out of memory";
   }
-  if (std::is_same<LeafPage , N>::value) {
-    auto node_data = reinterpret_cast<LeafPage *>(node);
-    auto new_page_data = reinterpret_cast<LeafPage *>(new_page->GetData());
-    new_page_data->Init(new_page->GetPageId(), INVALID_PAGE_ID, leaf_max_size_);
-    node_data->MoveHalfTo(new_page_data);
+  // posters of splits of the moved children may find the new page through their parent page id before it is filled
+  new_page->WLatch();
+  auto new_node = reinterpret_cast<N *>(new_page->GetData());
+  int max_size = MaxSize(node);
+  // the key range of the new page is set first, pages that compress keys encode the moved keys for it
+  int size = node->GetSize();
+  int index;
+  if (std::is_same<LeafPage, N>::value) {
+    index = append ? size - 1 : size - size / 2;
+    reinterpret_cast<LeafPage *>(new_node)->Init(new_page_id, node->GetParentPageId(), max_size, &comparator_);
   } else {
-    auto node_data = reinterpret_cast<InternalPage *>(node);
-    auto new_page_data = reinterpret_cast<InternalPage *>(new_page->GetData());
-    new_page_data->Init(new_page->GetPageId(), INVALID_PAGE_ID, internal_max_size_);
-    node_data->MoveHalfTo(new_page_data, buffer_pool_manager_);
+    // the new internal page gets at least two children, so that it can take a split of either
+    index = append ? std::max(size / 2, size - std::max(2, size / 10)) : size / 2;
+    reinterpret_cast<InternalPage *>(new_node)->Init(new_page_id, node->GetParentPageId(), max_size, &comparator_);
   }
-  return reinterpret_cast<N*>(new_page->GetData());
+  KeyType separator = node->KeyAt(index);
+  new_node->SetNextPageId(node->GetNextPageId());
+  new_node->SetHighKey(node->GetHighKey());
+  new_node->SetKeyRange(&separator, max_size);
+  if (std::is_same<LeafPage, N>::value) {
+    reinterpret_cast<LeafPage *>(node)->MoveTailTo(reinterpret_cast<LeafPage *>(new_node), index);
+    reinterpret_cast<LeafPage *>(new_node)->SetPrevPageId(node->GetPageId());
+    if (INVALID_PAGE_ID != new_node->GetNextPageId()) {
+      SetPrevPageId(new_node->GetNextPageId(), new_page_id);
+    } else {
+      rightmost_leaf_page_id_ = new_page_id;
+    }
+  } else {
+    reinterpret_cast<InternalPage *>(node)->MoveTailTo(reinterpret_cast<InternalPage *>(new_node), index,
+                                                       buffer_pool_manager_);
+  }
+  // pages of variable-length keys only know their max size once their entries are in
+  new_node->UpdateMaxSize(max_size);
+  node->SetNextPageId(new_page_id);
+  node->SetHighKey(separator);
+  node->SetKeyRange(node->GetLowKey(), max_size);
+  new_page->WUnlatch();
+  return new_node;
 }
 
 /*
  * Insert key & value pair into internal page after split
- * @param   old_node      input page from split() method
+ * @param   old_page_id   input page from split() method
  * @param   key
- * @param   new_node      returned page from split() method
+ * @param   new_page_id   returned page from split() method
  * User needs to first find the parent page of old_node, parent node must be
  * adjusted to take info of new_node into account. Remember to deal with split
  * recursively if necessary.
+ * No latch is held by the caller, and only one latch at a time is taken here: until the separator is in the parent,
+ * readers reach the new page through the right-link of the old one. The parent is found through the parent page id
+ * of the old page; while a concurrent split or merge of the parent has not yet updated it, the parent does not hold
+ * the old page, and it is read again.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
+void BPLUSTREE_TYPE::InsertIntoParent(page_id_t old_page_id, const KeyType &key, page_id_t new_page_id,
                                       Transaction *transaction) {
-  if (old_node->IsRootPage()) {
-    // case1 create new root
-    auto page = buffer_pool_manager_->NewPage(&root_page_id_);
-    if (nullptr == page) {
-      throw "out of memory";
+  KeyType separator = key;
+  while (true) {
+    auto old_page = buffer_pool_manager_->FetchPage(old_page_id);
+    old_page->RLatch();
+    page_id_t parent_page_id = reinterpret_cast<BPlusTreePage *>(old_page->GetData())->GetParentPageId();
+    old_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(old_page_id, false);
+
+    if (INVALID_PAGE_ID == parent_page_id) {
+      // case1 create new root, unless the old page is the right half of a root split that is not posted yet
+      root_latch_.lock();
+      if (GetRootPageId() == old_page_id) {
+        page_id_t root_page_id;
+        auto page = buffer_pool_manager_->NewPage(&root_page_id);
+        if (nullptr == page) {
+          throw "out of memory";
+        }
+        // the children are reachable already, and so is the new root through their parent page ids
+        page->WLatch();
+        auto root = reinterpret_cast<InternalPage *>(page->GetData());
+        root->Init(root_page_id, INVALID_PAGE_ID, internal_max_size_, &comparator_);
+        root->PopulateNewRoot(old_page_id, separator, new_page_id);
+        for (auto child_page_id : {old_page_id, new_page_id}) {
+          auto child = buffer_pool_manager_->FetchPage(child_page_id);
+          reinterpret_cast<BPlusTreePage *>(child->GetData())->SetParentPageId(root_page_id);
+          buffer_pool_manager_->UnpinPage(child_page_id, true);
+        }
+        SetRootPageId(root_page_id);
+        UpdateRootPageId(false);
+        page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(root_page_id, true);
+        root_latch_.unlock();
+        return;
+      }
+      root_latch_.unlock();
+      std::this_thread::yield();
+      continue;
     }
 
-    auto root = reinterpret_cast<InternalPage * >(page->GetData());
-    root->Init(root_page_id_, INVALID_PAGE_ID, leaf_max_size_);
-    root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
+    auto parent = buffer_pool_manager_->FetchPage(parent_page_id);
+    if (nullptr == parent) {
+      throw "no old node parent page can used";
+    }
+    parent->WLatch();
+    auto parent_page = reinterpret_cast<InternalPage *>(parent->GetData());
+    if (parent_page->IsLeafPage() || INVALID_VALUE_INDEX == parent_page->ValueIndex(old_page_id)) {
+      parent->WUnlatch();
+      buffer_pool_manager_->UnpinPage(parent_page_id, false);
+      std::this_thread::yield();
+      continue;
+    }
+    // a later split of the old page may have been posted and moved on to a right sibling of the parent already
+    while (ShouldMoveRight(parent, separator)) {
+      parent = MoveRight(parent, true);
+      parent_page = reinterpret_cast<InternalPage *>(parent->GetData());
+      parent_page_id = parent->GetPageId();
+    }
+    // the old page may have been split again meanwhile, the new page goes right after the last page of the right-link
+    // chain from the old page to it that is posted to this parent: the old page itself, unless the parent was split
+    // between them
+    page_id_t prev_page_id = PostedPredecessor(parent_page, old_page_id, new_page_id);
+    if (INVALID_PAGE_ID == prev_page_id) {
+      parent->WUnlatch();
+      buffer_pool_manager_->UnpinPage(parent_page_id, false);
+      std::this_thread::yield();
+      continue;
+    }
+    parent_page->InsertNodeAfter(prev_page_id, separator, new_page_id);
+    parent_page->UpdateMaxSize(internal_max_size_);
+    // adopt the new node before a split of the parent may move it on to the new parent
+    auto new_page = buffer_pool_manager_->FetchPage(new_page_id);
+    reinterpret_cast<BPlusTreePage *>(new_page->GetData())->SetParentPageId(parent_page_id);
+    buffer_pool_manager_->UnpinPage(new_page_id, true);
+    if (parent_page->GetSize() < parent_page->GetMaxSize()) {
+      parent->WUnlatch();
+      buffer_pool_manager_->UnpinPage(parent_page_id, true);
+      return;
+    }
 
-    old_node->SetParentPageId(root_page_id_);
-    new_node->SetParentPageId(root_page_id_);
+    // split parent and post that split one level up
+    bool append = INVALID_PAGE_ID == parent_page->GetNextPageId() &&
+                  parent_page->ValueAt(parent_page->GetSize() - 1) == new_page_id;
+    auto new_parent_page = Split<InternalPage>(parent_page, append);
+    separator = parent_page->GetHighKey();
+    old_page_id = parent_page_id;
+    new_page_id = new_parent_page->GetPageId();
+    parent->WUnlatch();
+    buffer_pool_manager_->UnpinPage(parent_page_id, true);
+    buffer_pool_manager_->UnpinPage(new_page_id, true);
+  }
+}
 
-    UpdateRootPageId(false);
+/*
+ * Find the page that the new page of a split is posted after in the write-latched parent: the last page of the
+ * right-link chain from the old page up to the new page that the parent holds. The pages of the chain cannot be
+ * merged while the new page is not posted, as their right-links do not match the parent.
+ * @return: INVALID_PAGE_ID if the parent holds none of them
+ */
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t BPLUSTREE_TYPE::PostedPredecessor(const InternalPage *parent, page_id_t old_page_id,
+                                            page_id_t new_page_id) {
+  page_id_t prev_page_id = INVALID_VALUE_INDEX == parent->ValueIndex(old_page_id) ? INVALID_PAGE_ID : old_page_id;
+  page_id_t page_id = old_page_id;
+  while (true) {
+    auto page = buffer_pool_manager_->FetchPage(page_id);
+    page->RLatch();
+    page_id_t next_page_id = reinterpret_cast<BPlusTreePage *>(page->GetData())->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    if (next_page_id == new_page_id || INVALID_PAGE_ID == next_page_id) {
+      return next_page_id == new_page_id ? prev_page_id : INVALID_PAGE_ID;
+    }
+    page_id = next_page_id;
+    if (INVALID_VALUE_INDEX != parent->ValueIndex(page_id)) {
+      prev_page_id = page_id;
+    }
+  }
+}
 
-    buffer_pool_manager_->UnpinPage(old_node->GetPageId(), true);
-    buffer_pool_manager_->UnpinPage(new_node->GetPageId(), true);
-  } else {
-    // recursive split parent node
-    auto parent_page = reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(old_node->GetParentPageId())->GetData());
-    if (nullptr == parent_page) {
-      throw "no old node parent page can used";
+/*****************************************************************************
+ * BULK LOADING
+ *****************************************************************************/
+/*
+ * Build the empty tree bottom-up: pairs are appended to a leaf until it holds
+ * fill_factor of its max size, then the next leaf is started, and every level
+ * of internal pages is built the same way from the first keys of the pages
+ * below it, until one page, the root, is left. No page is ever split, and
+ * every page is written once, left to right.
+ * A pair with the key of the pair before it is skipped by a unique tree, as
+ * Insert() would reject it, and a non-unique tree builds the posting list of
+ * the key from all of them at once. The root latch is held for the whole load.
+ * @return: false if the tree is not empty, true otherwise
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::BulkLoad(const std::function<bool(MappingType *)> &next, double fill_factor,
+                              Transaction *transaction) {
+  std::scoped_lock root_latch{root_latch_};
+  if (!IsEmpty()) {
+    return false;
+  }
+  // at least half-full, and an internal page splits as soon as it is full; pages are filled while their key range
+  // is still open above, so that they hold as many entries as they do when they are split
+  auto internal_fill = [fill_factor](const InternalPage *node) {
+    int max_size = node->GetMaxSize();
+    return std::min(std::max(static_cast<int>(fill_factor * max_size), std::max(2, max_size / 2)), max_size - 1);
+  };
+
+  // the values of the last key appended to the current leaf
+  std::vector<ValueType> values;
+  auto set_values = [this, &values](LeafPage *leaf) {
+    if (values.size() > 1) {
+      std::sort(values.begin(), values.end(), [](const RID &lhs, const RID &rhs) { return lhs.Get() < rhs.Get(); });
+      values.erase(std::unique(values.begin(), values.end()), values.end());
+      leaf->SetValueAt(leaf->GetSize() - 1, values.size() > 1 ? BuildPostingList(values) : values[0]);
     }
+    values.clear();
+  };
 
-    parent_page->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
-    if (parent_page->GetSize() < parent_page->GetMaxSize()) {
-      // parent no need to split and can insert directly
-      new_node->SetParentPageId(parent_page->GetPageId());
-      buffer_pool_manager_->UnpinPage(new_node->GetPageId(), true);
+  // the first key and the page id of each page of the level being built
+  std::vector<std::pair<KeyType, page_id_t>> level;
+  Page *prev_page = nullptr;
+  Page *page = nullptr;
+  MappingType item;
+  while (next(&item)) {
+    auto leaf = nullptr == page ? nullptr : reinterpret_cast<LeafPage *>(page->GetData());
+    if (nullptr != leaf && comparator_(item.first, leaf->KeyAt(leaf->GetSize() - 1)) == 0) {
+      if (!unique_) {
+        values.push_back(item.second);
+      }
+      continue;
+    }
+    if (nullptr != leaf) {
+      set_values(leaf);
+    }
+    if (nullptr == leaf || leaf->GetSize() >= LeafFillSize(leaf, fill_factor)) {
+      page_id_t page_id;
+      auto new_page = buffer_pool_manager_->NewPage(&page_id);
+      if (nullptr == new_page) {
+        throw "out of memory";
+      }
+      auto new_leaf = reinterpret_cast<LeafPage *>(new_page->GetData());
+      new_leaf->Init(page_id, INVALID_PAGE_ID, leaf_max_size_, &comparator_);
+      if (nullptr != leaf) {
+        new_leaf->SetPrevPageId(leaf->GetPageId());
+        new_leaf->SetKeyRange(&item.first, leaf_max_size_);
+        leaf->SetNextPageId(page_id);
+        leaf->SetHighKey(item.first);
+        leaf->SetKeyRange(leaf->GetLowKey(), leaf_max_size_);
+      }
+      if (nullptr != prev_page) {
+        buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+      }
+      prev_page = page;
+      page = new_page;
+      leaf = reinterpret_cast<LeafPage *>(page->GetData());
+      level.emplace_back(item.first, page_id);
+    }
+    leaf->Insert(item.first, item.second, comparator_);
+    leaf->UpdateMaxSize(leaf_max_size_);
+    values.push_back(item.second);
+  }
+  if (nullptr == page) {
+    return true;
+  }
+  set_values(reinterpret_cast<LeafPage *>(page->GetData()));
+  if (nullptr != prev_page) {
+    // fill up the last leaf from the one before it
+    auto prev_leaf = reinterpret_cast<LeafPage *>(prev_page->GetData());
+    auto leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    while (leaf->GetSize() < leaf->GetMinSize() && prev_leaf->GetSize() > prev_leaf->GetMinSize()) {
+      prev_leaf->MoveLastToFrontOf(leaf);
+    }
+    KeyType separator = leaf->KeyAt(0);
+    prev_leaf->SetHighKey(separator);
+    prev_leaf->SetKeyRange(prev_leaf->GetLowKey(), leaf_max_size_);
+    leaf->SetKeyRange(&separator, leaf_max_size_);
+    level.back().first = separator;
+    buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+
+  while (level.size() > 1) {
+    // the children are spread evenly, so that the last page of the level is not left underfull
+    int size = static_cast<int>(level.size());
+    int pages = 1;
+    std::vector<std::pair<KeyType, page_id_t>> upper_level;
+    InternalPage *prev_node = nullptr;
+    int begin = 0;
+    for (int i = 0; i < pages; i++) {
+      page_id_t page_id;
+      auto new_page = buffer_pool_manager_->NewPage(&page_id);
+      if (nullptr == new_page) {
+        throw "out of memory";
+      }
+      auto node = reinterpret_cast<InternalPage *>(new_page->GetData());
+      node->Init(page_id, INVALID_PAGE_ID, internal_max_size_, &comparator_);
+      if (0 == i) {
+        int fill = internal_fill(node);
+        pages = (size + fill - 1) / fill;
+      } else {
+        node->SetKeyRange(&level[begin].first, internal_max_size_);
+      }
+      int end = begin + (size - begin) / (pages - i);
+      for (int j = begin; j < end; j++) {
+        node->Append(level[j].first, level[j].second);
+        auto child = buffer_pool_manager_->FetchPage(level[j].second);
+        reinterpret_cast<BPlusTreePage *>(child->GetData())->SetParentPageId(page_id);
+        buffer_pool_manager_->UnpinPage(level[j].second, true);
+      }
+      if (nullptr != prev_node) {
+        prev_node->SetNextPageId(page_id);
+        prev_node->SetHighKey(level[begin].first);
+        prev_node->SetKeyRange(prev_node->GetLowKey(), internal_max_size_);
+        buffer_pool_manager_->UnpinPage(prev_node->GetPageId(), true);
+      }
+      prev_node = node;
+      upper_level.emplace_back(level[begin].first, page_id);
+      begin = end;
+    }
+    buffer_pool_manager_->UnpinPage(prev_node->GetPageId(), true);
+    level = std::move(upper_level);
+  }
+
+  SetRootPageId(level[0].second);
+  UpdateRootPageId(true);
+  return true;
+}
+
+/*
+ * Compact the leaves parent by parent, left to right along the level above the leaves: each parent is write-latched
+ * while its leaves are rewritten (see CompactLeaves()), so no reader or writer can reach them through it meanwhile,
+ * and the parent after it is latched before it is released. Only the leaves are compacted, they are most of the
+ * pages of a tree, and their parents take their new separators without growing.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::Compact(double fill_factor, bool relocate, Transaction *transaction) {
+  int freed = 0;
+  auto page = LatchFirstLeafParent();
+  while (nullptr != page) {
+    auto parent = reinterpret_cast<InternalPage *>(page->GetData());
+    std::vector<page_id_t> deleted_pages;
+    freed += CompactLeaves(parent, fill_factor, relocate, &deleted_pages);
+    bool last = INVALID_PAGE_ID == parent->GetNextPageId();
+    if (last && parent->IsRootPage() && 1 == parent->GetSize() && parent->GetPageId() == GetRootPageId()) {
+      // a root left with a single leaf collapses, as it does after a merge
+      AdjustRoot(parent, &deleted_pages);
+    }
+    if (last) {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+      page = nullptr;
     } else {
-      // split parent
-      auto new_parent_page = Split<InternalPage >(parent_page);
-      new_parent_page->SetMaxSize(internal_max_size_);
+      auto next_page = buffer_pool_manager_->FetchPage(parent->GetNextPageId());
+      if (nullptr == next_page) {
+        throw "not find right page page_id:" + std::to_string(parent->GetNextPageId());
+      }
+      next_page->WLatch();
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+      page = next_page;
+    }
+    for (auto page_id : deleted_pages) {
+      DeleteLeaf(page_id);
+    }
+  }
+  return freed;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::StartBackgroundCleanup(std::chrono::milliseconds interval, double fill_factor) {
+  StopBackgroundCleanup();
+  {
+    std::scoped_lock latch{cleanup_latch_};
+    enable_background_cleanup_ = true;
+  }
+  cleanup_thread_ = std::thread(&BPLUSTREE_TYPE::RunBackgroundCleanup, this, interval, fill_factor);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::StopBackgroundCleanup() {
+  if (!cleanup_thread_.joinable()) {
+    return;
+  }
+  {
+    std::scoped_lock latch{cleanup_latch_};
+    enable_background_cleanup_ = false;
+  }
+  cleanup_cv_.notify_all();
+  cleanup_thread_.join();
+}
 
-      buffer_pool_manager_->UnpinPage(new_node->GetPageId(), true);
-      InsertIntoParent(parent_page, new_parent_page->KeyAt(0), new_parent_page, transaction);
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RunBackgroundCleanup(std::chrono::milliseconds interval, double fill_factor) {
+  std::unique_lock latch{cleanup_latch_};
+  // woken up early only to stop
+  while (!cleanup_cv_.wait_for(latch, interval, [this] { return !enable_background_cleanup_; })) {
+    latch.unlock();
+    // only sparse leaves are merged, relocating leaves that split under steady churn would rewrite them over and over
+    if (deferred_merges_.exchange(0) > 0) {
+      Compact(fill_factor, false);
+    }
+    latch.lock();
+  }
+}
+
+/*
+ * Rewrite the leaves of the write-latched parent a window at a time: up to COMPACT_WINDOW consecutive children with
+ * their splits posted, rewritten into new leaves if their entries fit fewer leaves, or (to relocate them) if they do
+ * not follow the leaf before them in page order. Leaves are latched left to right, and the leaf before the window stays latched to take
+ * the right-link of the new leaves; the leaf before the first child belongs to another parent and is only taken if it
+ * is free. The emptied leaves link to the first new leaf, so that a stale iterator finds its place again by moving
+ * right from there, as it does from a leaf emptied by a merge.
+ * @return the number of leaves freed
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::CompactLeaves(InternalPage *parent, double fill_factor, bool relocate,
+                                  std::vector<page_id_t> *deleted_pages) {
+  int freed = 0;
+  // the leaf before the window, write-latched
+  Page *prev = nullptr;
+  int index = 0;
+  while (index < parent->GetSize()) {
+    std::vector<Page *> window;
+    int entries = 0;
+    bool settled = true;
+    while (settled && index + static_cast<int>(window.size()) < parent->GetSize() && window.size() < COMPACT_WINDOW) {
+      int child_index = index + static_cast<int>(window.size());
+      auto page = buffer_pool_manager_->FetchPage(parent->ValueAt(child_index));
+      if (nullptr == page) {
+        throw "not find child page of page_id:" + std::to_string(parent->GetPageId());
+      }
+      page->WLatch();
+      window.push_back(page);
+      auto leaf = reinterpret_cast<LeafPage *>(page->GetData());
+      entries += leaf->GetSize();
+      settled = IsSettled(parent, child_index, leaf);
+    }
+    auto first_leaf = reinterpret_cast<LeafPage *>(window[0]->GetData());
+    if (nullptr == prev && INVALID_PAGE_ID != first_leaf->GetPrevPageId()) {
+      prev = buffer_pool_manager_->FetchPage(first_leaf->GetPrevPageId());
+      if (nullptr == prev) {
+        throw "not find page page_id:" + std::to_string(first_leaf->GetPrevPageId());
+      }
+      if (!prev->TryWLatch()) {
+        buffer_pool_manager_->UnpinPage(prev->GetPageId(), false);
+        prev = nullptr;
+      }
+    }
+    // the prev-link is a hint, and the leaf before may have a split that is not posted yet
+    bool linked = nullptr == prev
+                      ? INVALID_PAGE_ID == first_leaf->GetPrevPageId()
+                      : reinterpret_cast<LeafPage *>(prev->GetData())->GetNextPageId() == window[0]->GetPageId();
+    bool in_order = true;
+    page_id_t last_page_id = nullptr == prev ? INVALID_PAGE_ID : prev->GetPageId();
+    for (auto page : window) {
+      in_order = in_order && (INVALID_PAGE_ID == last_page_id || page->GetPageId() == last_page_id + 1);
+      last_page_id = page->GetPageId();
+    }
+    int fill = LeafFillSize(first_leaf, fill_factor);
+    int pages = (entries + fill - 1) / fill;
+    // leaves above fill_factor are only relocated as long as they need no more leaves, the parent must not grow
+    bool sparse = pages < static_cast<int>(window.size());
+    bool fits = pages <= static_cast<int>(window.size());
+
+    std::vector<Page *> new_pages;
+    if (settled && linked && entries > 0 && (sparse || (relocate && fits && !in_order))) {
+      // fill new leaves as a bulk load does, each one while its key range is still open above
+      LeafPage *leaf = nullptr;
+      for (auto page : window) {
+        auto old_leaf = reinterpret_cast<LeafPage *>(page->GetData());
+        for (int i = 0; i < old_leaf->GetSize(); i++) {
+          MappingType item = old_leaf->GetItem(i);
+          if (nullptr == leaf || leaf->GetSize() >= LeafFillSize(leaf, fill_factor)) {
+            page_id_t page_id;
+            auto new_page = buffer_pool_manager_->NewPage(&page_id);
+            if (nullptr == new_page) {
+              throw "out of memory";
+            }
+            new_page->WLatch();
+            auto new_leaf = reinterpret_cast<LeafPage *>(new_page->GetData());
+            new_leaf->Init(page_id, parent->GetPageId(), leaf_max_size_, &comparator_);
+            if (nullptr == leaf) {
+              new_leaf->SetPrevPageId(nullptr == prev ? INVALID_PAGE_ID : prev->GetPageId());
+              new_leaf->SetKeyRange(first_leaf->GetLowKey(), leaf_max_size_);
+            } else {
+              new_leaf->SetPrevPageId(leaf->GetPageId());
+              new_leaf->SetKeyRange(&item.first, leaf_max_size_);
+              leaf->SetNextPageId(page_id);
+              leaf->SetHighKey(item.first);
+              leaf->SetKeyRange(leaf->GetLowKey(), leaf_max_size_);
+            }
+            new_pages.push_back(new_page);
+            leaf = new_leaf;
+          }
+          leaf->Insert(item.first, item.second, comparator_);
+          leaf->UpdateMaxSize(leaf_max_size_);
+        }
+      }
+      if (new_pages.size() > 1) {
+        // fill up the last leaf from the one before it
+        auto before = reinterpret_cast<LeafPage *>(new_pages[new_pages.size() - 2]->GetData());
+        while (leaf->GetSize() < leaf->GetMinSize() && before->GetSize() > before->GetMinSize()) {
+          before->MoveLastToFrontOf(leaf);
+        }
+        KeyType separator = leaf->KeyAt(0);
+        before->SetHighKey(separator);
+        before->SetKeyRange(before->GetLowKey(), leaf_max_size_);
+        before->UpdateMaxSize(leaf_max_size_);
+      }
+    }
+    if (new_pages.size() > window.size()) {
+      // the fill size of a leaf depends on its key range, the new leaves may not fit after all
+      for (auto page : new_pages) {
+        page_id_t page_id = page->GetPageId();
+        page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(page_id, false);
+        buffer_pool_manager_->DeletePage(page_id);
+      }
+      new_pages.clear();
+    }
+    if (!new_pages.empty()) {
+      auto leaf = reinterpret_cast<LeafPage *>(new_pages.back()->GetData());
+      auto last_old_leaf = reinterpret_cast<LeafPage *>(window.back()->GetData());
+      KeyType low_key = leaf->KeyAt(0);
+      leaf->SetNextPageId(last_old_leaf->GetNextPageId());
+      leaf->SetHighKey(last_old_leaf->GetHighKey());
+      leaf->SetKeyRange(new_pages.size() > 1 ? &low_key : leaf->GetLowKey(), leaf_max_size_);
+      leaf->UpdateMaxSize(leaf_max_size_);
+      if (INVALID_PAGE_ID != leaf->GetNextPageId()) {
+        SetPrevPageId(leaf->GetNextPageId(), leaf->GetPageId());
+      } else {
+        rightmost_leaf_page_id_ = leaf->GetPageId();
+      }
+      if (nullptr != prev) {
+        reinterpret_cast<LeafPage *>(prev->GetData())->SetNextPageId(new_pages[0]->GetPageId());
+      }
+
+      // the new leaves take the place of the window in the parent, separated by their first keys
+      for (size_t i = 1; i < window.size(); i++) {
+        parent->Remove(index + 1);
+      }
+      parent->SetValueAt(index, new_pages[0]->GetPageId());
+      for (size_t i = 1; i < new_pages.size(); i++) {
+        parent->InsertNodeAfter(new_pages[i - 1]->GetPageId(),
+                                reinterpret_cast<LeafPage *>(new_pages[i]->GetData())->KeyAt(0),
+                                new_pages[i]->GetPageId());
+      }
+      parent->UpdateMaxSize(internal_max_size_);
+
+      for (auto page : window) {
+        auto old_leaf = reinterpret_cast<LeafPage *>(page->GetData());
+        old_leaf->SetSize(0);
+        old_leaf->SetNextPageId(new_pages[0]->GetPageId());
+        // the frame may hold another page once it is unpinned
+        deleted_pages->push_back(page->GetPageId());
+        page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+      }
+      freed += static_cast<int>(window.size() - new_pages.size());
+      window = std::move(new_pages);
     }
-    buffer_pool_manager_->UnpinPage(old_node->GetPageId(), true);
+
+    // the last leaf of the window is the leaf before the next one
+    if (nullptr != prev) {
+      prev->WUnlatch();
+      buffer_pool_manager_->UnpinPage(prev->GetPageId(), true);
+    }
+    for (size_t i = 0; i + 1 < window.size(); i++) {
+      window[i]->WUnlatch();
+      buffer_pool_manager_->UnpinPage(window[i]->GetPageId(), true);
+    }
+    prev = window.back();
+    index += static_cast<int>(window.size());
+  }
+  if (nullptr != prev) {
+    prev->WUnlatch();
+    buffer_pool_manager_->UnpinPage(prev->GetPageId(), true);
+  }
+  return freed;
+}
+
+/*****************************************************************************
+ * POSTING LISTS
+ *****************************************************************************/
+/*
+ * Add a value to the RIDs of a leaf entry value: a second RID starts a posting
+ * list, and the leaf entry value is set to reference it. The value goes to the
+ * last page of the chain that starts at or below it, which is split if full.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::InsertIntoPostingList(ValueType *entry_value, const ValueType &value) {
+  if (!BPlusTreePostingPage::IsReference(*entry_value)) {
+    if (*entry_value == value) {
+      return false;
+    }
+    *entry_value = value.Get() < entry_value->Get() ? BuildPostingList({value, *entry_value})
+                                                    : BuildPostingList({*entry_value, value});
+    return true;
+  }
+  auto page = buffer_pool_manager_->FetchPage(entry_value->GetPageId());
+  auto posting_page = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+  while (INVALID_PAGE_ID != posting_page->GetNextPageId()) {
+    auto next_page = buffer_pool_manager_->FetchPage(posting_page->GetNextPageId());
+    auto next_posting_page = reinterpret_cast<BPlusTreePostingPage *>(next_page->GetData());
+    if (value.Get() < next_posting_page->ValueAt(0).Get()) {
+      buffer_pool_manager_->UnpinPage(next_page->GetPageId(), false);
+      break;
+    }
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = next_page;
+    posting_page = next_posting_page;
+  }
+  int index = posting_page->ValueIndex(value);
+  if (index < posting_page->GetSize() && posting_page->ValueAt(index) == value) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    return false;
+  }
+  if (posting_page->IsFull()) {
+    page_id_t new_page_id;
+    auto new_page = buffer_pool_manager_->NewPage(&new_page_id);
+    if (nullptr == new_page) {
+      throw "out of memory";
+    }
+    auto new_posting_page = reinterpret_cast<BPlusTreePostingPage *>(new_page->GetData());
+    new_posting_page->Init(new_page_id);
+    posting_page->MoveHalfTo(new_posting_page);
+    (value.Get() < new_posting_page->ValueAt(0).Get() ? posting_page : new_posting_page)->Insert(value);
+    buffer_pool_manager_->UnpinPage(new_page_id, true);
+  } else {
+    posting_page->Insert(value);
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  return true;
+}
+
+/*
+ * Remove a value from the posting list a leaf entry value references. A page
+ * is merged into the page before it once both fit half a page or it is empty
+ * (the page after the first page is merged into it instead), and the last RID
+ * left of a posting list replaces the reference in the leaf entry.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::RemoveFromPostingList(ValueType *entry_value, const ValueType &value) {
+  page_id_t head_page_id = entry_value->GetPageId();
+  Page *prev_page = nullptr;
+  auto page = buffer_pool_manager_->FetchPage(head_page_id);
+  auto posting_page = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+  while (INVALID_PAGE_ID != posting_page->GetNextPageId()) {
+    auto next_page = buffer_pool_manager_->FetchPage(posting_page->GetNextPageId());
+    auto next_posting_page = reinterpret_cast<BPlusTreePostingPage *>(next_page->GetData());
+    if (value.Get() < next_posting_page->ValueAt(0).Get()) {
+      buffer_pool_manager_->UnpinPage(next_page->GetPageId(), false);
+      break;
+    }
+    if (nullptr != prev_page) {
+      buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), false);
+    }
+    prev_page = page;
+    page = next_page;
+    posting_page = next_posting_page;
+  }
+  bool removed = posting_page->Remove(value);
+  std::vector<page_id_t> deleted_pages;
+  if (removed) {
+    // merge the page into the one before it, or the one after it into the page if it is the first one
+    Page *left_page = prev_page;
+    Page *right_page = page;
+    if (nullptr == prev_page && INVALID_PAGE_ID != posting_page->GetNextPageId()) {
+      left_page = page;
+      right_page = buffer_pool_manager_->FetchPage(posting_page->GetNextPageId());
+    }
+    if (nullptr != left_page && left_page != right_page) {
+      auto left = reinterpret_cast<BPlusTreePostingPage *>(left_page->GetData());
+      auto right = reinterpret_cast<BPlusTreePostingPage *>(right_page->GetData());
+      // an empty page is always unlinked, no page after the first one is ever empty
+      if (0 == left->GetSize() || 0 == right->GetSize() ||
+          left->GetSize() + right->GetSize() <= static_cast<int>(POSTING_PAGE_SIZE) / 2) {
+        left->MoveAllFrom(right);
+        deleted_pages.push_back(right->GetPageId());
+      }
+      if (right_page != page) {
+        buffer_pool_manager_->UnpinPage(right_page->GetPageId(), false);
+      }
+    }
+  }
+  if (nullptr != prev_page) {
+    buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), removed);
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), removed);
+  for (auto page_id : deleted_pages) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  if (!removed) {
+    return false;
+  }
+
+  auto head_page = buffer_pool_manager_->FetchPage(head_page_id);
+  auto head = reinterpret_cast<BPlusTreePostingPage *>(head_page->GetData());
+  bool last = 1 == head->GetSize() && INVALID_PAGE_ID == head->GetNextPageId();
+  if (last) {
+    *entry_value = head->ValueAt(0);
+  }
+  buffer_pool_manager_->UnpinPage(head_page_id, false);
+  if (last) {
+    buffer_pool_manager_->DeletePage(head_page_id);
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+ValueType BPLUSTREE_TYPE::BuildPostingList(const std::vector<ValueType> &values) {
+  page_id_t head_page_id = INVALID_PAGE_ID;
+  Page *page = nullptr;
+  for (const auto &value : values) {
+    auto posting_page = nullptr == page ? nullptr : reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+    if (nullptr == posting_page || posting_page->IsFull()) {
+      page_id_t page_id;
+      auto new_page = buffer_pool_manager_->NewPage(&page_id);
+      if (nullptr == new_page) {
+        throw "out of memory";
+      }
+      reinterpret_cast<BPlusTreePostingPage *>(new_page->GetData())->Init(page_id);
+      if (nullptr == posting_page) {
+        head_page_id = page_id;
+      } else {
+        posting_page->SetNextPageId(page_id);
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+      }
+      page = new_page;
+      posting_page = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+    }
+    posting_page->Insert(value);
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  return BPlusTreePostingPage::Reference(head_page_id);
+}
+
+/*
+ * Append the RIDs of a leaf entry value. Only a non-unique tree has posting
+ * lists: a unique tree stores any RID as is, even one that looks like a reference.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReadValues(const ValueType &entry_value, std::vector<ValueType> *result) {
+  if (unique_) {
+    result->push_back(entry_value);
+    return;
+  }
+  BPlusTreePostingPage::ReadValues(entry_value, buffer_pool_manager_, result);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeletePostingList(const ValueType &entry_value) {
+  if (unique_ || !BPlusTreePostingPage::IsReference(entry_value)) {
+    return;
+  }
+  for (page_id_t page_id = entry_value.GetPageId(); INVALID_PAGE_ID != page_id;) {
+    auto page = buffer_pool_manager_->FetchPage(page_id);
+    page_id_t next_page_id = reinterpret_cast<BPlusTreePostingPage *>(page->GetData())->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    buffer_pool_manager_->DeletePage(page_id);
+    page_id = next_page_id;
   }
 }
 
@@ -235,60 +1107,199 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
  * If not, User needs to first find the right leaf page as deletion target, then
  * delete entry from leaf page. Remember to deal with redistribute or merge if
  * necessary.
+ * Most deletes do not underflow their leaf, so the leaf is first found optimistically (see FindLeafPageOptimistic()),
+ * and the path is only write-latched from the root when the leaf would underflow.
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
-    LockRootPage(true);
-    if (IsEmpty()) {
-        return;
+  RemoveEntry(key, nullptr, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Remove(const KeyType &key, const ValueType &value, Transaction *transaction) {
+  RemoveEntry(key, &value, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RemoveEntry(const KeyType &key, const ValueType *value, Transaction *transaction) {
+  auto leaf_page = FindLeafPageOptimistic(key);
+  if (nullptr == leaf_page) {
+    return;
+  }
+  bool shrinks = false;
+  bool changed = RemoveFromLeaf(reinterpret_cast<LeafPage *>(leaf_page->GetData()), key, value,
+                                IsSafe(Operation::DELETE, leaf_page), &shrinks);
+  leaf_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), changed);
+  if (!shrinks || changed) {
+    return;
+  }
+
+  // a merge that must wait for a concurrent split to be posted, or for a latched sibling, is retried from the root,
+  // backing off after MERGE_SPIN_RETRIES attempts, and the page is left underfull as a deferred merge after
+  // MERGE_RETRIES attempts
+  bool removed = false;
+  bool retry = true;
+  for (int attempt = 0; retry; attempt++) {
+    if (MERGE_RETRIES == attempt) {
+      deferred_merges_++;
+      return;
     }
-    std::deque<Page*> lock_page_deq;
+    retry = false;
+    std::deque<Page *> lock_page_deq;
     auto leafPage = FindLeafPage(key, false, Operation::DELETE, transaction, &lock_page_deq);
     if (nullptr == leafPage) {
-        UnlockPages(Operation::DELETE, lock_page_deq);
-        return;
+      return;
     }
-
-    auto leafNode = reinterpret_cast<LeafPage * >(leafPage->GetData());
-    int src_size = leafNode->GetSize();
-    int size = leafNode->RemoveAndDeleteRecord(key, comparator_);
-    if (size < leafNode->GetMinSize()) {
-        // case 2: borrow a node from left sibling
-        CoalesceOrRedistribute(leafNode, transaction);
+    if (!removed) {
+      // the entry may have changed meanwhile, and no longer shrink the leaf
+      RemoveFromLeaf(reinterpret_cast<LeafPage *>(leafPage->GetData()), key, value, true, &shrinks);
+      removed = true;
+    }
+    // the deepest underflowing page of the latched path
+    std::vector<page_id_t> deleted_pages;
+    for (auto it = lock_page_deq.rbegin(); it != lock_page_deq.rend(); ++it) {
+      auto node = reinterpret_cast<BPlusTreePage *>((*it)->GetData());
+      if (node->IsRootPage() ? node->GetSize() <= (node->IsLeafPage() ? 0 : 1) : node->GetSize() < MergeSize(node)) {
+        if (node->IsLeafPage()) {
+          CoalesceOrRedistribute(reinterpret_cast<LeafPage *>(node), lock_page_deq, &deleted_pages, &retry, transaction);
+        } else {
+          CoalesceOrRedistribute(reinterpret_cast<InternalPage *>(node), lock_page_deq, &deleted_pages, &retry,
+                                 transaction);
+        }
+        break;
+      }
     }
     UnlockPages(Operation::DELETE, lock_page_deq);
-    UnlockRootPage(true);
-    node_size_ -= (src_size - size);
+    for (auto page_id : deleted_pages) {
+      DeleteLeaf(page_id);
+    }
+    if (retry && attempt < MERGE_SPIN_RETRIES) {
+      std::this_thread::yield();
+    } else if (retry) {
+      // back off, the split or latch waited for belongs to a thread that may not get to run otherwise
+      std::this_thread::sleep_for(std::chrono::microseconds(1 << std::min(attempt - MERGE_SPIN_RETRIES, 10)));
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::RemoveFromLeaf(LeafPage *leaf, const KeyType &key, const ValueType *value, bool may_shrink,
+                                    bool *shrinks) {
+  *shrinks = false;
+  int index = leaf->KeyIndex(key, comparator_);
+  if (index == leaf->GetSize() || comparator_(leaf->KeyAt(index), key) != 0) {
+    return false;
+  }
+  ValueType entry_value = leaf->ValueAt(index);
+  if (nullptr != value && !unique_ && BPlusTreePostingPage::IsReference(entry_value)) {
+    if (!RemoveFromPostingList(&entry_value, *value)) {
+      return false;
+    }
+    leaf->SetValueAt(index, entry_value);
+    return true;
+  }
+  if (nullptr != value && !(entry_value == *value)) {
+    return false;
+  }
+  *shrinks = true;
+  if (!may_shrink) {
+    return false;
+  }
+  DeletePostingList(entry_value);
+  leaf->RemoveAndDeleteRecord(key, comparator_);
+  leaf->UpdateMaxSize(leaf_max_size_);
+  if (!leaf->IsRootPage() && leaf->GetSize() < leaf->GetMinSize() && leaf->GetSize() >= MergeSize(leaf)) {
+    deferred_merges_++;
+  }
+  return true;
 }
 
 /*
  * User needs to first find the sibling of input page. If sibling's size + input
  * page's size > page's max size, then redistribute. Otherwise, merge.
  * Using template N to represent either internal page or leaf page.
+ * The node and every ancestor that may underflow are write-latched by the caller (in lock_page_que), the sibling is
+ * latched here. A node is left underfull, and retry is set, when its parent is not latched, because the node was
+ * reached through a right-link, when the node or its sibling has a split that is not posted to the parent yet, or
+ * when the left sibling is latched. Emptied pages are added to deleted_pages, to be deleted once they are unlatched
+ * and unpinned.
  * @return: true means target leaf page should be deleted, false means no
  * deletion happens
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
-    BPlusTreePage* bnode = reinterpret_cast<BPlusTreePage*>(node);
-    if (bnode->IsRootPage()) {
-        return AdjustRoot(bnode);
-    }
-    auto parent_page = reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(bnode->GetParentPageId())->GetData());
-    // leaf page must be have parent internal page
-    int vIdx = parent_page->ValueIndex(bnode->GetPageId());
-    int sibling_page_id = parent_page->FindSibling(bnode->GetPageId());
-    auto sibling_page = reinterpret_cast<N *>(buffer_pool_manager_->FetchPage(sibling_page_id)->GetData());
-    assert(nullptr != sibling_page);
-
-    if (bnode->GetMaxSize() < sibling_page->GetSize() + bnode->GetSize()) {
-        Redistribute(sibling_page, node, vIdx);
-    } else {
-        return Coalesce(&sibling_page, &node, &parent_page, vIdx, transaction);
+bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, const std::deque<Page *> &lock_page_que,
+                                            std::vector<page_id_t> *deleted_pages, bool *retry,
+                                            Transaction *transaction) {
+  auto bnode = reinterpret_cast<BPlusTreePage *>(node);
+  if (bnode->IsRootPage()) {
+    // a page without parent is also the right half of a root split that is not posted yet, or a root with one
+    if (bnode->GetPageId() != GetRootPageId() || bnode->HasHighKey()) {
+      *retry = true;
+      return false;
     }
-
+    return AdjustRoot(bnode, deleted_pages);
+  }
+  page_id_t parent_page_id = bnode->GetParentPageId();
+  if (std::none_of(lock_page_que.begin(), lock_page_que.end(),
+                   [parent_page_id](Page *page) { return page->GetPageId() == parent_page_id; })) {
+    *retry = true;
+    return false;
+  }
+  auto parent = buffer_pool_manager_->FetchPage(parent_page_id);
+  auto parent_page = reinterpret_cast<InternalPage *>(parent->GetData());
+  // leaf page must be have parent internal page
+  int vIdx = parent_page->ValueIndex(bnode->GetPageId());
+  if (INVALID_VALUE_INDEX == vIdx || !IsSettled(parent_page, vIdx, node)) {
+    buffer_pool_manager_->UnpinPage(parent_page_id, false);
+    *retry = true;
+    return false;
+  }
+  if (parent_page->GetSize() < 2) {
+    // the only child of a parent left underfull earlier, the parent must be merged first
+    buffer_pool_manager_->UnpinPage(parent_page_id, false);
+    *retry = true;
+    return CoalesceOrRedistribute(parent_page, lock_page_que, deleted_pages, retry, transaction);
+  }
+  int sibling_index = 0 == vIdx ? 1 : vIdx - 1;
+  auto sibling = buffer_pool_manager_->FetchPage(parent_page->ValueAt(sibling_index));
+  // pages are latched left to right, a left sibling is only taken if it is free, readers may be waiting on this node
+  if (0 == vIdx) {
+    sibling->WLatch();
+  } else if (!sibling->TryWLatch()) {
+    buffer_pool_manager_->UnpinPage(sibling->GetPageId(), false);
+    buffer_pool_manager_->UnpinPage(parent_page_id, false);
+    *retry = true;
+    return false;
+  }
+  auto sibling_page = reinterpret_cast<N *>(sibling->GetData());
+  if (!IsSettled(parent_page, sibling_index, sibling_page)) {
+    sibling->WUnlatch();
+    buffer_pool_manager_->UnpinPage(sibling->GetPageId(), false);
+    buffer_pool_manager_->UnpinPage(parent_page_id, false);
+    *retry = true;
     return false;
+  }
+
+  // an internal page splits as soon as it is full, so merged internal pages must stay below their max size, which
+  // is the max size of the left page for the key range of both if they compress keys
+  N *left = 0 == vIdx ? node : sibling_page;
+  N *right = 0 == vIdx ? sibling_page : node;
+  int merged_size = sibling_page->GetSize() + bnode->GetSize();
+  int merged_max_size =
+      left->MaxSizeFor(left->GetLowKey(), right->HasHighKey() ? &right->GetHighKey() : nullptr, MaxSize(bnode));
+  bool redistribute = bnode->IsLeafPage() ? merged_size > merged_max_size : merged_size >= merged_max_size;
+  bool deleted = false;
+  if (redistribute) {
+    Redistribute(sibling_page, node, vIdx);
+  } else {
+    deleted = Coalesce(&sibling_page, &node, &parent_page, vIdx, lock_page_que, deleted_pages, retry, transaction);
+  }
+  sibling->WUnlatch();
+  buffer_pool_manager_->UnpinPage(sibling->GetPageId(), true);
+  buffer_pool_manager_->UnpinPage(parent_page_id, true);
+  return deleted;
 }
 
 /*
@@ -297,6 +1308,9 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
  * take info of deletion into account. Remember to deal with coalesce or
  * redistribute recursively if necessary.
  * Using template N to represent either internal page or leaf page.
+ * The right one of the two pages is always merged into the left one, which takes over its right-link and high key.
+ * The emptied page links to the left one, for iterators that still hold its page id. The leaf after two merged leaves
+ * is latched (left to right) to set its prev-link.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
  * @param   parent             parent page of input "node"
@@ -307,43 +1321,36 @@ INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
 bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
                               BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent, int index,
-                              Transaction *transaction) {
-    auto parent_page  = *parent;
-    if (std::is_same<LeafPage , N>::value) {
-        auto node_page = reinterpret_cast<LeafPage *>(*node);
-        auto neighbor_page = reinterpret_cast<LeafPage *>(*neighbor_node);
-        LeafPage* delete_page = nullptr;
-        if (0 == index) {
-            // right merge into left end
-            neighbor_page->MoveAllTo(node_page);
-            delete_page = neighbor_page;
-        } else {
-            node_page->MoveAllTo(neighbor_page);
-            delete_page = node_page;
-        }
-        parent_page->Remove(parent_page->ValueIndex(delete_page->GetPageId()));
-        buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
-        buffer_pool_manager_->DeletePage(delete_page->GetPageId());
-
-    } else {
-        auto node_page = reinterpret_cast<InternalPage *>(*node);
-        auto neighbor_page = reinterpret_cast<InternalPage *>(*neighbor_node);
-        InternalPage* delete_page = nullptr;
-        KeyType middle_key;
-        if (0 == index) {
-            neighbor_page->MoveAllTo(node_page, middle_key, buffer_pool_manager_);
-            delete_page = neighbor_page;
-        } else {
-            node_page->MoveAllTo(neighbor_page, middle_key, buffer_pool_manager_);
-            delete_page = node_page;
-        }
-
-        parent_page->Remove(parent_page->ValueIndex(delete_page->GetPageId()));
-        buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
-        buffer_pool_manager_->DeletePage(delete_page->GetPageId());
+                              const std::deque<Page *> &lock_page_que, std::vector<page_id_t> *deleted_pages,
+                              bool *retry, Transaction *transaction) {
+  auto parent_page = *parent;
+  // the sibling of the first child is its right neighbor, every other child has a left neighbor
+  N *left = 0 == index ? *node : *neighbor_node;
+  N *right = 0 == index ? *neighbor_node : *node;
+  int right_index = 0 == index ? 1 : index;
+  // the key range of the left page grows first, pages that compress keys encode the moved keys for it
+  left->SetNextPageId(right->GetNextPageId());
+  left->SetHighKey(right->GetHighKey());
+  left->SetKeyRange(left->GetLowKey(), MaxSize(left));
+  if (std::is_same<LeafPage, N>::value) {
+    reinterpret_cast<LeafPage *>(right)->MoveAllTo(reinterpret_cast<LeafPage *>(left));
+    if (INVALID_PAGE_ID != left->GetNextPageId()) {
+      SetPrevPageId(left->GetNextPageId(), left->GetPageId());
     }
-    CoalesceOrRedistribute(parent_page, transaction);
-    return true;
+  } else {
+    reinterpret_cast<InternalPage *>(right)->MoveAllTo(reinterpret_cast<InternalPage *>(left),
+                                                       parent_page->KeyAt(right_index), buffer_pool_manager_);
+  }
+  left->UpdateMaxSize(MaxSize(left));
+  right->SetNextPageId(left->GetPageId());
+  parent_page->Remove(right_index);
+  parent_page->UpdateMaxSize(internal_max_size_);
+  deleted_pages->push_back(right->GetPageId());
+
+  if (parent_page->IsRootPage() || parent_page->GetSize() < MergeSize(parent_page)) {
+    return CoalesceOrRedistribute(parent_page, lock_page_que, deleted_pages, retry, transaction);
+  }
+  return false;
 }
 
 /*
@@ -352,31 +1359,114 @@ bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
  * otherwise move sibling page's last key & value pair into head of input
  * "node".
  * Using template N to represent either internal page or leaf page.
+ * The separator key of the parent (already write-latched by the caller) is updated to the new first key of the
+ * right one of the two pages, and so is the high key of the left one.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
 void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
-    if (std::is_same<LeafPage , N>::value) {
-        LeafPage* node_page = reinterpret_cast<LeafPage *>(node);
-        LeafPage* neighbor_page = reinterpret_cast<LeafPage *>(neighbor_node);
-        if (0 == index) {
-            neighbor_page->MoveFirstToEndOf(node_page);
-        } else {
-            neighbor_page->MoveLastToFrontOf(node_page);
-        }
+  auto parent = buffer_pool_manager_->FetchPage(node->GetParentPageId());
+  auto parent_page = reinterpret_cast<InternalPage *>(parent->GetData());
+  int right_index = 0 == index ? 1 : index;
+  // the first key of the right page after the move, leaves and internal pages both move it to the parent
+  KeyType separator = 0 == index ? neighbor_node->KeyAt(1) : neighbor_node->KeyAt(neighbor_node->GetSize() - 1);
+  // the key range of the receiving page grows, which shortens the common prefix of pages that compress keys
+  int max_size = MaxSize(node);
+  int fit_size = 0 == index ? node->MaxSizeFor(node->GetLowKey(), &separator, max_size)
+                            : node->MaxSizeFor(&separator, node->HasHighKey() ? &node->GetHighKey() : nullptr, max_size);
+  if (node->IsLeafPage() ? node->GetSize() + 1 > fit_size : node->GetSize() + 1 >= fit_size) {
+    // the page stays underfull, as a page after a lazy merge does
+    buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+    return;
+  }
+  KeyType middle_key = parent_page->KeyAt(right_index);
+  (0 == index ? node : neighbor_node)->SetHighKey(separator);
+  if (0 == index) {
+    node->SetKeyRange(node->GetLowKey(), max_size);
+  } else {
+    node->SetKeyRange(&separator, max_size);
+  }
+  if (std::is_same<LeafPage, N>::value) {
+    auto node_page = reinterpret_cast<LeafPage *>(node);
+    auto neighbor_page = reinterpret_cast<LeafPage *>(neighbor_node);
+    if (0 == index) {
+      neighbor_page->MoveFirstToEndOf(node_page);
     } else {
-        InternalPage * node_page = reinterpret_cast<InternalPage *>(node);
-        InternalPage* neighbor_page = reinterpret_cast<InternalPage *>(neighbor_node);
-        KeyType middleKey;
-        if (0 == index) {
-            neighbor_page->MoveFirstToEndOf(node_page,  middleKey, buffer_pool_manager_);
-        } else {
-            neighbor_page->MoveLastToFrontOf(node_page, middleKey, buffer_pool_manager_);
-        }
+      neighbor_page->MoveLastToFrontOf(node_page);
+    }
+  } else {
+    // the separator moves down in front of the moved child and the first key of the right page moves up
+    auto node_page = reinterpret_cast<InternalPage *>(node);
+    auto neighbor_page = reinterpret_cast<InternalPage *>(neighbor_node);
+    if (0 == index) {
+      neighbor_page->MoveFirstToEndOf(node_page, middle_key, buffer_pool_manager_);
+    } else {
+      neighbor_page->MoveLastToFrontOf(node_page, middle_key, buffer_pool_manager_);
     }
+  }
+  // the key range of the giving page shrinks, it can only grow its prefix
+  if (0 == index) {
+    neighbor_node->SetKeyRange(&separator, max_size);
+  } else {
+    neighbor_node->SetKeyRange(neighbor_node->GetLowKey(), max_size);
+  }
+  node->UpdateMaxSize(max_size);
+  parent_page->SetKeyAt(right_index, separator);
+  parent_page->UpdateMaxSize(internal_max_size_);
+  buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
+}
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SetPrevPageId(page_id_t page_id, page_id_t prev_page_id) {
+  auto page = buffer_pool_manager_->FetchPage(page_id);
+  if (nullptr == page) {
+    throw "not find page page_id:" + std::to_string(page_id);
+  }
+  page->WLatch();
+  reinterpret_cast<LeafPage *>(page->GetData())->SetPrevPageId(prev_page_id);
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+/*
+ * Delete a page that a merge, a compaction or a root collapse emptied and unlinked, once the tree latches are
+ * released. A leaf changes its version first, which fails the check of the adaptive hash entries of it for good. The
+ * page is flushed before it is deleted, a reader may still fetch it through a stale page id and must find it emptied
+ * on disk too.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeleteLeaf(page_id_t page_id) {
+  auto page = buffer_pool_manager_->FetchPage(page_id);
+  if (nullptr == page) {
+    throw "not find page page_id:" + std::to_string(page_id);
+  }
+  page->WLatch();
+  auto node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  if (node->IsLeafPage()) {
+    reinterpret_cast<LeafPage *>(node)->BumpVersion();
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  buffer_pool_manager_->FlushPage(page_id);
+  buffer_pool_manager_->DeletePage(page_id);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::MaxSize(const BPlusTreePage *page) const {
+  return page->IsLeafPage() ? leaf_max_size_ : internal_max_size_;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::MergeSize(const BPlusTreePage *page) const {
+  return std::max(1, static_cast<int>(merge_threshold_ * page->GetMaxSize()));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::LeafFillSize(const LeafPage *leaf, double fill_factor) const {
+  int max_size = leaf->GetMaxSize();
+  return std::min(std::max(static_cast<int>(fill_factor * max_size), std::max(1, max_size / 2)), max_size);
 }
 /*
  * Update root page if necessary
@@ -389,29 +1479,33 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
  * happend
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
-    // case2 : last element
-    if (old_root_node->IsLeafPage()) {
-        if (0 == old_root_node->GetSize()) {
-            root_page_id_ = INVALID_PAGE_ID;
-            UpdateRootPageId();
-            return true;
-        }
-        return false;
-    }
-
-    // case1: root only has one child, decrease tree height
-    if (2 == old_root_node->GetSize()) {
-        auto old_root_page = reinterpret_cast<InternalPage *>(old_root_node);
-        root_page_id_ = old_root_page->ValueAt(1);
-        UpdateRootPageId();
-        auto child_page = reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(root_page_id_)->GetData());
-        child_page->SetParentPageId(INVALID_PAGE_ID);
-        buffer_pool_manager_->UnpinPage(child_page->GetPageId(), true);
-        buffer_pool_manager_->DeletePage(old_root_node->GetPageId());
-        return true;
+bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node, std::vector<page_id_t> *deleted_pages) {
+  // the old root is write-latched, so it cannot be split meanwhile, and no other root change can race this one
+  std::scoped_lock root_latch{root_latch_};
+  // case2 : last element
+  if (old_root_node->IsLeafPage()) {
+    if (0 == old_root_node->GetSize()) {
+      SetRootPageId(INVALID_PAGE_ID);
+      UpdateRootPageId();
+      deleted_pages->push_back(old_root_node->GetPageId());
+      return true;
     }
     return false;
+  }
+
+  // case1: root only has one child, decrease tree height
+  if (1 == old_root_node->GetSize()) {
+    auto old_root_page = reinterpret_cast<InternalPage *>(old_root_node);
+    page_id_t root_page_id = old_root_page->RemoveAndReturnOnlyChild();
+    auto child_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(root_page_id)->GetData());
+    child_page->SetParentPageId(INVALID_PAGE_ID);
+    buffer_pool_manager_->UnpinPage(child_page->GetPageId(), true);
+    SetRootPageId(root_page_id);
+    UpdateRootPageId();
+    deleted_pages->push_back(old_root_node->GetPageId());
+    return true;
+  }
+  return false;
 }
 
 /*****************************************************************************
@@ -424,16 +1518,14 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_TYPE::begin() {
-    KeyType mini_key;
-    std::deque<Page*> lock_page_deq;
-    LockRootPage(false);
-    auto leafPage = FindLeafPage(mini_key, true, Operation::READ, nullptr, &lock_page_deq);
-    UnlockRootPage(false);
-    if (nullptr == leafPage) {
-        return INDEXITERATOR_TYPE(INVALID_PAGE_ID, 0, buffer_pool_manager_);
-    }
-    UnlockPages(Operation::READ, lock_page_deq);
-    return INDEXITERATOR_TYPE(leafPage->GetPageId(), 0, buffer_pool_manager_);
+  KeyType mini_key;
+  std::deque<Page *> lock_page_deq;
+  auto leafPage = FindLeafPage(mini_key, true, Operation::READ, nullptr, &lock_page_deq);
+  if (nullptr == leafPage) {
+    return INDEXITERATOR_TYPE(buffer_pool_manager_);
+  }
+  // the iterator takes over the latched leaf
+  return INDEXITERATOR_TYPE(leafPage, 0, buffer_pool_manager_, &comparator_, unique_);
 }
 
 /*
@@ -443,17 +1535,61 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::begin() {
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
-    std::deque<Page*> lock_page_deq;
-    LockRootPage(false);
-    auto leafPage = FindLeafPage(key, false, Operation::READ, nullptr, &lock_page_deq);
-    UnlockRootPage(false);
-    if (nullptr == leafPage) {
-        return INDEXITERATOR_TYPE(INVALID_PAGE_ID, 0, buffer_pool_manager_);
+  std::deque<Page *> lock_page_deq;
+  auto leafPage = FindLeafPage(key, false, Operation::READ, nullptr, &lock_page_deq);
+  if (nullptr == leafPage) {
+    return INDEXITERATOR_TYPE(buffer_pool_manager_);
+  }
+  auto leaf_page = reinterpret_cast<LeafPage *>(leafPage->GetData());
+  // the iterator takes over the latched leaf, and moves to the next leaf if every key of this one is smaller
+  return INDEXITERATOR_TYPE(leafPage, leaf_page->KeyIndex(key, comparator_), buffer_pool_manager_, &comparator_,
+                            unique_);
+}
+
+/*
+ * Input parameters are the bounds of the range, find the leaf page that
+ * contains the bound the scan starts from (or the leftmost or rightmost leaf
+ * page if it has none) first, then construct index iterator
+ * @return : index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType *low_key, bool low_inclusive, const KeyType *high_key,
+                                         bool high_inclusive, bool reverse) {
+  const KeyType *start_key = reverse ? high_key : low_key;
+  bool start_inclusive = reverse ? high_inclusive : low_inclusive;
+  Page *leafPage;
+  if (nullptr != start_key) {
+    std::deque<Page *> lock_page_deq;
+    leafPage = FindLeafPage(*start_key, false, Operation::READ, nullptr, &lock_page_deq);
+  } else if (reverse) {
+    leafPage = FindLastLeafPage();
+  } else {
+    KeyType mini_key;
+    std::deque<Page *> lock_page_deq;
+    leafPage = FindLeafPage(mini_key, true, Operation::READ, nullptr, &lock_page_deq);
+  }
+  if (nullptr == leafPage) {
+    return INDEXITERATOR_TYPE(buffer_pool_manager_);
+  }
+  auto leaf_page = reinterpret_cast<LeafPage *>(leafPage->GetData());
+  // the first entry in range: forward at or after index, reverse at or before it
+  int index;
+  if (nullptr == start_key) {
+    index = reverse ? leaf_page->GetSize() - 1 : 0;
+  } else {
+    index = leaf_page->KeyIndex(*start_key, comparator_);
+    bool found = index < leaf_page->GetSize() && comparator_(leaf_page->KeyAt(index), *start_key) == 0;
+    if (reverse) {
+      index = found && start_inclusive ? index : index - 1;
+    } else {
+      index = found && !start_inclusive ? index + 1 : index;
     }
-    auto leaf_page = reinterpret_cast<LeafPage*>(leafPage->GetData());
-    auto keyIdx = leaf_page->KeyIndex(key, comparator_);
-    UnlockPages(Operation::READ, lock_page_deq);
-    return INDEXITERATOR_TYPE(leafPage->GetPageId(), keyIdx, buffer_pool_manager_);
+  }
+  const KeyType *end_key = reverse ? low_key : high_key;
+  bool end_inclusive = reverse ? low_inclusive : high_inclusive;
+  // the iterator takes over the latched leaf
+  return INDEXITERATOR_TYPE(leafPage, index, buffer_pool_manager_, &comparator_, unique_, end_key, end_inclusive,
+                            reverse, start_key);
 }
 
 /*
@@ -463,114 +1599,400 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_TYPE::end() {
-    KeyType mini_key;
-    std::deque<Page*> lock_page_deq;
-    LockRootPage(false);
-    auto leafPage = FindLeafPage(mini_key, true, Operation::READ, nullptr, &lock_page_deq);
-    UnlockRootPage(false);
-    if (nullptr == leafPage) {
-        return INDEXITERATOR_TYPE(INVALID_PAGE_ID, 0, buffer_pool_manager_);
+  return INDEXITERATOR_TYPE(buffer_pool_manager_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+BPlusTreeStats<KeyType> BPLUSTREE_TYPE::CollectStats(int max_key_samples) {
+  while (true) {
+    BPlusTreeStats<KeyType> stats;
+    auto page = LatchRootPage(false, false);
+    if (nullptr == page) {
+      return stats;
+    }
+    // the root changes with its version while latched only by a root split, after which the latched page is no root
+    uint64_t root = root_.load();
+    if (static_cast<page_id_t>(static_cast<uint32_t>(root)) != page->GetPageId()) {
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      continue;
+    }
+
+    // the first page of each level: a split or merge keeps the left page, so only a root change deletes one of them
+    std::vector<page_id_t> first_page_ids{page->GetPageId()};
+    while (!reinterpret_cast<BPlusTreePage *>(page->GetData())->IsLeafPage()) {
+      auto child = buffer_pool_manager_->FetchPage(reinterpret_cast<InternalPage *>(page->GetData())->ValueAt(0));
+      if (nullptr == child) {
+        throw "not find child page of page_id:" + std::to_string(page->GetPageId());
+      }
+      child->RLatch();
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      page = child;
+      first_page_ids.push_back(page->GetPageId());
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+
+    bool restart = false;
+    int64_t leaf_index = 0;
+    for (page_id_t first_page_id : first_page_ids) {
+      page = buffer_pool_manager_->FetchPage(first_page_id);
+      if (nullptr == page) {
+        throw "not find page page_id:" + std::to_string(first_page_id);
+      }
+      page->RLatch();
+      if (root_.load() != root) {
+        page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(first_page_id, false);
+        restart = true;
+        break;
+      }
+      BPlusTreeLevelStats level;
+      double fill_sum = 0;
+      while (true) {
+        auto node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+        level.page_count_++;
+        level.entry_count_ += node->GetSize();
+        fill_sum += static_cast<double>(node->GetSize()) / node->GetMaxSize();
+        if (node->IsLeafPage()) {
+          if (INVALID_PAGE_ID != node->GetNextPageId() && node->GetNextPageId() < node->GetPageId()) {
+            stats.out_of_order_leaf_links_++;
+          }
+          // sample every stride-th leaf, and double the stride by dropping every other sample once there are too many
+          if (leaf_index++ % stats.key_sample_stride_ == 0 && node->GetSize() > 0 && max_key_samples > 0) {
+            stats.key_samples_.push_back(reinterpret_cast<LeafPage *>(node)->KeyAt(0));
+            if (static_cast<int>(stats.key_samples_.size()) > max_key_samples) {
+              for (size_t i = 0; 2 * i < stats.key_samples_.size(); i++) {
+                stats.key_samples_[i] = stats.key_samples_[2 * i];
+              }
+              stats.key_samples_.resize((stats.key_samples_.size() + 1) / 2);
+              stats.key_sample_stride_ *= 2;
+            }
+          }
+        }
+        if (INVALID_PAGE_ID == node->GetNextPageId()) {
+          break;
+        }
+        page = MoveRight(page, false);
+      }
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      level.fill_factor_ = fill_sum / level.page_count_;
+      stats.levels_.push_back(level);
     }
-    auto leaf_page_node = reinterpret_cast<LeafPage *>(leafPage->GetData());
-    while (INVALID_PAGE_ID != leaf_page_node->GetNextPageId()) {
-        leaf_page_node = reinterpret_cast<LeafPage *>(buffer_pool_manager_->FetchPage(leaf_page_node->GetNextPageId())->GetData());
-    };
-    UnlockPages(Operation::READ, lock_page_deq);
-    return INDEXITERATOR_TYPE(leaf_page_node->GetPageId(), leaf_page_node->GetSize(), buffer_pool_manager_);
+    if (!restart) {
+      stats.height_ = static_cast<int>(stats.levels_.size());
+      return stats;
+    }
+  }
 }
 
 /*****************************************************************************
  * UTILITIES AND DEBUG
  *****************************************************************************/
+/*
+ * Take the child latched for the operation, moving right past splits that are not posted to its parent yet, and
+ * release the latches held above it once it is safe, that is an insert or delete below it cannot split or merge it.
+ * A child reached through a right-link is not one of the latched ancestors' children, they are released too.
+ * @return the latched page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::CrabingFetchPage(const Operation &op, const KeyType &key, bool leftMost,
+                                       std::deque<Page *> *lock_page_que, Page *child) {
+  bool exclusive = Operation::READ != op;
+  bool moved = false;
+  while (!leftMost && ShouldMoveRight(child, key)) {
+    child = MoveRight(child, exclusive);
+    moved = true;
+  }
+  if (moved || IsSafe(op, child)) {
+    UnlockPages(op, *lock_page_que);
+  }
+  lock_page_que->push_back(child);
+  return child;
+}
+
 /*
  * Find leaf page containing particular key, if leftMost flag == true, find
  * the left most leaf page
+ * Pages are latched hand over hand for the operation and left latched and pinned in lock_page_que, release them with
+ * UnlockPages(). For an insert or delete these are the leaf and its ancestors up to the last one that is not safe.
+ * The root cannot collapse while it is latched, see LatchRootPage().
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::CrabingFetchPage(const Operation &op, Transaction *transaction, std::deque<Page *> *lock_page_que,
-                                      Page *child)  {
-    if (Operation::READ == op) {
-        child->RLatch();
+Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation op, Transaction *transaction,
+                                   std::deque<Page *> *lock_page_que) {
+  auto root = LatchRootPage(Operation::READ != op, false);
+  if (nullptr == root) {
+    return nullptr;
+  }
+
+  Page *page = CrabingFetchPage(op, key, leftMost, lock_page_que, root);
+  auto cur = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  while (!cur->IsLeafPage()) {
+    auto cur_internal = reinterpret_cast<InternalPage *>(cur);
+    page_id_t child_page_id;
+    if (leftMost) {
+      child_page_id = cur_internal->ValueAt(0);
     } else {
-        child->WLatch();
+      child_page_id = cur_internal->Lookup(key, comparator_);
+    }
+
+    auto child = buffer_pool_manager_->FetchPage(child_page_id);
+    if (nullptr == child) {
+      throw "not find child page page_id:" + std::to_string(child_page_id);
+    }
+
+    LatchPage(child, Operation::READ != op);
+    page = CrabingFetchPage(op, key, leftMost, lock_page_que, child);
+    cur = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  }
+  return page;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLastLeafPage() {
+  auto page = LatchRootPage(false, false);
+  if (nullptr == page) {
+    return nullptr;
+  }
+  auto node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  while (true) {
+    // the last page of a level has no right-link once its splits are posted
+    while (INVALID_PAGE_ID != node->GetNextPageId()) {
+      page = MoveRight(page, false);
+      node = reinterpret_cast<BPlusTreePage *>(page->GetData());
     }
-    if (root_page_id_ != child->GetPageId() && IsSafe(op, child)) {
-        UnlockRootPage(Operation::READ != op);
-        UnlockPages(op, *lock_page_que);
+    if (node->IsLeafPage()) {
+      return page;
     }
-    lock_page_que->push_back(child);
-    if (nullptr != transaction) {
-        transaction->AddIntoPageSet(child);
+    auto child = buffer_pool_manager_->FetchPage(reinterpret_cast<InternalPage *>(node)->ValueAt(node->GetSize() - 1));
+    if (nullptr == child) {
+      throw "not find child page of page_id:" + std::to_string(page->GetPageId());
     }
+    child->RLatch();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = child;
+    node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  }
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, Operation op, Transaction *transaction,
-                                   std::deque<Page *> *lock_page_que) {
-    LockRootPage(Operation::READ != op);
-    if (IsEmpty()) {
+Page *BPLUSTREE_TYPE::LatchFirstLeafParent() {
+  while (true) {
+    auto page = LatchRootPage(false, false);
+    if (nullptr == page) {
+      return nullptr;
+    }
+    Page *parent = nullptr;
+    while (true) {
+      if (reinterpret_cast<BPlusTreePage *>(page->GetData())->IsLeafPage()) {
+        // only a root leaf is reached
+        page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
         return nullptr;
+      }
+      auto child = buffer_pool_manager_->FetchPage(reinterpret_cast<InternalPage *>(page->GetData())->ValueAt(0));
+      if (nullptr == child) {
+        throw "not find child page of page_id:" + std::to_string(page->GetPageId());
+      }
+      child->RLatch();
+      bool leaf_children = reinterpret_cast<BPlusTreePage *>(child->GetData())->IsLeafPage();
+      if (!leaf_children) {
+        if (nullptr != parent) {
+          parent->RUnlatch();
+          buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+        }
+        parent = page;
+        page = child;
+        continue;
+      }
+      child->RUnlatch();
+      buffer_pool_manager_->UnpinPage(child->GetPageId(), false);
+      // upgrade to a write latch, the read latch on the parent keeps the page from being merged meanwhile
+      page->RUnlatch();
+      page->WLatch();
+      if (nullptr != parent) {
+        parent->RUnlatch();
+        buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+        return page;
+      }
+      // a root may have collapsed or split while unlatched
+      if (page->GetPageId() == GetRootPageId()) {
+        return page;
+      }
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      break;
     }
-    auto root = buffer_pool_manager_->FetchPage(root_page_id_);
-    if (nullptr == root) {
-        throw "no page can find page_id:" + std::to_string(root_page_id_);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageOptimistic(const KeyType &key) {
+  // if the root is split meanwhile, the key is found to the right of it
+  auto page = LatchRootPage(false, true);
+  if (nullptr == page) {
+    return nullptr;
+  }
+
+  while (true) {
+    auto cur = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    while (ShouldMoveRight(cur, key)) {
+      page = MoveRight(page, cur->IsLeafPage());
+      cur = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    }
+    if (cur->IsLeafPage()) {
+      return page;
+    }
+    page_id_t child_page_id = reinterpret_cast<InternalPage *>(cur)->Lookup(key, comparator_);
+    auto child = buffer_pool_manager_->FetchPage(child_page_id);
+    if (nullptr == child) {
+      throw "not find child page page_id:" + std::to_string(child_page_id);
+    }
+    child->RLatch();
+    if (reinterpret_cast<BPlusTreePage *>(child->GetData())->IsLeafPage()) {
+      // upgrade to a write latch, the read latch on the parent keeps the leaf from being merged meanwhile
+      child->RUnlatch();
+      child->WLatch();
     }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = child;
+  }
+}
 
-    CrabingFetchPage(op, transaction, lock_page_que, root);
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindRightmostLeafPage(const KeyType &key) {
+  page_id_t page_id = rightmost_leaf_page_id_;
+  if (INVALID_PAGE_ID == page_id) {
+    return nullptr;
+  }
+  auto page = buffer_pool_manager_->FetchPage(page_id);
+  if (nullptr == page) {
+    return nullptr;
+  }
+  page->WLatch();
+  // a leaf merged away or emptied meanwhile is left empty, and a split one has a right-link
+  auto leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  if (leaf->IsLeafPage() && INVALID_PAGE_ID == leaf->GetNextPageId() && leaf->GetSize() > 0 &&
+      comparator_(key, leaf->KeyAt(leaf->GetSize() - 1)) > 0) {
+    return page;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return nullptr;
+}
 
-    auto cur = reinterpret_cast<BPlusTreePage *>(root->GetData());
-    while (!cur->IsLeafPage()) {
-        auto cur_internal = reinterpret_cast<InternalPage *>(cur);
-        page_id_t child_page_id;
-        if (leftMost) {
-            child_page_id = cur_internal->ValueAt(0);
-        } else {
-            child_page_id = cur_internal->Lookup(key, comparator_);
-        }
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::LatchRootPage(bool exclusive, bool exclusive_leaf) {
+  while (true) {
+    uint64_t root = root_.load();
+    auto root_page_id = static_cast<page_id_t>(static_cast<uint32_t>(root));
+    if (INVALID_PAGE_ID == root_page_id) {
+      return nullptr;
+    }
+    auto page = buffer_pool_manager_->FetchPage(root_page_id);
+    if (nullptr == page) {
+      throw "no page can find page_id:" + std::to_string(root_page_id);
+    }
+    LatchPage(page, exclusive);
+    bool latched_exclusive = exclusive;
+    if (!exclusive && exclusive_leaf && reinterpret_cast<BPlusTreePage *>(page->GetData())->IsLeafPage()) {
+      // a page never changes its kind, the leaf is still a leaf once it is latched again
+      page->RUnlatch();
+      page->WLatch();
+      latched_exclusive = true;
+    }
+    // a root collapses under its own latch, so one that is still the root now stays in the tree while latched
+    if (root_.load() == root) {
+      return page;
+    }
+    UnlatchPage(page, latched_exclusive);
+    buffer_pool_manager_->UnpinPage(root_page_id, false);
+  }
+}
 
-        auto child = buffer_pool_manager_->FetchPage(child_page_id);
-        if (nullptr == child) {
-            throw "not find child page page_id:" + std::to_string(child_page_id);
-        }
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SetRootPageId(page_id_t root_page_id) {
+  uint64_t version = (root_.load() >> 32) + 1;
+  root_.store(version << 32 | static_cast<uint32_t>(root_page_id));
+}
 
-        CrabingFetchPage(op, transaction, lock_page_que, child);
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::ShouldMoveRight(Page *page, const KeyType &key) const {
+  auto node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  return ShouldMoveRight(node, key);
+}
 
-        cur = reinterpret_cast<BPlusTreePage *>(child->GetData());
-    }
-    return reinterpret_cast<Page *>(cur);
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::ShouldMoveRight(BPlusTreePage *node, const KeyType &key) const {
+  if (node->IsLeafPage()) {
+    return reinterpret_cast<LeafPage *>(node)->ShouldMoveRight(key, comparator_);
+  }
+  return reinterpret_cast<InternalPage *>(node)->ShouldMoveRight(key, comparator_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::MoveRight(Page *page, bool exclusive) {
+  // the right sibling cannot be merged away while this page is latched
+  page_id_t right_page_id = reinterpret_cast<BPlusTreePage *>(page->GetData())->GetNextPageId();
+  auto right = buffer_pool_manager_->FetchPage(right_page_id);
+  if (nullptr == right) {
+    throw "not find right page page_id:" + std::to_string(right_page_id);
+  }
+  LatchPage(right, exclusive);
+  UnlatchPage(page, exclusive);
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  return right;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+template <typename N>
+bool BPLUSTREE_TYPE::IsSettled(const InternalPage *parent, int index, const N *child) const {
+  // the split of a child is posted when the parent holds its right-link, or for its last child, its high key
+  if (index + 1 < parent->GetSize()) {
+    return child->GetNextPageId() == parent->ValueAt(index + 1);
+  }
+  if (!child->HasHighKey() || !parent->HasHighKey()) {
+    return child->HasHighKey() == parent->HasHighKey();
+  }
+  return comparator_(child->GetHighKey(), parent->GetHighKey()) == 0;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UnlockPages(Operation op, std::deque<Page *>& deque) const {
-    while (!deque.empty()) {
-        auto page = deque.back();
-        if (Operation::READ == op) {
-            page->RUnlatch();
-        } else {
-            page->WUnlatch();
-        }
-        deque.pop_back();
-    }
+  while (!deque.empty()) {
+    auto page = deque.front();
+    UnlatchPage(page, Operation::READ != op);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), Operation::READ != op);
+    deque.pop_front();
+  }
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::IsSafe(Operation op, Page* child) const {
-    auto cur = reinterpret_cast<BPlusTreePage*>(child->GetData());
-    if (Operation::READ == op) {
-        return true;
-    } else if (Operation::INSERT == op) {
-        // not full
-        return cur->GetSize() < cur->GetMaxSize();
-    } else if (Operation::DELETE == op) {
-        // at least half-full
-        return cur->GetMinSize() < cur->GetSize();
+  auto cur = reinterpret_cast<BPlusTreePage *>(child->GetData());
+  if (Operation::READ == op) {
+    return true;
+  }
+  if (Operation::INSERT == op) {
+    // not full: leaves split once they exceed their max size, internal pages once they reach it
+    return cur->GetSize() < (cur->IsLeafPage() ? cur->GetMaxSize() : cur->GetMaxSize() - 1);
+  }
+  if (Operation::DELETE == op) {
+    // not merged after the remove, the root only shrinks when its last key (leaf) or its second child (internal) is
+    // removed
+    if (cur->IsRootPage()) {
+      return cur->GetSize() > (cur->IsLeafPage() ? 1 : 2);
     }
-    return false;
+    return MergeSize(cur) < cur->GetSize();
+  }
+  return false;
 }
 
-
-
-
 /*
  * Update/Insert root page id in header page(where page_id = 0, header_page is
  * defined under include/page/header_page.h)
@@ -583,11 +2005,13 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
   HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
   if (insert_record != 0) {
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
+    // create a new record<index_name + root_page_id> in header_page, the tree may have been emptied before
+    if (!header_page->InsertRecord(index_name_, GetRootPageId())) {
+      header_page->UpdateRecord(index_name_, GetRootPageId());
+    }
   } else {
     // update root_page_id in header_page
-    header_page->UpdateRecord(index_name_, root_page_id_);
+    header_page->UpdateRecord(index_name_, GetRootPageId());
   }
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
@@ -755,4 +2179,9 @@ template class BPlusTree<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTree<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTree<GenericKey<64>, RID, GenericComparator<64>>;
 
+template class BPlusTree<IntKey<4>, RID, IntKeyComparator<4>>;
+template class BPlusTree<IntKey<8>, RID, IntKeyComparator<8>>;
+
+template class BPlusTree<VarKey<256>, RID, VarKeyComparator<256>>;
+
 }  // namespace bustub
@@ -9,6 +9,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <exception>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "common/exception.h"
 #include "storage/index/b_plus_tree_index.h"
 
 namespace bustub {
@@ -16,38 +24,202 @@ namespace bustub {
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
-BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager)
+BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager, bool unique)
     : Index(metadata),
-      comparator_(metadata->GetKeySchema()),
-      container_(metadata->GetName(), buffer_pool_manager, comparator_) {}
+      unique_(unique),
+      comparator_(metadata->GetKeySchema(), KeyType::CanNormalize(metadata->GetKeySchema())),
+      container_(metadata->GetName(), buffer_pool_manager, comparator_, LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE, unique) {
+  if (GetIncludedColumnCount() > 0 && !comparator_.IsNormalized()) {
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "included columns need a key schema that can be normalized");
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType BPLUSTREE_INDEX_TYPE::MakeIndexKey(const Tuple &key) const {
+  KeyType index_key;
+  if (comparator_.IsNormalized()) {
+    index_key.SetNormalizedFromKey(key, GetKeySchema());
+  } else {
+    index_key.SetFromKey(key);
+  }
+  return index_key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType BPLUSTREE_INDEX_TYPE::MakeBoundKey(const Tuple &key, bool max) const {
+  if (0 == GetIncludedColumnCount()) {
+    return MakeIndexKey(key);
+  }
+  KeyType index_key;
+  index_key.SetNormalizedPrefixFromKey(key, GetKeySchema(), GetIndexColumnCount() - GetIncludedColumnCount(), max);
+  return index_key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Value BPLUSTREE_INDEX_TYPE::GetKeyValue(const KeyType &index_key, uint32_t column_idx) const {
+  if (comparator_.IsNormalized()) {
+    return index_key.ToNormalizedValue(GetKeySchema(), column_idx);
+  }
+  return index_key.ToValue(GetKeySchema(), column_idx);
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct insert index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
+  KeyType index_key = MakeIndexKey(key);
 
+  if (unique_ && GetIncludedColumnCount() > 0) {
+    // the tree only rejects keys with equal included columns too
+    std::vector<RID> result;
+    ScanKey(key, &result, transaction);
+    if (!result.empty()) {
+      return;
+    }
+  }
   container_.Insert(index_key, rid, transaction);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct delete index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
+  KeyType index_key = MakeIndexKey(key);
 
-  container_.Remove(index_key, transaction);
+  container_.Remove(index_key, rid, transaction);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
+  if (GetIncludedColumnCount() > 0) {
+    // the entries of the key may differ in their included columns
+    KeyType low_key = MakeBoundKey(key, false);
+    KeyType high_key = MakeBoundKey(key, true);
+    for (auto it = container_.Begin(&low_key, true, &high_key, true); it != container_.end(); ++it) {
+      result->push_back((*it).second);
+    }
+    return;
+  }
   // construct scan index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
+  KeyType index_key = MakeIndexKey(key);
 
   container_.GetValue(index_key, result, transaction);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                                    Transaction *transaction) {
+  if (GetIncludedColumnCount() > 0) {
+    results->assign(keys.size(), std::vector<RID>());
+    for (size_t i = 0; i < keys.size(); i++) {
+      ScanKey(keys[i], &(*results)[i], transaction);
+    }
+    return;
+  }
+  std::vector<KeyType> index_keys;
+  index_keys.reserve(keys.size());
+  for (const auto &key : keys) {
+    index_keys.push_back(MakeIndexKey(key));
+  }
+  container_.GetValues(index_keys, results, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_INDEX_TYPE::BulkLoad(TableHeap *table_heap, const Schema &table_schema, Transaction *transaction,
+                                    double fill_factor, size_t threads) {
+  if (!container_.IsEmpty()) {
+    return false;
+  }
+  if (enable_logging || 0 == threads) {
+    threads = 1;
+  }
+  // an entry with its position in the table, the number of its page in the page chain and its slot, so that equal
+  // keys stay in table order and a unique tree keeps the first one
+  using RunEntry = std::pair<MappingType, uint64_t>;
+  auto entry_less = [this](const RunEntry &lhs, const RunEntry &rhs) {
+    int result = comparator_(lhs.first.first, rhs.first.first);
+    return result < 0 || (0 == result && lhs.second < rhs.second);
+  };
+
+  std::mutex chain_latch;
+  page_id_t next_page_id = table_heap->GetFirstPageId();
+  uint64_t next_page_number = 0;
+  std::vector<std::vector<RunEntry>> runs(threads);
+  std::vector<std::exception_ptr> errors(threads);
+  auto scan = [&](size_t thread_id) {
+    auto &run = runs[thread_id];
+    std::vector<std::pair<page_id_t, uint64_t>> range;
+    std::vector<Tuple> tuples;
+    try {
+      while (true) {
+        range.clear();
+        {
+          std::lock_guard<std::mutex> guard(chain_latch);
+          while (range.size() < SCAN_RANGE_PAGES && INVALID_PAGE_ID != next_page_id) {
+            range.emplace_back(next_page_id, next_page_number++);
+            next_page_id = table_heap->GetNextPageId(next_page_id);
+          }
+        }
+        if (range.empty()) {
+          break;
+        }
+        for (const auto &page : range) {
+          tuples.clear();
+          table_heap->GetPageTuples(page.first, &tuples, transaction);
+          for (auto &tuple : tuples) {
+            Tuple key = tuple.KeyFromTuple(table_schema, *GetKeySchema(), GetKeyAttrs());
+            run.emplace_back(MappingType(MakeIndexKey(key), tuple.GetRid()),
+                             page.second << 32 | tuple.GetRid().GetSlotNum());
+          }
+        }
+      }
+      std::sort(run.begin(), run.end(), entry_less);
+    } catch (...) {
+      errors[thread_id] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; i++) {
+    workers.emplace_back(scan, i);
+  }
+  scan(0);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // merge the runs: a heap of the index of the run with the smallest next entry on top
+  std::vector<size_t> run_next(threads, 0);
+  auto run_greater = [&](size_t lhs, size_t rhs) {
+    return entry_less(runs[rhs][run_next[rhs]], runs[lhs][run_next[lhs]]);
+  };
+  std::vector<size_t> merge_heap;
+  for (size_t i = 0; i < threads; i++) {
+    if (!runs[i].empty()) {
+      merge_heap.push_back(i);
+    }
+  }
+  std::make_heap(merge_heap.begin(), merge_heap.end(), run_greater);
+  return container_.BulkLoad(
+      [&](MappingType *item) {
+        if (merge_heap.empty()) {
+          return false;
+        }
+        std::pop_heap(merge_heap.begin(), merge_heap.end(), run_greater);
+        size_t run = merge_heap.back();
+        *item = runs[run][run_next[run]++].first;
+        if (run_next[run] == runs[run].size()) {
+          merge_heap.pop_back();
+        } else {
+          std::push_heap(merge_heap.begin(), merge_heap.end(), run_greater);
+        }
+        return true;
+      },
+      fill_factor, transaction);
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator() { return container_.begin(); }
 
@@ -57,10 +229,30 @@ INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator(const KeyType &key) {
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetEndIterator() { return container_.end(); }
 
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetRangeIterator(const Tuple *low_key, bool low_inclusive,
+                                                          const Tuple *high_key, bool high_inclusive, bool reverse) {
+  KeyType low_index_key;
+  KeyType high_index_key;
+  if (nullptr != low_key) {
+    low_index_key = MakeBoundKey(*low_key, !low_inclusive);
+  }
+  if (nullptr != high_key) {
+    high_index_key = MakeBoundKey(*high_key, high_inclusive);
+  }
+  return container_.Begin(nullptr == low_key ? nullptr : &low_index_key, low_inclusive,
+                          nullptr == high_key ? nullptr : &high_index_key, high_inclusive, reverse);
+}
+
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTreeIndex<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>;
 
+template class BPlusTreeIndex<IntKey<4>, RID, IntKeyComparator<4>>;
+template class BPlusTreeIndex<IntKey<8>, RID, IntKeyComparator<8>>;
+
+template class BPlusTreeIndex<VarKey<256>, RID, VarKeyComparator<256>>;
+
 }  // namespace bustub
@@ -0,0 +1,533 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bw_tree.cpp
+//
+// Identification: src/storage/index/bw_tree.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "storage/index/bw_tree.h"
+
+namespace bustub {
+
+INDEX_TEMPLATE_ARGUMENTS
+BWTREE_TYPE::BwTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+                    bool unique, int leaf_max_size, int inner_max_size)
+    : index_name_(std::move(name)),
+      buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      unique_(unique) {
+  // a consolidated node must fit its page
+  int leaf_capacity = (PAGE_SIZE - BW_TREE_PAGE_HEADER_SIZE - sizeof(KeyType)) / sizeof(MappingType);
+  int inner_capacity = (PAGE_SIZE - BW_TREE_PAGE_HEADER_SIZE - sizeof(KeyType)) / sizeof(InnerEntry);
+  leaf_max_size_ = leaf_max_size <= 0 ? leaf_capacity : std::min(leaf_max_size, leaf_capacity);
+  inner_max_size_ = inner_max_size <= 0 ? inner_capacity : std::min(std::max(inner_max_size, 2), inner_capacity);
+
+  auto root = new LeafNode;
+  root->type_ = NodeType::LEAF;
+  root->version_ = 1;
+  root_id_ = NewNodeId(root);
+  WriteNode(root_id_, root);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+BWTREE_TYPE::~BwTree() {
+  for (auto &chunk : mapping_table_) {
+    if (nullptr == chunk) {
+      continue;
+    }
+    for (auto &node : chunk.load()->nodes_) {
+      DeleteChain(node);
+    }
+    delete chunk.load();
+  }
+}
+
+/*****************************************************************************
+ * MAPPING TABLE
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+std::atomic<typename BWTREE_TYPE::Node *> &BWTREE_TYPE::Slot(bw_node_id_t node_id) {
+  return mapping_table_[node_id / MAPPING_CHUNK_SIZE].load()->nodes_[node_id % MAPPING_CHUNK_SIZE];
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t &BWTREE_TYPE::PageIdOf(bw_node_id_t node_id) {
+  return mapping_table_[node_id / MAPPING_CHUNK_SIZE].load()->page_ids_[node_id % MAPPING_CHUNK_SIZE];
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bw_node_id_t BWTREE_TYPE::NewNodeId(Node *node) {
+  bw_node_id_t node_id = next_node_id_++;
+  if (static_cast<size_t>(node_id) >= MAPPING_CHUNK_COUNT * MAPPING_CHUNK_SIZE) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "the mapping table of the Bw-tree is full");
+  }
+  auto &chunk = mapping_table_[node_id / MAPPING_CHUNK_SIZE];
+  if (nullptr == chunk) {
+    MappingChunk *expected = nullptr;
+    auto new_chunk = new MappingChunk;
+    if (!chunk.compare_exchange_strong(expected, new_chunk)) {
+      delete new_chunk;
+    }
+  }
+  page_id_t page_id;
+  if (nullptr == buffer_pool_manager_->NewPage(&page_id)) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "no page for a Bw-tree node");
+  }
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  // the page id is set before the node is published, so that whoever reaches the node can write it
+  PageIdOf(node_id) = page_id;
+  Slot(node_id) = node;
+  return node_id;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::DeleteUnreachable(bw_node_id_t node_id) {
+  delete Slot(node_id).exchange(nullptr);
+  buffer_pool_manager_->DeletePage(PageIdOf(node_id));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename BWTREE_TYPE::DeltaNode *BWTREE_TYPE::NewDelta(NodeType type, Node *head) {
+  auto delta = new DeltaNode;
+  delta->type_ = type;
+  delta->level_ = head->level_;
+  delta->chain_length_ = head->chain_length_ + 1;
+  delta->version_ = head->version_;
+  delta->has_high_key_ = head->has_high_key_;
+  delta->high_key_ = head->high_key_;
+  delta->right_ = head->right_;
+  delta->next_ = head;
+  return delta;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::DeleteChain(Node *head) {
+  while (nullptr != head) {
+    auto next = head->next_;
+    delete head;
+    head = next;
+  }
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+bool BWTREE_TYPE::Covers(const Node *head, const KeyType &key) const {
+  return !head->has_high_key_ || comparator_(key, head->high_key_) < 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename BWTREE_TYPE::Node *BWTREE_TYPE::BaseOf(Node *head) {
+  while (nullptr != head->next_) {
+    head = head->next_;
+  }
+  return head;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bw_node_id_t BWTREE_TYPE::FindNode(const KeyType *key, int level, Node **head) {
+  bw_node_id_t node_id = root_id_;
+  Node *node = Slot(node_id);
+  if (node->level_ < level) {
+    return INVALID_NODE_ID;
+  }
+  while (true) {
+    // a node split after its parent was read holds only the lower keys, the others are to the right
+    if (nullptr != key && !Covers(node, *key)) {
+      node_id = node->right_;
+    } else if (node->level_ == level) {
+      *head = node;
+      return node_id;
+    } else if (nullptr == key) {
+      node_id = static_cast<InnerNode *>(BaseOf(node))->children_[0].second;
+    } else {
+      node_id = SearchInner(node, *key);
+    }
+    node = Slot(node_id);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bw_node_id_t BWTREE_TYPE::SearchInner(Node *head, const KeyType &key) {
+  Node *node = head;
+  for (; NodeType::SEPARATOR == node->type_; node = node->next_) {
+    auto delta = static_cast<DeltaNode *>(node);
+    if (comparator_(key, delta->key_) >= 0 && (!delta->has_next_key_ || comparator_(key, delta->next_key_) < 0)) {
+      return delta->child_;
+    }
+  }
+  const auto &children = static_cast<InnerNode *>(node)->children_;
+  auto it = std::upper_bound(children.begin() + 1, children.end(), key,
+                             [this](const KeyType &lhs, const InnerEntry &rhs) {
+                               return comparator_(lhs, rhs.first) < 0;
+                             });
+  return std::prev(it)->second;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::ReadValues(Node *head, const KeyType &key, std::vector<ValueType> *result) {
+  // the values of the key that a newer delta already inserted or deleted
+  std::vector<ValueType> decided;
+  Node *node = head;
+  for (; NodeType::LEAF != node->type_; node = node->next_) {
+    auto delta = static_cast<DeltaNode *>(node);
+    if (comparator_(delta->key_, key) != 0) {
+      continue;
+    }
+    if (!delta->has_value_) {
+      // every older value of the key is deleted
+      return;
+    }
+    if (std::find(decided.begin(), decided.end(), delta->value_) != decided.end()) {
+      continue;
+    }
+    decided.push_back(delta->value_);
+    if (NodeType::INSERT == delta->type_) {
+      result->push_back(delta->value_);
+    }
+  }
+  const auto &entries = static_cast<LeafNode *>(node)->entries_;
+  auto it = std::lower_bound(entries.begin(), entries.end(), key, [this](const MappingType &lhs, const KeyType &rhs) {
+    return comparator_(lhs.first, rhs) < 0;
+  });
+  for (; it != entries.end() && comparator_(it->first, key) == 0; ++it) {
+    if (std::find(decided.begin(), decided.end(), it->second) == decided.end()) {
+      result->push_back(it->second);
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::ReadEntries(Node *head, std::vector<MappingType> *entries) {
+  std::vector<DeltaNode *> deltas;
+  Node *node = head;
+  for (; NodeType::LEAF != node->type_; node = node->next_) {
+    deltas.push_back(static_cast<DeltaNode *>(node));
+  }
+  *entries = static_cast<LeafNode *>(node)->entries_;
+  auto key_less = [this](const MappingType &lhs, const MappingType &rhs) {
+    return comparator_(lhs.first, rhs.first) < 0;
+  };
+  // apply the deltas oldest first
+  for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+    auto delta = *it;
+    MappingType entry(delta->key_, delta->value_);
+    auto range = std::equal_range(entries->begin(), entries->end(), entry, key_less);
+    if (NodeType::INSERT == delta->type_) {
+      entries->insert(range.second, entry);
+    } else if (!delta->has_value_) {
+      entries->erase(range.first, range.second);
+    } else {
+      auto found = std::find_if(range.first, range.second,
+                                [delta](const MappingType &item) { return item.second == delta->value_; });
+      if (found != range.second) {
+        entries->erase(found);
+      }
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::ReadChildren(Node *head, std::vector<InnerEntry> *children) {
+  std::vector<DeltaNode *> deltas;
+  Node *node = head;
+  for (; NodeType::INNER != node->type_; node = node->next_) {
+    deltas.push_back(static_cast<DeltaNode *>(node));
+  }
+  *children = static_cast<InnerNode *>(node)->children_;
+  for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+    auto delta = *it;
+    auto position = std::upper_bound(children->begin() + 1, children->end(), delta->key_,
+                                     [this](const KeyType &lhs, const InnerEntry &rhs) {
+                                       return comparator_(lhs, rhs.first) < 0;
+                                     });
+    children->emplace(position, delta->key_, delta->child_);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BWTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result) {
+  EpochGuard guard(&epoch_manager_);
+  Node *head;
+  FindNode(&key, 0, &head);
+  size_t size = result->size();
+  ReadValues(head, key, result);
+  return result->size() > size;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::Scan(const KeyType *low_key, const KeyType *high_key, std::vector<MappingType> *result) {
+  EpochGuard guard(&epoch_manager_);
+  Node *head;
+  FindNode(low_key, 0, &head);
+  // the keys below the bound were read before, from a leaf that has been split since
+  KeyType bound;
+  bool has_bound = nullptr != low_key;
+  if (has_bound) {
+    bound = *low_key;
+  }
+  std::vector<MappingType> entries;
+  while (true) {
+    ReadEntries(head, &entries);
+    for (const auto &entry : entries) {
+      if (has_bound && comparator_(entry.first, bound) < 0) {
+        continue;
+      }
+      if (nullptr != high_key && comparator_(entry.first, *high_key) > 0) {
+        return;
+      }
+      result->push_back(entry);
+    }
+    if (!head->has_high_key_) {
+      return;
+    }
+    has_bound = true;
+    bound = head->high_key_;
+    head = Slot(head->right_);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int BWTREE_TYPE::GetHeight() {
+  EpochGuard guard(&epoch_manager_);
+  return Slot(root_id_).load()->level_ + 1;
+}
+
+/*****************************************************************************
+ * INSERTION & DELETION
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+bool BWTREE_TYPE::Insert(const KeyType &key, const ValueType &value) {
+  return UpdateLeaf(NodeType::INSERT, key, &value);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::Remove(const KeyType &key) { UpdateLeaf(NodeType::DELETE, key, nullptr); }
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::Remove(const KeyType &key, const ValueType &value) { UpdateLeaf(NodeType::DELETE, key, &value); }
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BWTREE_TYPE::UpdateLeaf(NodeType type, const KeyType &key, const ValueType *value) {
+  EpochGuard guard(&epoch_manager_);
+  std::vector<ValueType> values;
+  while (true) {
+    Node *head;
+    bw_node_id_t node_id = FindNode(&key, 0, &head);
+    values.clear();
+    ReadValues(head, key, &values);
+    bool found = nullptr == value ? !values.empty()
+                                  : std::find(values.begin(), values.end(), *value) != values.end();
+    if (NodeType::INSERT == type ? found || (unique_ && !values.empty()) : !found) {
+      return false;
+    }
+    auto delta = NewDelta(type, head);
+    delta->key_ = key;
+    if (nullptr != value) {
+      delta->value_ = *value;
+    } else {
+      delta->has_value_ = false;
+    }
+    // fails if the leaf changed since it was read, the leaf is then read again
+    if (Slot(node_id).compare_exchange_strong(head, delta)) {
+      if (delta->chain_length_ >= CONSOLIDATE_LENGTH) {
+        Consolidate(node_id, &guard);
+      }
+      return true;
+    }
+    delete delta;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::Consolidate(bw_node_id_t node_id, EpochGuard *guard) {
+  auto &slot = Slot(node_id);
+  Node *head = slot;
+  if (head->chain_length_ < CONSOLIDATE_LENGTH) {
+    // consolidated by another thread meanwhile
+    return;
+  }
+  bool leaf = 0 == head->level_;
+  std::vector<MappingType> entries;
+  std::vector<InnerEntry> children;
+  size_t size;
+  size_t max_size;
+  if (leaf) {
+    ReadEntries(head, &entries);
+    size = entries.size();
+    max_size = leaf_max_size_;
+  } else {
+    ReadChildren(head, &children);
+    size = children.size();
+    max_size = inner_max_size_;
+  }
+  auto key_at = [&](size_t index) -> const KeyType & {
+    return leaf ? entries[index].first : children[index].first;
+  };
+
+  // the first entry of each node the node is split into, the values of a key are never split between leaves
+  std::vector<size_t> starts{0};
+  if (size > max_size) {
+    size_t pieces = (size + max_size - 1) / max_size;
+    for (size_t i = 1; i < pieces; i++) {
+      size_t start = std::max(size * i / pieces, starts.back() + 1);
+      while (leaf && start < size && comparator_(key_at(start), key_at(start - 1)) == 0) {
+        start++;
+      }
+      if (start >= size) {
+        break;
+      }
+      starts.push_back(start);
+    }
+  }
+  std::vector<Node *> nodes;
+  for (size_t i = 0; i < starts.size(); i++) {
+    size_t end = i + 1 < starts.size() ? starts[i + 1] : size;
+    Node *base;
+    if (leaf) {
+      auto leaf_node = new LeafNode;
+      leaf_node->type_ = NodeType::LEAF;
+      leaf_node->entries_.assign(entries.begin() + starts[i], entries.begin() + end);
+      base = leaf_node;
+    } else {
+      auto inner_node = new InnerNode;
+      inner_node->type_ = NodeType::INNER;
+      inner_node->children_.assign(children.begin() + starts[i], children.begin() + end);
+      base = inner_node;
+    }
+    base->level_ = head->level_;
+    base->version_ = 0 == i ? head->version_ + 1 : 1;
+    base->has_high_key_ = i + 1 < starts.size() || head->has_high_key_;
+    base->high_key_ = i + 1 < starts.size() ? key_at(starts[i + 1]) : head->high_key_;
+    nodes.push_back(base);
+  }
+  // the new right siblings are published right to left, each linked to the one after it, but are unreachable until
+  // the new base node replaces the chain
+  std::vector<bw_node_id_t> node_ids(nodes.size(), node_id);
+  bw_node_id_t right = head->right_;
+  for (size_t i = nodes.size() - 1; i > 0; i--) {
+    nodes[i]->right_ = right;
+    right = node_ids[i] = NewNodeId(nodes[i]);
+  }
+  nodes[0]->right_ = right;
+  if (!slot.compare_exchange_strong(head, nodes[0])) {
+    delete nodes[0];
+    for (size_t i = 1; i < nodes.size(); i++) {
+      DeleteUnreachable(node_ids[i]);
+    }
+    return;
+  }
+  for (Node *node = head; nullptr != node; node = node->next_) {
+    guard->Retire(node);
+  }
+  for (size_t i = 0; i < nodes.size(); i++) {
+    WriteNode(node_ids[i], nodes[i]);
+  }
+  for (size_t i = 1; i < nodes.size(); i++) {
+    const KeyType *next_key = nodes[i]->has_high_key_ ? &nodes[i]->high_key_ : nullptr;
+    PostSeparator(head->level_, key_at(starts[i]), node_ids[i], next_key, guard);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::PostSeparator(int level, const KeyType &key, bw_node_id_t child, const KeyType *next_key,
+                                EpochGuard *guard) {
+  while (true) {
+    Node *head;
+    bw_node_id_t node_id = FindNode(&key, level + 1, &head);
+    if (INVALID_NODE_ID == node_id) {
+      // the split node is the root, the tree grows a level
+      bw_node_id_t root_id = root_id_;
+      if (Slot(root_id).load()->level_ != level) {
+        continue;
+      }
+      auto root = new InnerNode;
+      root->type_ = NodeType::INNER;
+      root->level_ = level + 1;
+      root->version_ = 1;
+      root->children_.emplace_back(KeyType(), root_id);
+      root->children_.emplace_back(key, child);
+      bw_node_id_t new_root_id = NewNodeId(root);
+      if (root_id_.compare_exchange_strong(root_id, new_root_id)) {
+        WriteNode(new_root_id, root);
+        return;
+      }
+      DeleteUnreachable(new_root_id);
+      continue;
+    }
+    auto delta = NewDelta(NodeType::SEPARATOR, head);
+    delta->key_ = key;
+    delta->child_ = child;
+    if (nullptr != next_key) {
+      delta->has_next_key_ = true;
+      delta->next_key_ = *next_key;
+    }
+    if (Slot(node_id).compare_exchange_strong(head, delta)) {
+      if (delta->chain_length_ >= CONSOLIDATE_LENGTH) {
+        Consolidate(node_id, guard);
+      }
+      return;
+    }
+    delete delta;
+  }
+}
+
+/*****************************************************************************
+ * PERSISTENCE
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_TYPE::WriteNode(bw_node_id_t node_id, const Node *base) {
+  bool leaf = NodeType::LEAF == base->type_;
+  int32_t size = leaf ? static_cast<const LeafNode *>(base)->entries_.size()
+                      : static_cast<const InnerNode *>(base)->children_.size();
+  // only a leaf with more values of a key than fit a page can outgrow it, it is kept in memory alone
+  if (size > (leaf ? leaf_max_size_ : inner_max_size_)) {
+    return;
+  }
+  auto page = buffer_pool_manager_->FetchPage(PageIdOf(node_id));
+  if (nullptr == page) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "no page for a Bw-tree node");
+  }
+  page->WLatch();
+  char *data = page->GetData();
+  uint64_t version;
+  memcpy(&version, data, sizeof(version));
+  // consolidations of a node may finish writing out of order
+  bool newer = version < base->version_;
+  if (newer) {
+    int32_t has_high_key = base->has_high_key_;
+    memcpy(data, &base->version_, sizeof(uint64_t));
+    memcpy(data + 8, &base->level_, sizeof(int32_t));
+    memcpy(data + 12, &size, sizeof(int32_t));
+    memcpy(data + 16, &base->right_, sizeof(bw_node_id_t));
+    memcpy(data + 20, &has_high_key, sizeof(int32_t));
+    memcpy(data + BW_TREE_PAGE_HEADER_SIZE, &base->high_key_, sizeof(KeyType));
+    char *entries = data + BW_TREE_PAGE_HEADER_SIZE + sizeof(KeyType);
+    if (leaf) {
+      memcpy(entries, static_cast<const LeafNode *>(base)->entries_.data(), size * sizeof(MappingType));
+    } else {
+      memcpy(entries, static_cast<const InnerNode *>(base)->children_.data(), size * sizeof(InnerEntry));
+    }
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), newer);
+}
+
+template class BwTree<GenericKey<4>, RID, GenericComparator<4>>;
+template class BwTree<GenericKey<8>, RID, GenericComparator<8>>;
+template class BwTree<GenericKey<16>, RID, GenericComparator<16>>;
+template class BwTree<GenericKey<32>, RID, GenericComparator<32>>;
+template class BwTree<GenericKey<64>, RID, GenericComparator<64>>;
+
+}  // namespace bustub
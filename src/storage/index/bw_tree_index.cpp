@@ -0,0 +1,58 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bw_tree_index.cpp
+//
+// Identification: src/storage/index/bw_tree_index.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/exception.h"
+#include "storage/index/bw_tree_index.h"
+
+namespace bustub {
+
+INDEX_TEMPLATE_ARGUMENTS
+BWTREE_INDEX_TYPE::BwTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager, bool unique)
+    : Index(metadata),
+      comparator_(metadata->GetKeySchema(), KeyType::CanNormalize(metadata->GetKeySchema())),
+      container_(metadata->GetName(), buffer_pool_manager, comparator_, unique) {
+  if (GetIncludedColumnCount() > 0) {
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "included columns need a B+ tree index");
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType BWTREE_INDEX_TYPE::MakeIndexKey(const Tuple &key) const {
+  KeyType index_key;
+  if (comparator_.IsNormalized()) {
+    index_key.SetNormalizedFromKey(key, GetKeySchema());
+  } else {
+    index_key.SetFromKey(key);
+  }
+  return index_key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  container_.Insert(MakeIndexKey(key), rid);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  container_.Remove(MakeIndexKey(key), rid);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BWTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
+  container_.GetValue(MakeIndexKey(key), result);
+}
+
+template class BwTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
+template class BwTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
+template class BwTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
+template class BwTreeIndex<GenericKey<32>, RID, GenericComparator<32>>;
+template class BwTreeIndex<GenericKey<64>, RID, GenericComparator<64>>;
+
+}  // namespace bustub
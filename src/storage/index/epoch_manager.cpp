@@ -0,0 +1,71 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// epoch_manager.cpp
+//
+// Identification: src/storage/index/epoch_manager.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/epoch_manager.h"
+
+namespace bustub {
+
+EpochManager::~EpochManager() {
+  for (auto &garbage : garbage_) {
+    FreeGarbage(garbage.exchange(nullptr));
+  }
+}
+
+uint64_t EpochManager::JoinEpoch() {
+  while (true) {
+    uint64_t epoch = epoch_;
+    active_[epoch % EPOCH_SLOTS]++;
+    // the epoch may have advanced before the thread was counted in it, and its slot may then already be reused
+    if (epoch_ == epoch) {
+      return epoch;
+    }
+    active_[epoch % EPOCH_SLOTS]--;
+  }
+}
+
+void EpochManager::LeaveEpoch(uint64_t epoch) {
+  active_[epoch % EPOCH_SLOTS]--;
+  if (0 == ++leave_count_ % ADVANCE_INTERVAL) {
+    TryAdvance();
+  }
+}
+
+void EpochManager::Retire(uint64_t epoch, EpochGarbage *garbage) {
+  auto &head = garbage_[epoch % EPOCH_SLOTS];
+  garbage->garbage_next_ = head;
+  while (!head.compare_exchange_weak(garbage->garbage_next_, garbage)) {
+  }
+}
+
+void EpochManager::TryAdvance() {
+  std::unique_lock<std::mutex> guard(advance_latch_, std::try_to_lock);
+  if (!guard.owns_lock()) {
+    return;
+  }
+  uint64_t epoch = epoch_;
+  // no thread may be left in the epoch before the current one
+  if (0 != active_[(epoch + EPOCH_SLOTS - 1) % EPOCH_SLOTS]) {
+    return;
+  }
+  // the slot of the next epoch holds the garbage of two epochs ago, which no thread can reach anymore
+  FreeGarbage(garbage_[(epoch + 1) % EPOCH_SLOTS].exchange(nullptr));
+  epoch_ = epoch + 1;
+}
+
+void EpochManager::FreeGarbage(EpochGarbage *garbage) {
+  while (nullptr != garbage) {
+    auto next = garbage->garbage_next_;
+    delete garbage;
+    garbage = next;
+    freed_count_++;
+  }
+}
+
+}  // namespace bustub
@@ -1,9 +1,11 @@
 /**
  * index_iterator.cpp
  */
+#include <algorithm>
 #include <cassert>
 
 #include "storage/index/index_iterator.h"
+#include "storage/page/b_plus_tree_posting_page.h"
 
 namespace bustub {
 
@@ -12,10 +14,30 @@ namespace bustub {
  * set your own input parameters
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator(page_id_t cur_page_id, int idx, BufferPoolManager* buffer_pool_manager)  {
-    cur_page_id_ = cur_page_id;
-    idx_ = idx;
-    buffer_pool_manager_ = buffer_pool_manager;
+INDEXITERATOR_TYPE::IndexIterator(BufferPoolManager *buffer_pool_manager)
+    : cur_page_id_(INVALID_PAGE_ID), idx_(0), value_idx_(0), buffer_pool_manager_(buffer_pool_manager),
+      comparator_(nullptr), unique_(true), reverse_(false), has_bound_(false), bound_inclusive_(false) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(Page *leaf_page, int idx, BufferPoolManager *buffer_pool_manager,
+                                  const KeyComparator *comparator, bool unique)
+    : IndexIterator(leaf_page, idx, buffer_pool_manager, comparator, unique, nullptr, false, false) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(Page *leaf_page, int idx, BufferPoolManager *buffer_pool_manager,
+                                  const KeyComparator *comparator, bool unique, const KeyType *bound,
+                                  bool bound_inclusive, bool reverse, const KeyType *start_key)
+    : cur_page_id_(leaf_page->GetPageId()), idx_(idx), value_idx_(0), buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator), unique_(unique), reverse_(reverse), has_bound_(nullptr != bound),
+      bound_inclusive_(bound_inclusive) {
+    if (has_bound_) {
+        bound_ = *bound;
+    }
+    if (reverse_) {
+        SettleBackward(leaf_page, start_key);
+    } else {
+        Settle(leaf_page, false);
+    }
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -23,41 +45,180 @@ INDEXITERATOR_TYPE::~IndexIterator() = default;
 
 INDEX_TEMPLATE_ARGUMENTS
 bool INDEXITERATOR_TYPE::isEnd() {
-    auto page = buffer_pool_manager_->FetchPage(cur_page_id_);
-    if (nullptr == page) {
-        throw "illegal state";
-    }
-    auto leaf_page = reinterpret_cast<LeafPage*>(page->GetData());
-    return INVALID_PAGE_ID == leaf_page->GetNextPageId() && idx_ == leaf_page->GetSize();
+    return INVALID_PAGE_ID == cur_page_id_;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 const MappingType &INDEXITERATOR_TYPE::operator*() {
-    auto page = buffer_pool_manager_->FetchPage(cur_page_id_);
-    if (nullptr == page) {
+    if (isEnd()) {
         throw "illegal state";
     }
-    auto leaf_page = reinterpret_cast<LeafPage*>(page->GetData());
-    return leaf_page->GetItem(idx_);
+    return item_;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
+    if (isEnd()) {
+        return *this;
+    }
+    if (value_idx_ + 1 < values_.size()) {
+        item_.second = values_[++value_idx_];
+        return *this;
+    }
     auto page = buffer_pool_manager_->FetchPage(cur_page_id_);
     if (nullptr == page) {
         throw "illegal state";
     }
-
-    auto leaf_page = reinterpret_cast<LeafPage*>(page->GetData());
-    idx_++;
-    if (idx_ >= leaf_page->GetSize() &&
-        INVALID_PAGE_ID != leaf_page->GetNextPageId()){
-        cur_page_id_ = leaf_page->GetNextPageId();
-        idx_ = 0;
+    page->RLatch();
+    auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
+    // the current entry is usually still where it was, otherwise the leaf changed and its successor is found by key
+    bool in_place = idx_ < leaf_page->GetSize() && (*comparator_)(leaf_page->KeyAt(idx_), item_.first) == 0;
+    if (reverse_) {
+        // the entries right below the current one moved right along with it if the leaf split
+        while (!in_place && leaf_page->GetSize() > 0 && leaf_page->ShouldMoveRight(item_.first, *comparator_)) {
+            auto next_page = buffer_pool_manager_->FetchPage(leaf_page->GetNextPageId());
+            if (nullptr == next_page) {
+                throw "illegal state";
+            }
+            next_page->RLatch();
+            page->RUnlatch();
+            buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+            page = next_page;
+            leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
+        }
+        idx_ = in_place ? idx_ - 1 : leaf_page->KeyIndex(item_.first, *comparator_) - 1;
+        KeyType key = item_.first;
+        SettleBackward(page, &key);
+    } else {
+        idx_ = in_place ? idx_ + 1 : IndexAfterItem(leaf_page);
+        Settle(page, true);
     }
     return *this;
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Settle(Page *page, bool after_item) {
+    auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
+    while (idx_ >= leaf_page->GetSize()) {
+        page_id_t next_page_id = leaf_page->GetNextPageId();
+        if (INVALID_PAGE_ID == next_page_id || RangeEndsIn(leaf_page)) {
+            SetEnd(page);
+            return;
+        }
+        auto next_page = buffer_pool_manager_->FetchPage(next_page_id);
+        if (nullptr == next_page) {
+            throw "illegal state";
+        }
+        next_page->RLatch();
+        page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+        page = next_page;
+        leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
+        // a leaf emptied by a merge links to the leaf it was merged into, which may hold entries before the current one
+        idx_ = after_item ? IndexAfterItem(leaf_page) : 0;
+    }
+    SetItem(page);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SettleBackward(Page *page, const KeyType *key) {
+    auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
+    while (idx_ < 0) {
+        page_id_t page_id = page->GetPageId();
+        page_id_t prev_page_id = leaf_page->GetPrevPageId();
+        if (INVALID_PAGE_ID == prev_page_id || RangeEndsIn(leaf_page)) {
+            SetEnd(page);
+            return;
+        }
+        page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(page_id, false);
+        page = buffer_pool_manager_->FetchPage(prev_page_id);
+        if (nullptr == page) {
+            throw "illegal state";
+        }
+        page->RLatch();
+        leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
+        // the leaf split meanwhile if it is not the left sibling yet and its keys end below the key
+        while (page_id != leaf_page->GetNextPageId() && INVALID_PAGE_ID != leaf_page->GetNextPageId() &&
+               (nullptr == key || (*comparator_)(leaf_page->GetHighKey(), *key) < 0)) {
+            auto next_page = buffer_pool_manager_->FetchPage(leaf_page->GetNextPageId());
+            if (nullptr == next_page) {
+                throw "illegal state";
+            }
+            next_page->RLatch();
+            page->RUnlatch();
+            buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+            page = next_page;
+            leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
+        }
+        idx_ = (nullptr == key ? leaf_page->GetSize() : leaf_page->KeyIndex(*key, *comparator_)) - 1;
+    }
+    SetItem(page);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SetItem(Page *page) {
+    auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
+    if (has_bound_) {
+        int cmp = (*comparator_)(leaf_page->KeyAt(idx_), bound_);
+        if (reverse_ ? cmp < 0 || (0 == cmp && !bound_inclusive_) : cmp > 0 || (0 == cmp && !bound_inclusive_)) {
+            SetEnd(page);
+            return;
+        }
+    }
+    cur_page_id_ = page->GetPageId();
+    item_ = leaf_page->GetItem(idx_);
+    values_.clear();
+    value_idx_ = 0;
+    if (!unique_ && BPlusTreePostingPage::IsReference(item_.second)) {
+        BPlusTreePostingPage::ReadValues(item_.second, buffer_pool_manager_, &values_);
+        if (reverse_) {
+            std::reverse(values_.begin(), values_.end());
+        }
+        item_.second = values_[0];
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SetEnd(Page *page) {
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    cur_page_id_ = INVALID_PAGE_ID;
+    idx_ = 0;
+    values_.clear();
+    value_idx_ = 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int INDEXITERATOR_TYPE::IndexAfterItem(const LeafPage *leaf) const {
+    int index = leaf->KeyIndex(item_.first, *comparator_);
+    if (index < leaf->GetSize() && (*comparator_)(leaf->KeyAt(index), item_.first) == 0) {
+        index++;
+    }
+    return index;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::RangeEndsIn(const LeafPage *leaf) const {
+    // a leaf emptied by a merge links to the leaf it was merged into, its key range bounds nothing
+    if (!has_bound_ || 0 == leaf->GetSize()) {
+        return false;
+    }
+    if (reverse_) {
+        // the low key is only known to pages that compress keys
+        const KeyType *low_key = leaf->GetLowKey();
+        return nullptr != low_key && (*comparator_)(*low_key, bound_) <= 0;
+    }
+    // the keys of the leaves to the right are not below the high key
+    if (!leaf->HasHighKey()) {
+        return false;
+    }
+    int cmp = (*comparator_)(leaf->GetHighKey(), bound_);
+    return bound_inclusive_ ? cmp > 0 : cmp >= 0;
+}
+
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
 template class IndexIterator<GenericKey<8>, RID, GenericComparator<8>>;
@@ -68,4 +229,9 @@ template class IndexIterator<GenericKey<32>, RID, GenericComparator<32>>;
 
 template class IndexIterator<GenericKey<64>, RID, GenericComparator<64>>;
 
+template class IndexIterator<IntKey<4>, RID, IntKeyComparator<4>>;
+template class IndexIterator<IntKey<8>, RID, IntKeyComparator<8>>;
+
+template class IndexIterator<VarKey<256>, RID, VarKeyComparator<256>>;
+
 }  // namespace bustub
@@ -9,6 +9,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -25,12 +26,34 @@ namespace bustub {
  * max page size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size,
+                                          const KeyComparator *comparator) {
     SetPageId(page_id);
     SetParentPageId(parent_id);
-    SetMaxSize(max_size);
+    entries_.Init(comparator);
     SetSize(0);
+    UpdateMaxSize(max_size);
     SetPageType(IndexPageType::INTERNAL_PAGE);
+    SetNextPageId(INVALID_PAGE_ID);
+}
+
+/*
+ * Set the key range of the page, see BPlusTreeLeafPage::SetKeyRange()
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyRange(const KeyType *low_key, int max_size) {
+    entries_.SetKeyRange(low_key, HasHighKey() ? &high_key_ : nullptr, GetSize());
+    UpdateMaxSize(max_size);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::UpdateMaxSize(int max_size) {
+    SetMaxSize(std::min(max_size, entries_.Capacity()));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::MaxSizeFor(const KeyType *low_key, const KeyType *high_key, int max_size) const {
+    return std::min(max_size, entries_.CapacityFor(low_key, high_key));
 }
 /*
  * Helper method to get/set the key associated with input "index"(a.k.a
@@ -39,13 +62,13 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id
 INDEX_TEMPLATE_ARGUMENTS
 KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const {
   // replace with your own code
-  KeyType key = array[index].first;
+  KeyType key = entries_.KeyAt(index);
   return key;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {
-    array[index].first = key;
+    entries_.SetKeyAt(index, key);
 }
 
 /*
@@ -56,7 +79,7 @@ INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const {
     int N = GetSize();
     for (int i = 0; i < N; i++) {
-        if (array[i].second == value) {
+        if (entries_.ValueAt(i) == value) {
             return i;
         }
     }
@@ -71,7 +94,12 @@ INDEX_TEMPLATE_ARGUMENTS
 ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const {
     int N = GetSize();
     assert(0 <= index && index < N);
-    return array[index].second;
+    return entries_.ValueAt(index);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index, const ValueType &value) {
+    entries_.SetValueAt(index, value);
 }
 
 /*****************************************************************************
@@ -81,16 +109,11 @@ ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const {
  * Find and return the child pointer(page_id) which points to the child page
  * that contains input "key"
  * Start the search from the second key(the first key should always be invalid)
+ * The child is the one left of the first key > input key, see BPlusTreePageEntries::Search for how it is found.
  */
 INDEX_TEMPLATE_ARGUMENTS
 ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyComparator &comparator) const {
-    int N = GetSize();
-    for (int i = 1; i < N; ++i) {
-        if (comparator(key, array[i].first) < 0) {
-            return array[i-1].second;
-        }
-    }
-  return array[N-1].second;
+  return entries_.ValueAt(entries_.Search(1, GetSize(), key, comparator, true) - 1);
 }
 
 /*****************************************************************************
@@ -106,8 +129,8 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const ValueType &old_value, const KeyType &new_key,
                                                      const ValueType &new_value) {
 
-    array[0].second = old_value;
-    array[1]= {new_key,  new_value};
+    entries_.SetValueAt(0, old_value);
+    entries_.SetItemAt(1, {new_key, new_value});
     SetSize(2);
 }
 /*
@@ -121,18 +144,22 @@ int B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const ValueType &old_value,
     int N = GetSize();
     int oldi = 0;
     for (; oldi < N; ++oldi) {
-        if (array[oldi].second == old_value) {
+        if (entries_.ValueAt(oldi) == old_value) {
             break;
         }
     }
-    for (int i = N; oldi + 1 < i; i--) {
-        array[i] = array[i-1];
-    }
-    array[oldi + 1] = {new_key, new_value};
+    entries_.Move(oldi + 2, oldi + 1, N - oldi - 1);
+    entries_.SetItemAt(oldi + 1, {new_key, new_value});
     IncreaseSize(1);
     return GetSize();
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Append(const KeyType &key, const ValueType &value) {
+    entries_.SetItemAt(GetSize(), {key, value});
+    IncreaseSize(1);
+}
+
 /*****************************************************************************
  * SPLIT
  *****************************************************************************/
@@ -142,21 +169,29 @@ int B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const ValueType &old_value,
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient,
                                                 BufferPoolManager *buffer_pool_manager) {
-    int half_size = GetSize()/2;
-    int right_size = GetSize() - half_size;
-    recipient->CopyNFrom(array + half_size, right_size, buffer_pool_manager);
-    SetSize(half_size);
+    MoveTailTo(recipient, GetSize() / 2, buffer_pool_manager);
+}
+
+/*
+ * Remove the key & value pairs from index on to "recipient" page, the key at index is the separator of the pages
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveTailTo(BPlusTreeInternalPage *recipient, int index,
+                                                BufferPoolManager *buffer_pool_manager) {
+    recipient->CopyNFrom(this, index, GetSize() - index, buffer_pool_manager);
+    SetSize(index);
 }
 
-/* Copy entries into me, starting from {items} and copy {size} entries.
+/* Copy entries into me, starting from entry {index} of donor and copy {size} entries.
  * Since it is an internal page, for all entries (pages) moved, their parents page now changes to me.
  * So I need to 'adopt' them by changing their parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager) {
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(const BPlusTreeInternalPage *donor, int index, int size,
+                                               BufferPoolManager *buffer_pool_manager) {
     SetSize(size);
+    entries_.CopyFrom(0, donor->entries_, index, size);
     for (int i = 0; i < size; ++i) {
-        array[i] = items[i];
         auto child_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager->FetchPage(ValueAt(i))->GetData());
         child_page->SetParentPageId(GetPageId());
         buffer_pool_manager->UnpinPage(child_page->GetPageId(), true);
@@ -172,14 +207,21 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, Buf
  * NOTE: store key&value pair continuously after deletion
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
+    entries_.Move(index, index + 1, GetSize() - index - 1);
+    IncreaseSize(-1);
+}
 
 /*
  * Remove the only key & value pair in internal page and return the value
  * NOTE: only call this method within AdjustRoot()(in b_plus_tree.cpp)
  */
 INDEX_TEMPLATE_ARGUMENTS
-ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() { return INVALID_PAGE_ID; }
+ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() {
+    ValueType only_child = ValueAt(0);
+    SetSize(0);
+    return only_child;
+}
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
@@ -194,8 +236,10 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                                                BufferPoolManager *buffer_pool_manager) {
     int N = GetSize();
+    // the first child moves behind the separator of this page in the parent
+    entries_.SetKeyAt(0, middle_key);
     for (int i = 0; i < N; i++) {
-        recipient->CopyLastFrom(array[i], buffer_pool_manager);
+        recipient->CopyLastFrom(entries_.ItemAt(i), buffer_pool_manager);
     }
     IncreaseSize(-N);
 }
@@ -215,13 +259,9 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                                                       BufferPoolManager *buffer_pool_manager) {
     int N = GetSize();
-    MappingType pair = array[0];
-    memmove(array, array + 1, N - 1);
-    recipient->CopyLastFrom(pair, buffer_pool_manager);
-
-    auto parentPage  = reinterpret_cast<BPlusTreeInternalPage *>(buffer_pool_manager->FetchPage(GetParentPageId())->GetData());
-    parentPage->SetKeyAt(parentPage->ValueIndex(GetPageId()), array[0].first);
-    buffer_pool_manager->UnpinPage(parentPage->GetPageId(), true);
+    // the first child moves behind the separator of this page in the parent, the caller moves KeyAt(1) up instead
+    recipient->CopyLastFrom({middle_key, entries_.ValueAt(0)}, buffer_pool_manager);
+    entries_.Move(0, 1, N - 1);
     IncreaseSize(-1);
 }
 
@@ -232,7 +272,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *rec
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
     int N = GetSize();
-    array[N] = pair;
+    entries_.SetItemAt(N, pair);
 
     auto moved_page  = reinterpret_cast<BPlusTreeInternalPage *>(buffer_pool_manager->FetchPage(pair.second)->GetData());
     moved_page->SetParentPageId(GetPageId());
@@ -252,8 +292,10 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                                                        BufferPoolManager *buffer_pool_manager) {
     int N = GetSize();
-    MappingType pair = array[N-1];
-    recipient->CopyFirstFrom(pair, buffer_pool_manager);
+    // the separator of the recipient in the parent moves down in front of its old first child, the caller moves the
+    // last key of this page up instead
+    recipient->CopyFirstFrom(entries_.ItemAt(N - 1), buffer_pool_manager);
+    recipient->SetKeyAt(1, middle_key);
     IncreaseSize(-1);
 }
 
@@ -264,19 +306,12 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *re
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
     int N = GetSize();
-    for (int i = N; 0 < i - 1; i--) {
-        array[i] = array[i-1];
-    }
-    array[0] = pair;
+    entries_.Move(1, 0, N);
+    entries_.SetItemAt(0, pair);
 
     auto moved_page  = reinterpret_cast<BPlusTreeInternalPage *>(buffer_pool_manager->FetchPage(pair.second)->GetData());
     moved_page->SetParentPageId(GetPageId());
     buffer_pool_manager->UnpinPage(moved_page->GetPageId(), true);
-
-
-    auto parent_page  = reinterpret_cast<BPlusTreeInternalPage *>(buffer_pool_manager->FetchPage(GetParentPageId())->GetData());
-    parent_page->SetKeyAt(parent_page->ValueIndex(GetPageId()), array[0].first);
-    buffer_pool_manager->UnpinPage(parent_page->GetPageId(), true);
     IncreaseSize(1);
 }
 
@@ -302,4 +337,17 @@ template class BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator
 template class BPlusTreeInternalPage<GenericKey<16>, page_id_t, GenericComparator<16>>;
 template class BPlusTreeInternalPage<GenericKey<32>, page_id_t, GenericComparator<32>>;
 template class BPlusTreeInternalPage<GenericKey<64>, page_id_t, GenericComparator<64>>;
+
+template class BPlusTreeInternalPage<IntKey<4>, page_id_t, IntKeyComparator<4>>;
+template class BPlusTreeInternalPage<IntKey<8>, page_id_t, IntKeyComparator<8>>;
+
+template class BPlusTreeInternalPage<VarKey<256>, page_id_t, VarKeyComparator<256>>;
+static_assert(sizeof(BPlusTreeInternalPage<GenericKey<64>, page_id_t, GenericComparator<64>>) <= PAGE_SIZE,
+              "internal page overflows page");
+static_assert(sizeof(BPlusTreeInternalPage<IntKey<4>, page_id_t, IntKeyComparator<4>>) <= PAGE_SIZE,
+              "internal page overflows page");
+static_assert(sizeof(BPlusTreeInternalPage<IntKey<8>, page_id_t, IntKeyComparator<8>>) <= PAGE_SIZE,
+              "internal page overflows page");
+static_assert(sizeof(BPlusTreeInternalPage<VarKey<256>, page_id_t, VarKeyComparator<256>>) <= PAGE_SIZE,
+              "internal page overflows page");
 }  // namespace bustub
@@ -9,6 +9,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <sstream>
 
 #include "common/exception.h"
@@ -27,39 +28,49 @@ namespace bustub {
  * next page id and set max size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size,
+                                      const KeyComparator *comparator) {
   SetPageId(page_id);
   SetParentPageId(parent_id);
-  SetMaxSize(max_size);
+  entries_.Init(comparator);
   SetSize(0);
+  UpdateMaxSize(max_size);
   SetPageType(IndexPageType::LEAF_PAGE);
   SetNextPageId(INVALID_PAGE_ID);
+  SetPrevPageId(INVALID_PAGE_ID);
+  version_ = 0;
 }
 
-/**
- * Helper methods to set/get next page id
+/*
+ * Set the key range of the page to [low_key, high key), or to everything below the high key if low_key is nullptr,
+ * and no high key if the page has no right sibling. The right-link and high key must be set first.
+ * Pages that compress keys encode them for the new range and update their max size; a page must not hold more
+ * entries than MaxSizeFor() its new range when the range grows.
  */
 INDEX_TEMPLATE_ARGUMENTS
-page_id_t B_PLUS_TREE_LEAF_PAGE_TYPE::GetNextPageId() const { return next_page_id_; }
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetKeyRange(const KeyType *low_key, int max_size) {
+  entries_.SetKeyRange(low_key, HasHighKey() ? &high_key_ : nullptr, GetSize());
+  UpdateMaxSize(max_size);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::UpdateMaxSize(int max_size) {
+  // one entry stays free for the insert that overflows a full leaf right before it is split
+  SetMaxSize(std::min(max_size, entries_.Capacity() - 1));
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) {
-  next_page_id_=next_page_id;
+int B_PLUS_TREE_LEAF_PAGE_TYPE::MaxSizeFor(const KeyType *low_key, const KeyType *high_key, int max_size) const {
+  return std::min(max_size, entries_.CapacityFor(low_key, high_key) - 1);
 }
 
 /**
- * Helper method to find the first index i so that array[i].first >= key
- * NOTE: This method is only used when generating index iterator
+ * Helper method to find the first index i so that array[i].first >= key, or GetSize() if there is none
+ * (see BPlusTreePageEntries::Search for how the lower bound is found)
  */
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const {
-  int N = GetSize();
-  for (int i = 0; i < N; ++i) {
-    if (comparator(key, array[i].first) <= 0) {
-      return i;
-    }
-  }
-  return -1;
+  return entries_.Search(0, GetSize(), key, comparator, false);
 }
 
 /*
@@ -69,7 +80,7 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator
 INDEX_TEMPLATE_ARGUMENTS
 KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const {
   // replace with your own code
-  KeyType key = array[index].first;
+  KeyType key = entries_.KeyAt(index);
   return key;
 }
 
@@ -78,9 +89,18 @@ KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const {
  * "index"(a.k.a array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) {
-  // replace with your own code
-  return array[index];
+MappingType B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) {
+  return entries_.ItemAt(index);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+ValueType B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const {
+  return entries_.ValueAt(index);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetValueAt(int index, const ValueType &value) {
+  entries_.SetValueAt(index, value);
 }
 
 /*****************************************************************************
@@ -94,25 +114,12 @@ INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator) {
   int N = GetSize();
   if (0 == N || comparator(key, KeyAt(N-1)) > 0) {
-    array[N] = {key, value};
+    entries_.SetItemAt(N, {key, value});
   } else {
-    int l = 0;
-    int r = N - 1;
-    while (l < r) {
-      int mid = (l+r)/2;
-      if (comparator(key, array[mid].first) < 0) {
-        r = mid;
-      } else if (comparator(key, array[mid].first) > 0) {
-        l = mid + 1;
-      } else {
-        assert(0);
-      }
-    }
-
-    for (int i = N; r < i; i--) {
-      array[i] = array[i-1];
-    }
-    array[r] = {key, value};
+    int r = KeyIndex(key, comparator);
+    assert(comparator(key, entries_.KeyAt(r)) != 0);
+    entries_.Move(r + 1, r, N - r);
+    entries_.SetItemAt(r, {key, value});
   }
 
   IncreaseSize(1);
@@ -127,20 +134,26 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &valu
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient) {
-    int half_size = GetSize()/2;
-    int left_size = GetSize() - half_size;
-    recipient->CopyNFrom(array+ left_size, half_size);
-    SetSize(left_size);
+    MoveTailTo(recipient, GetSize() - GetSize() / 2);
 }
 
 /*
- * Copy starting from items, and copy {size} number of elements into me.
+ * Remove the key & value pairs from index on to "recipient" page
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {
-    for (int i = 0; i < size; ++i) {
-        array[i] = items[i];
-    }
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveTailTo(BPlusTreeLeafPage *recipient, int index) {
+    recipient->CopyNFrom(this, index, GetSize() - index);
+    SetSize(index);
+    BumpVersion();
+    recipient->BumpVersion();
+}
+
+/*
+ * Copy {size} number of elements of donor, starting from index, into me.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(const BPlusTreeLeafPage *donor, int index, int size) {
+    entries_.CopyFrom(0, donor->entries_, index, size);
     SetSize(size);
 }
 
@@ -154,18 +167,11 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const {
-    int l = 0, r = GetSize();
-    while (l < r) {
-        int mid = (l + r)/2;
-        if (comparator(key, array[mid].first) < 0) {
-            r = mid;
-        } else if (comparator(key, array[mid].first) > 0) {
-            l = mid + 1;
-        } else {
-            *value = array[mid].second;
-            return true;
-        }
-    }
+  int i = KeyIndex(key, comparator);
+  if (i < GetSize() && comparator(key, entries_.KeyAt(i)) == 0) {
+    *value = entries_.ValueAt(i);
+    return true;
+  }
   return false;
 }
 
@@ -180,21 +186,10 @@ bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, co
  */
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator) {
-    int l = 0;
-    int r = GetSize() - 1;
-    while (l <= r) {
-        int mid = (l + r)/2;
-        if (comparator(key, array[mid].first) < 0) {
-            r = mid - 1;
-        } else if (comparator(key, array[mid].first) > 0) {
-            l = mid + 1;
-        } else {
-            for (int i = mid; i + 1 < GetSize(); i++) {
-                array[i] = array[i+1];
-            }
-            IncreaseSize(-1);
-            break;
-        }
+    int i = KeyIndex(key, comparator);
+    if (i < GetSize() && comparator(key, entries_.KeyAt(i)) == 0) {
+        entries_.Move(i, i + 1, GetSize() - i - 1);
+        IncreaseSize(-1);
     }
     return GetSize();
 }
@@ -210,11 +205,13 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {
     int N = GetSize();
     for (int i = 0; i < N; i++) {
-        recipient->CopyLastFrom(array[i]);
+        recipient->CopyLastFrom(entries_.ItemAt(i));
     }
 
     recipient->SetNextPageId(GetNextPageId());
     IncreaseSize(-N);
+    BumpVersion();
+    recipient->BumpVersion();
 }
 
 /*****************************************************************************
@@ -225,8 +222,11 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) {
-    recipient->CopyFirstFrom(array[0]);
-    CopyNFrom(&array[1], GetSize() - 1);
+    recipient->CopyLastFrom(entries_.ItemAt(0));
+    entries_.Move(0, 1, GetSize() - 1);
+    IncreaseSize(-1);
+    BumpVersion();
+    recipient->BumpVersion();
 }
 
 /*
@@ -235,7 +235,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient)
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {
     int N = GetSize();
-    array[N] = item;
+    entries_.SetItemAt(N, item);
     IncreaseSize(1);
 }
 
@@ -245,9 +245,10 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) {
     int N = GetSize();
-    MappingType item = array[N-1];
-    recipient->CopyLastFrom(item);
+    recipient->CopyFirstFrom(entries_.ItemAt(N-1));
     IncreaseSize(-1);
+    BumpVersion();
+    recipient->BumpVersion();
 }
 
 /*
@@ -256,10 +257,8 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient)
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(const MappingType &item) {
     int N = GetSize();
-    for (int i = N; 1 <= i; i--) {
-        array[i] = array[i-1];
-    }
-    array[0] = item;
+    entries_.Move(1, 0, N);
+    entries_.SetItemAt(0, item);
     IncreaseSize(1);
 }
 
@@ -268,4 +267,15 @@ template class BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeLeafPage<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTreeLeafPage<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTreeLeafPage<GenericKey<64>, RID, GenericComparator<64>>;
+
+template class BPlusTreeLeafPage<IntKey<4>, RID, IntKeyComparator<4>>;
+template class BPlusTreeLeafPage<IntKey<8>, RID, IntKeyComparator<8>>;
+
+template class BPlusTreeLeafPage<VarKey<256>, RID, VarKeyComparator<256>>;
+static_assert(sizeof(BPlusTreeLeafPage<GenericKey<4>, RID, GenericComparator<4>>) <= PAGE_SIZE, "leaf overflows page");
+static_assert(sizeof(BPlusTreeLeafPage<GenericKey<64>, RID, GenericComparator<64>>) <= PAGE_SIZE,
+              "leaf overflows page");
+static_assert(sizeof(BPlusTreeLeafPage<IntKey<4>, RID, IntKeyComparator<4>>) <= PAGE_SIZE, "leaf overflows page");
+static_assert(sizeof(BPlusTreeLeafPage<IntKey<8>, RID, IntKeyComparator<8>>) <= PAGE_SIZE, "leaf overflows page");
+static_assert(sizeof(BPlusTreeLeafPage<VarKey<256>, RID, VarKeyComparator<256>>) <= PAGE_SIZE, "leaf overflows page");
 }  // namespace bustub
@@ -69,6 +69,12 @@ void BPlusTreePage::SetPageId(page_id_t page_id) {
     page_id_ = page_id;
 }
 
+/*
+ * Helper methods to get/set the page id of the right sibling
+ */
+page_id_t BPlusTreePage::GetNextPageId() const { return next_page_id_; }
+void BPlusTreePage::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
 /*
  * Helper methods to set lsn
  */
@@ -0,0 +1,88 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_posting_page.cpp
+//
+// Identification: src/storage/page/b_plus_tree_posting_page.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstring>
+
+#include "storage/page/b_plus_tree_posting_page.h"
+
+namespace bustub {
+
+void BPlusTreePostingPage::Init(page_id_t page_id) {
+  page_id_ = page_id;
+  next_page_id_ = INVALID_PAGE_ID;
+  size_ = 0;
+}
+
+int BPlusTreePostingPage::ValueIndex(const RID &value) const {
+  int low = 0;
+  int high = size_;
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (values_[mid].Get() < value.Get()) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+void BPlusTreePostingPage::Insert(const RID &value) {
+  int index = ValueIndex(value);
+  std::memmove(values_ + index + 1, values_ + index, (size_ - index) * sizeof(RID));
+  values_[index] = value;
+  size_++;
+}
+
+bool BPlusTreePostingPage::Remove(const RID &value) {
+  int index = ValueIndex(value);
+  if (index == size_ || !(values_[index] == value)) {
+    return false;
+  }
+  std::memmove(values_ + index, values_ + index + 1, (size_ - index - 1) * sizeof(RID));
+  size_--;
+  return true;
+}
+
+void BPlusTreePostingPage::MoveHalfTo(BPlusTreePostingPage *recipient) {
+  int keep = size_ - size_ / 2;
+  std::memcpy(recipient->values_, values_ + keep, (size_ - keep) * sizeof(RID));
+  recipient->size_ = size_ - keep;
+  recipient->next_page_id_ = next_page_id_;
+  next_page_id_ = recipient->page_id_;
+  size_ = keep;
+}
+
+void BPlusTreePostingPage::MoveAllFrom(BPlusTreePostingPage *donor) {
+  std::memcpy(values_ + size_, donor->values_, donor->size_ * sizeof(RID));
+  size_ += donor->size_;
+  next_page_id_ = donor->next_page_id_;
+  donor->size_ = 0;
+}
+
+void BPlusTreePostingPage::ReadValues(const RID &value, BufferPoolManager *buffer_pool_manager,
+                                      std::vector<RID> *result) {
+  if (!IsReference(value)) {
+    result->push_back(value);
+    return;
+  }
+  for (page_id_t page_id = value.GetPageId(); INVALID_PAGE_ID != page_id;) {
+    auto page = buffer_pool_manager->FetchPage(page_id);
+    if (nullptr == page) {
+      throw "out of memory";
+    }
+    auto posting_page = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+    result->insert(result->end(), posting_page->values_, posting_page->values_ + posting_page->size_);
+    page_id = posting_page->next_page_id_;
+    buffer_pool_manager->UnpinPage(page->GetPageId(), false);
+  }
+}
+
+}  // namespace bustub
@@ -12,6 +12,7 @@
 
 #include <cassert>
 
+#include "common/exception.h"
 #include "common/logger.h"
 #include "storage/table/table_heap.h"
 
@@ -169,6 +170,35 @@ bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
   return res;
 }
 
+page_id_t TableHeap::GetNextPageId(page_id_t page_id) {
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "table page could not be fetched");
+  }
+  page->RLatch();
+  auto next_page_id = page->GetNextPageId();
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return next_page_id;
+}
+
+void TableHeap::GetPageTuples(page_id_t page_id, std::vector<Tuple> *tuples, Transaction *txn) {
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "table page could not be fetched");
+  }
+  page->RLatch();
+  RID rid;
+  for (bool found = page->GetFirstTupleRid(&rid); found; found = page->GetNextTupleRid(rid, &rid)) {
+    Tuple tuple;
+    if (page->GetTuple(rid, &tuple, txn, lock_manager_)) {
+      tuples->push_back(tuple);
+    }
+  }
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, false);
+}
+
 TableIterator TableHeap::Begin(Transaction *txn) {
   // Start an iterator from the first page.
   // TODO(Wuwen): Hacky fix for now. Removing empty pages is a better way to handle this.
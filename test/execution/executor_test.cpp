@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include <cstdio>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_set>
@@ -18,7 +19,10 @@
 #include <vector>
 
 #include "execution/plans/delete_plan.h"
+#include "execution/plans/index_only_scan_plan.h"
+#include "execution/plans/index_scan_plan.h"
 #include "execution/plans/limit_plan.h"
+#include "execution/plans/nested_index_join_plan.h"
 
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/table_generator.h"
@@ -385,6 +389,261 @@ TEST_F(ExecutorTest, SimpleDeleteTest) {
   delete key_schema;
 }
 
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, IndexOnlyScanTest) {
+  // CREATE INDEX index1 ON test_1 (colA) INCLUDE (colB)
+  // SELECT colA, colB FROM test_1 WHERE colA >= 100 AND colA < 200 AND colB < 5, from the index alone
+
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  Schema *key_schema = ParseCreateStatement("a integer,b integer");
+  auto index_info = GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      GetTxn(), "index1", "test_1", schema, *key_schema, {0}, 8, true, {1});
+  ASSERT_EQ(index_info->index_->GetIncludedColumnCount(), 1);
+
+  auto colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto colB = MakeColumnValueExpression(schema, 0, "colB");
+  auto const5 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(5));
+  auto out_schema = MakeOutputSchema({{"colA", colA}, {"colB", colB}});
+  auto out_colB = MakeColumnValueExpression(*out_schema, 0, "colB");
+  auto predicate = MakeComparisonExpression(out_colB, const5, ComparisonType::LessThan);
+  // the bounds only set the key column, the included column is not searched for
+  auto index_schema = index_info->index_->GetKeySchema();
+  Tuple low_key({ValueFactory::GetIntegerValue(100), ValueFactory::GetIntegerValue(9)}, index_schema);
+  Tuple high_key({ValueFactory::GetIntegerValue(200), ValueFactory::GetIntegerValue(0)}, index_schema);
+  IndexOnlyScanPlanNode plan{out_schema, predicate, index_info->index_oid_, &low_key, true, &high_key, false};
+
+  std::vector<Tuple> result_set;
+  GetExecutionEngine()->Execute(&plan, &result_set, GetTxn(), GetExecutorContext());
+
+  // the same rows as reading the table
+  std::vector<Tuple> table_set;
+  for (auto iter = table_info->table_->Begin(GetTxn()); iter != table_info->table_->End(); ++iter) {
+    auto a = iter->GetValue(&schema, 0).GetAs<int32_t>();
+    if (a >= 100 && a < 200 && iter->GetValue(&schema, 1).GetAs<int32_t>() < 5) {
+      table_set.push_back(*iter);
+    }
+  }
+  ASSERT_EQ(result_set.size(), table_set.size());
+  for (size_t i = 0; i < result_set.size(); i++) {
+    for (uint32_t col = 0; col < 2; col++) {
+      ASSERT_EQ(result_set[i].GetValue(out_schema, col).GetAs<int32_t>(),
+                table_set[i].GetValue(&schema, col).GetAs<int32_t>());
+    }
+  }
+
+  // a point lookup only searches for the key column
+  std::vector<RID> rids;
+  Tuple key({ValueFactory::GetIntegerValue(150), ValueFactory::GetIntegerValue(0)}, index_schema);
+  index_info->index_->ScanKey(key, &rids, GetTxn());
+  ASSERT_EQ(rids.size(), 1);
+
+  // a column the index does not hold cannot be read
+  auto colC = MakeColumnValueExpression(schema, 0, "colC");
+  auto uncovered_schema = MakeOutputSchema({{"colA", colA}, {"colC", colC}});
+  IndexOnlyScanPlanNode uncovered_plan{uncovered_schema, nullptr, index_info->index_oid_};
+  result_set.clear();
+  ASSERT_THROW(GetExecutionEngine()->Execute(&uncovered_plan, &result_set, GetTxn(), GetExecutorContext()), Exception);
+
+  delete key_schema;
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, IntKeyIndexScanTest) {
+  // CREATE INDEX index1 ON test_1 (colA)
+  // SELECT colA, colB FROM test_1 WHERE colA >= 100 AND colA < 200 AND colB < 5
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  Schema *key_schema = ParseCreateStatement("a integer");
+  auto index_info = GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      GetTxn(), "index1", "test_1", schema, *key_schema, {0}, 8);
+  // a single INTEGER key column is kept in IntKey pages
+  ASSERT_NE((dynamic_cast<BPlusTreeIndex<IntKey<4>, RID, IntKeyComparator<4>> *>(index_info->index_.get())), nullptr);
+
+  auto colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto colB = MakeColumnValueExpression(schema, 0, "colB");
+  auto const5 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(5));
+  auto out_schema = MakeOutputSchema({{"colA", colA}, {"colB", colB}});
+  auto predicate = MakeComparisonExpression(colB, const5, ComparisonType::LessThan);
+  Tuple low_key({ValueFactory::GetIntegerValue(100)}, index_info->index_->GetKeySchema());
+  Tuple high_key({ValueFactory::GetIntegerValue(200)}, index_info->index_->GetKeySchema());
+  IndexScanPlanNode plan{out_schema, predicate, index_info->index_oid_, &low_key, true, &high_key, false};
+  std::vector<Tuple> result_set;
+  GetExecutionEngine()->Execute(&plan, &result_set, GetTxn(), GetExecutorContext());
+
+  std::vector<Tuple> table_set;
+  for (auto iter = table_info->table_->Begin(GetTxn()); iter != table_info->table_->End(); ++iter) {
+    auto a = iter->GetValue(&schema, 0).GetAs<int32_t>();
+    if (a >= 100 && a < 200 && iter->GetValue(&schema, 1).GetAs<int32_t>() < 5) {
+      table_set.push_back(*iter);
+    }
+  }
+  ASSERT_EQ(result_set.size(), table_set.size());
+  for (size_t i = 0; i < result_set.size(); i++) {
+    ASSERT_EQ(result_set[i].GetValue(&schema, 0).GetAs<int32_t>(),
+              table_set[i].GetValue(&schema, 0).GetAs<int32_t>());
+  }
+
+  // CREATE INDEX index2 ON test_3 (col3), a non-unique BIGINT key
+  auto table3_info = GetExecutorContext()->GetCatalog()->GetTable("test_3");
+  auto &schema3 = table3_info->schema_;
+  Schema *key_schema3 = ParseCreateStatement("a bigint");
+  auto index3_info = GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      GetTxn(), "index2", "test_3", schema3, *key_schema3, {2}, 8, false);
+  ASSERT_NE((dynamic_cast<BPlusTreeIndex<IntKey<8>, RID, IntKeyComparator<8>> *>(index3_info->index_.get())), nullptr);
+  size_t table3_count = 0;
+  for (auto iter = table3_info->table_->Begin(GetTxn()); iter != table3_info->table_->End(); ++iter) {
+    table3_count += iter->GetValue(&schema3, 2).GetAs<int64_t>() <= 512 ? 1 : 0;
+  }
+  auto col3 = MakeColumnValueExpression(schema3, 0, "col3");
+  auto out_schema3 = MakeOutputSchema({{"col3", col3}});
+  Tuple high_key3({ValueFactory::GetBigIntValue(512)}, index3_info->index_->GetKeySchema());
+  IndexScanPlanNode plan3{out_schema3, nullptr, index3_info->index_oid_, nullptr, true, &high_key3, true};
+  result_set.clear();
+  GetExecutionEngine()->Execute(&plan3, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), table3_count);
+  for (size_t i = 1; i < result_set.size(); i++) {
+    ASSERT_LE(result_set[i - 1].GetValue(&schema3, 2).GetAs<int64_t>(),
+              result_set[i].GetValue(&schema3, 2).GetAs<int64_t>());
+  }
+
+  delete key_schema3;
+  delete key_schema;
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, BwTreeIndexTest) {
+  // CREATE INDEX index1 ON test_1 (colA) USING BWTREE
+  // DELETE FROM test_1 WHERE colA == 50
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  Schema *key_schema = ParseCreateStatement("a integer");
+  auto index_info = GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      GetTxn(), "index1", "test_1", schema, *key_schema, {0}, 8, true, {}, IndexType::BW_TREE);
+
+  // every tuple of the table is in the index
+  std::vector<RID> rids;
+  for (auto iter = table_info->table_->Begin(GetTxn()); iter != table_info->table_->End(); ++iter) {
+    rids.clear();
+    index_info->index_->ScanKey(iter->KeyFromTuple(schema, *index_info->index_->GetKeySchema(), {0}), &rids,
+                                GetTxn());
+    ASSERT_EQ(rids.size(), 1);
+    EXPECT_EQ(rids[0], iter->GetRid());
+  }
+
+  // the delete executor maintains the index
+  auto colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto const50 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(50));
+  auto predicate = MakeComparisonExpression(colA, const50, ComparisonType::Equal);
+  auto out_schema = MakeOutputSchema({{"colA", colA}});
+  SeqScanPlanNode scan_plan{out_schema, predicate, table_info->oid_};
+  DeletePlanNode delete_plan{&scan_plan, table_info->oid_};
+  GetExecutionEngine()->Execute(&delete_plan, nullptr, GetTxn(), GetExecutorContext());
+  Tuple key({ValueFactory::GetIntegerValue(50)}, index_info->index_->GetKeySchema());
+  rids.clear();
+  index_info->index_->ScanKey(key, &rids, GetTxn());
+  EXPECT_TRUE(rids.empty());
+
+  // range scans need a B+ tree
+  IndexScanPlanNode index_scan_plan{out_schema, nullptr, index_info->index_oid_};
+  std::vector<Tuple> result_set;
+  EXPECT_THROW(GetExecutionEngine()->Execute(&index_scan_plan, &result_set, GetTxn(), GetExecutorContext()),
+               Exception);
+
+  delete key_schema;
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, ArtIndexTest) {
+  // CREATE INDEX index1 ON test_1 (colA) USING ART
+  // DELETE FROM test_1 WHERE colA == 50
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  Schema *key_schema = ParseCreateStatement("a integer");
+  auto index_info = GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      GetTxn(), "index1", "test_1", schema, *key_schema, {0}, 8, true, {}, IndexType::ART);
+  auto art_index = dynamic_cast<ArtIndex<GenericKey<64>, RID, GenericComparator<64>> *>(index_info->index_.get());
+  ASSERT_NE(art_index, nullptr);
+
+  // the index is built from every tuple of the table
+  std::map<int32_t, RID> table_rids;
+  for (auto iter = table_info->table_->Begin(GetTxn()); iter != table_info->table_->End(); ++iter) {
+    table_rids.emplace(iter->GetValue(&schema, 0).GetAs<int32_t>(), iter->GetRid());
+  }
+  std::vector<RID> rids;
+  art_index->ScanRange(nullptr, nullptr, &rids);
+  ASSERT_EQ(rids.size(), table_rids.size());
+  auto table_rid = table_rids.begin();
+  for (const auto &rid : rids) {
+    EXPECT_EQ(rid, (table_rid++)->second);
+  }
+
+  // the delete executor maintains the index
+  auto colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto const50 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(50));
+  auto predicate = MakeComparisonExpression(colA, const50, ComparisonType::Equal);
+  auto out_schema = MakeOutputSchema({{"colA", colA}});
+  SeqScanPlanNode scan_plan{out_schema, predicate, table_info->oid_};
+  DeletePlanNode delete_plan{&scan_plan, table_info->oid_};
+  GetExecutionEngine()->Execute(&delete_plan, nullptr, GetTxn(), GetExecutorContext());
+  Tuple key({ValueFactory::GetIntegerValue(50)}, index_info->index_->GetKeySchema());
+  rids.clear();
+  art_index->ScanKey(key, &rids, GetTxn());
+  EXPECT_TRUE(rids.empty());
+
+  // short range lookup
+  Tuple low_key({ValueFactory::GetIntegerValue(45)}, index_info->index_->GetKeySchema());
+  Tuple high_key({ValueFactory::GetIntegerValue(54)}, index_info->index_->GetKeySchema());
+  rids.clear();
+  art_index->ScanRange(&low_key, &high_key, &rids);
+  ASSERT_EQ(rids.size(), 9);
+  EXPECT_EQ(rids[0], table_rids[45]);
+  EXPECT_EQ(rids[5], table_rids[51]);
+
+  delete key_schema;
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, ParallelIndexBuildTest) {
+  // CREATE INDEX ON test_1 (colB), with one thread scanning the table and with several
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  auto table = table_info->table_.get();
+  ASSERT_NE(table->GetNextPageId(table->GetFirstPageId()), INVALID_PAGE_ID);
+
+  // the first RID of each colB value, in table order
+  std::map<int32_t, RID> first_rids;
+  for (auto iter = table->Begin(GetTxn()); iter != table->End(); ++iter) {
+    first_rids.emplace(iter->GetValue(&schema, 1).GetAs<int32_t>(), iter->GetRid());
+  }
+
+  using BuiltIndex = BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
+  auto build = [&](const std::string &name, bool unique, size_t threads) {
+    auto index = std::make_unique<BuiltIndex>(new IndexMetadata(name, "test_1", &schema, {1}), GetBPM(), unique);
+    EXPECT_TRUE(index->BulkLoad(table, schema, GetTxn(), 1.0, threads));
+    std::vector<std::pair<int64_t, RID>> entries;
+    for (auto iter = index->GetBeginIterator(); !iter.isEnd(); ++iter) {
+      entries.emplace_back((*iter).first.ToString(), (*iter).second);
+    }
+    EXPECT_FALSE(index->BulkLoad(table, schema, GetTxn(), 1.0, threads));
+    return entries;
+  };
+
+  for (bool unique : {false, true}) {
+    auto serial = build(unique ? "serial_unique" : "serial", unique, 1);
+    auto parallel = build(unique ? "parallel_unique" : "parallel", unique, 4);
+    ASSERT_EQ(serial.size(), unique ? first_rids.size() : TEST1_SIZE);
+    ASSERT_EQ(parallel, serial);
+    if (unique) {
+      // of equal keys, the first tuple of the table is kept
+      size_t i = 0;
+      for (const auto &first : first_rids) {
+        EXPECT_EQ(parallel[i++].second, first.second);
+      }
+    }
+  }
+}
+
 // NOLINTNEXTLINE
 TEST_F(ExecutorTest, SimpleNestedLoopJoinTest) {
   // SELECT test_1.colA, test_1.colB, test_2.col1, test_2.col3 FROM test_1 JOIN test_2 ON test_1.colA = test_2.col1
@@ -435,6 +694,53 @@ TEST_F(ExecutorTest, SimpleNestedLoopJoinTest) {
   }
 }
 
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, NestedIndexJoinTest) {
+  // CREATE INDEX index1 ON test_3 (col1)
+  // SELECT test_1.colA, test_1.colB, test_3.col1, test_3.col3 FROM test_1 JOIN test_3 ON test_1.colA = test_3.col1
+  auto table3_info = GetExecutorContext()->GetCatalog()->GetTable("test_3");
+  auto &schema3 = table3_info->schema_;
+  Schema *key_schema = ParseCreateStatement("a integer");
+  GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      GetTxn(), "index1", "test_3", schema3, *key_schema, {0}, 8);
+
+  std::unique_ptr<AbstractPlanNode> scan_plan;
+  const Schema *out_schema1;
+  {
+    auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+    auto &schema = table_info->schema_;
+    auto colA = MakeColumnValueExpression(schema, 0, "colA");
+    auto colB = MakeColumnValueExpression(schema, 0, "colB");
+    out_schema1 = MakeOutputSchema({{"colA", colA}, {"colB", colB}});
+    scan_plan = std::make_unique<SeqScanPlanNode>(out_schema1, nullptr, table_info->oid_);
+  }
+  std::unique_ptr<NestedIndexJoinPlanNode> join_plan;
+  const Schema *out_final;
+  {
+    auto colA = MakeColumnValueExpression(*out_schema1, 0, "colA");
+    auto colB = MakeColumnValueExpression(*out_schema1, 0, "colB");
+    // the inner tuples are looked up in the index, their columns are those of the table
+    auto col1 = MakeColumnValueExpression(schema3, 1, "col1");
+    auto col3 = MakeColumnValueExpression(schema3, 1, "col3");
+    auto predicate = MakeComparisonExpression(colA, col1, ComparisonType::Equal);
+    out_final = MakeOutputSchema({{"colA", colA}, {"colB", colB}, {"col1", col1}, {"col3", col3}});
+    join_plan = std::make_unique<NestedIndexJoinPlanNode>(
+        out_final, std::vector<const AbstractPlanNode *>{scan_plan.get()}, predicate, table3_info->oid_, "index1",
+        out_schema1, &schema3);
+  }
+
+  // the 1000 outer tuples are looked up in several batches, the first 100 of them find their test_3 tuple
+  std::vector<Tuple> result_set;
+  GetExecutionEngine()->Execute(join_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), TEST2_SIZE);
+  for (const auto &tuple : result_set) {
+    ASSERT_EQ(tuple.GetValue(out_final, out_final->GetColIdx("colA")).GetAs<int32_t>(),
+              tuple.GetValue(out_final, out_final->GetColIdx("col1")).GetAs<int32_t>());
+  }
+
+  delete key_schema;
+}
+
 // NOLINTNEXTLINE
 TEST_F(ExecutorTest, DISABLED_SimpleAggregationTest) {
   // SELECT COUNT(colA), SUM(colA), min(colA), max(colA) from test_1;
@@ -0,0 +1,290 @@
+/**
+ * art_tree_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/art_tree.h"
+#include "storage/index/b_plus_tree.h"
+
+namespace bustub {
+
+// a normalized bigint key takes 9 bytes
+using TestArtTree = ArtTree<GenericKey<16>, RID, GenericComparator<16>>;
+
+namespace {
+
+RID KeyRid(int64_t key) { return RID(static_cast<int32_t>(key >> 32), static_cast<uint32_t>(key & 0xFFFFFFFF)); }
+
+GenericKey<16> NormalizedKey(int64_t key, const Schema *key_schema) {
+  GenericKey<16> index_key;
+  index_key.SetNormalizedFromKey(Tuple({Value(TypeId::BIGINT, key)}, key_schema), key_schema);
+  return index_key;
+}
+
+// the keys of the entries of a range, in scan order
+std::vector<int64_t> ScanKeys(TestArtTree *tree, const Schema *key_schema, const GenericKey<16> *low_key = nullptr,
+                              const GenericKey<16> *high_key = nullptr) {
+  std::vector<std::pair<GenericKey<16>, RID>> entries;
+  tree->Scan(low_key, high_key, &entries);
+  std::vector<int64_t> keys;
+  for (const auto &entry : entries) {
+    keys.push_back(entry.first.ToNormalizedValue(key_schema, 0).GetAs<int64_t>());
+  }
+  return keys;
+}
+
+}  // namespace
+
+TEST(ArtTreeTests, InsertTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<16> comparator(key_schema, true);
+  {
+    TestArtTree tree("foo_pk", comparator);
+    // negative keys and keys of every magnitude, so that nodes of every size and prefixes of every length are made
+    std::vector<int64_t> keys;
+    for (int64_t key = -300; key <= 300; key++) {
+      keys.push_back(key);
+    }
+    std::mt19937_64 random(7);
+    for (int i = 0; i < 2000; i++) {
+      keys.push_back(static_cast<int64_t>(random() >> (i % 64)));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    std::vector<int64_t> shuffled(keys);
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(7));
+    for (auto key : shuffled) {
+      EXPECT_TRUE(tree.Insert(NormalizedKey(key, key_schema), KeyRid(key)));
+    }
+
+    std::vector<RID> rids;
+    for (auto key : keys) {
+      rids.clear();
+      EXPECT_TRUE(tree.GetValue(NormalizedKey(key, key_schema), &rids));
+      ASSERT_EQ(rids.size(), 1);
+      EXPECT_EQ(rids[0], KeyRid(key));
+      // a unique tree rejects a second value of a key
+      EXPECT_FALSE(tree.Insert(NormalizedKey(key, key_schema), KeyRid(key + 1)));
+    }
+    rids.clear();
+    EXPECT_FALSE(tree.GetValue(NormalizedKey(301, key_schema), &rids));
+    EXPECT_EQ(ScanKeys(&tree, key_schema), keys);
+
+    // bounded scans, with bounds that are not keys of the tree too
+    auto low_key = NormalizedKey(-100, key_schema);
+    auto high_key = NormalizedKey(99, key_schema);
+    std::vector<int64_t> range;
+    for (int64_t key = -100; key <= 99; key++) {
+      range.push_back(key);
+    }
+    EXPECT_EQ(ScanKeys(&tree, key_schema, &low_key, &high_key), range);
+    low_key = NormalizedKey(1000, key_schema);
+    high_key = NormalizedKey(INT64_MAX / 2, key_schema);
+    range.clear();
+    std::copy_if(keys.begin(), keys.end(), std::back_inserter(range),
+                 [](int64_t key) { return key >= 1000 && key <= INT64_MAX / 2; });
+    EXPECT_EQ(ScanKeys(&tree, key_schema, &low_key, &high_key), range);
+    range.clear();
+    std::copy_if(keys.begin(), keys.end(), std::back_inserter(range), [](int64_t key) { return key >= 1000; });
+    EXPECT_EQ(ScanKeys(&tree, key_schema, &low_key), range);
+  }
+  delete key_schema;
+}
+
+TEST(ArtTreeTests, NonUniqueTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<16> comparator(key_schema, true);
+  {
+    TestArtTree tree("foo_idx", comparator, false);
+    for (int64_t key = 0; key < 100; key++) {
+      for (int64_t value = 0; value < 3; value++) {
+        EXPECT_TRUE(tree.Insert(NormalizedKey(key, key_schema), KeyRid(100 * key + value)));
+      }
+      // only the pair is a duplicate
+      EXPECT_FALSE(tree.Insert(NormalizedKey(key, key_schema), KeyRid(100 * key)));
+    }
+    std::vector<RID> rids;
+    EXPECT_TRUE(tree.GetValue(NormalizedKey(42, key_schema), &rids));
+    EXPECT_EQ(rids, std::vector<RID>({KeyRid(4200), KeyRid(4201), KeyRid(4202)}));
+
+    tree.Remove(NormalizedKey(42, key_schema), KeyRid(4201));
+    rids.clear();
+    EXPECT_TRUE(tree.GetValue(NormalizedKey(42, key_schema), &rids));
+    EXPECT_EQ(rids, std::vector<RID>({KeyRid(4200), KeyRid(4202)}));
+    tree.Remove(NormalizedKey(42, key_schema));
+    rids.clear();
+    EXPECT_FALSE(tree.GetValue(NormalizedKey(42, key_schema), &rids));
+    EXPECT_EQ(ScanKeys(&tree, key_schema).size(), 3 * 99);
+  }
+  delete key_schema;
+}
+
+TEST(ArtTreeTests, DeleteTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<16> comparator(key_schema, true);
+  {
+    TestArtTree tree("foo_pk", comparator);
+    int64_t scale = 2000;
+    for (int64_t key = 1; key <= scale; key++) {
+      tree.Insert(NormalizedKey(key, key_schema), KeyRid(key));
+    }
+    std::vector<int64_t> remaining;
+    for (int64_t key = 1; key <= scale; key++) {
+      if (key % 3 == 0) {
+        tree.Remove(NormalizedKey(key, key_schema));
+      } else if (key % 3 == 1) {
+        // the value must match
+        tree.Remove(NormalizedKey(key, key_schema), KeyRid(key + 1));
+        remaining.push_back(key);
+      } else {
+        tree.Remove(NormalizedKey(key, key_schema), KeyRid(key));
+      }
+    }
+    EXPECT_EQ(ScanKeys(&tree, key_schema), remaining);
+
+    // the emptied nodes take new keys
+    for (int64_t key = 1; key <= scale; key++) {
+      tree.Insert(NormalizedKey(key, key_schema), KeyRid(key));
+    }
+    EXPECT_EQ(ScanKeys(&tree, key_schema).size(), scale);
+  }
+  delete key_schema;
+}
+
+TEST(ArtTreeTests, ConcurrentTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<16> comparator(key_schema, true);
+  {
+    TestArtTree tree("foo_pk", comparator);
+    int threads = 8;
+    int64_t scale = 20000;
+    std::vector<std::thread> workers;
+    // concurrent inserts
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+        for (int64_t key = t; key < scale; key += threads) {
+          EXPECT_TRUE(tree.Insert(NormalizedKey(key, key_schema), KeyRid(key)));
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    workers.clear();
+    std::vector<int64_t> keys(scale);
+    for (int64_t key = 0; key < scale; key++) {
+      keys[key] = key;
+    }
+    ASSERT_EQ(ScanKeys(&tree, key_schema), keys);
+
+    // concurrent deletes of the odd keys, while readers look up and scan the even ones
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+        std::vector<RID> rids;
+        for (int64_t key = 2 * t; key < scale; key += 2 * threads) {
+          if (t % 2 == 0) {
+            tree.Remove(NormalizedKey(key + 1, key_schema));
+            tree.Remove(NormalizedKey(key + 3, key_schema), KeyRid(key + 3));
+          } else {
+            rids.clear();
+            EXPECT_TRUE(tree.GetValue(NormalizedKey(key, key_schema), &rids));
+            auto low_key = NormalizedKey(key, key_schema);
+            auto high_key = NormalizedKey(key + 4, key_schema);
+            auto range = ScanKeys(&tree, key_schema, &low_key, &high_key);
+            EXPECT_TRUE(std::is_sorted(range.begin(), range.end()));
+            EXPECT_TRUE(std::find(range.begin(), range.end(), key) != range.end());
+          }
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    std::vector<int64_t> remaining;
+    for (int64_t key = 0; key < scale; key += 2) {
+      remaining.push_back(key);
+    }
+    EXPECT_EQ(ScanKeys(&tree, key_schema), remaining);
+  }
+  delete key_schema;
+}
+
+// nanoseconds per point lookup and per short range lookup of 10 keys, against the B+ tree
+TEST(ArtTreeTests, DISABLED_BenchmarkTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<16> comparator(key_schema, true);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4096, disk_manager);
+  // the header page of the B+ tree
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  const int64_t preload = 1000000;
+  const int64_t operations = 1000000;
+  {
+    BPlusTree<GenericKey<16>, RID, GenericComparator<16>> b_plus_tree("bench", bpm, comparator);
+    TestArtTree art_tree("bench", comparator);
+    for (int64_t key = 0; key < preload; key++) {
+      auto index_key = NormalizedKey(key, key_schema);
+      b_plus_tree.Insert(index_key, KeyRid(key));
+      art_tree.Insert(index_key, KeyRid(key));
+    }
+    std::vector<GenericKey<16>> lookups;
+    std::mt19937_64 random(7);
+    for (int64_t i = 0; i < operations; i++) {
+      lookups.push_back(NormalizedKey(random() % preload, key_schema));
+    }
+    auto time = [&](const std::function<void(const GenericKey<16> &)> &operation) {
+      auto start = std::chrono::steady_clock::now();
+      for (const auto &key : lookups) {
+        operation(key);
+      }
+      std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+      return elapsed.count() / operations;
+    };
+
+    std::vector<RID> rids;
+    double b_plus_tree_point = time([&](const GenericKey<16> &key) {
+      rids.clear();
+      b_plus_tree.GetValue(key, &rids);
+    });
+    double art_point = time([&](const GenericKey<16> &key) {
+      rids.clear();
+      art_tree.GetValue(key, &rids);
+    });
+    double b_plus_tree_range = time([&](const GenericKey<16> &key) {
+      int count = 0;
+      for (auto it = b_plus_tree.Begin(key); !it.isEnd() && count < 10; ++it) {
+        count++;
+      }
+    });
+    std::vector<std::pair<GenericKey<16>, RID>> entries;
+    double art_range = time([&](const GenericKey<16> &key) {
+      entries.clear();
+      auto high_key = NormalizedKey(key.ToNormalizedValue(key_schema, 0).GetAs<int64_t>() + 9, key_schema);
+      art_tree.Scan(&key, &high_key, &entries);
+    });
+    std::cout << "lookup, b+ tree ns, art ns" << std::endl;
+    std::cout << "point, " << b_plus_tree_point << ", " << art_point << std::endl;
+    std::cout << "range of 10, " << b_plus_tree_range << ", " << art_range << std::endl;
+  }
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
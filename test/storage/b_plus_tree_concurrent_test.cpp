@@ -5,7 +5,11 @@
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
+#include <random>
+#include <string>
 #include <thread>                   // NOLINT
+#include <utility>
+#include <vector>
 #include "b_plus_tree_test_util.h"  // NOLINT
 
 #include "buffer/buffer_pool_manager.h"
@@ -92,6 +96,55 @@ void DeleteHelperSplit(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree
   delete transaction;
 }
 
+// helper function to check the links of a tree: the pages of each level, in the order their parents list them, are
+// linked by their right-links in that order, and the high key of each page is the separator of the page after it
+void CheckTreeStructure(BufferPoolManager *bpm, const std::string &name, const GenericComparator<8> &comparator) {
+  using InternalPage = BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>>;
+  using LeafPage = BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
+  page_id_t root_page_id;
+  auto header_page = reinterpret_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  ASSERT_TRUE(header_page->GetRootId(name, &root_page_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  if (INVALID_PAGE_ID == root_page_id) {
+    return;
+  }
+  // the pages of a level, each with whether it has a high key and the high key its parent separates it with
+  std::vector<std::pair<page_id_t, std::pair<bool, GenericKey<8>>>> level{{root_page_id, {false, GenericKey<8>()}}};
+  while (!level.empty()) {
+    std::vector<std::pair<page_id_t, std::pair<bool, GenericKey<8>>>> children;
+    for (size_t i = 0; i < level.size(); i++) {
+      auto page = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(level[i].first)->GetData());
+      page_id_t next_page_id = i + 1 < level.size() ? level[i + 1].first : INVALID_PAGE_ID;
+      EXPECT_EQ(page->GetNextPageId(), next_page_id) << "page " << level[i].first;
+      const auto &high_key = level[i].second;
+      EXPECT_LE(page->GetSize(), page->GetMaxSize()) << "page " << level[i].first;
+      if (page->IsLeafPage()) {
+        auto leaf = reinterpret_cast<LeafPage *>(page);
+        EXPECT_EQ(leaf->HasHighKey(), high_key.first) << "leaf " << level[i].first;
+        if (leaf->HasHighKey() && high_key.first) {
+          EXPECT_EQ(comparator(leaf->GetHighKey(), high_key.second), 0) << "leaf " << level[i].first;
+        }
+        for (int j = 0; j < leaf->GetSize(); j++) {
+          EXPECT_TRUE(j == 0 || comparator(leaf->KeyAt(j - 1), leaf->KeyAt(j)) < 0) << "leaf " << level[i].first;
+          EXPECT_TRUE(!high_key.first || comparator(leaf->KeyAt(j), high_key.second) < 0) << "leaf " << level[i].first;
+        }
+      } else {
+        auto internal = reinterpret_cast<InternalPage *>(page);
+        EXPECT_EQ(internal->HasHighKey(), high_key.first) << "page " << level[i].first;
+        if (internal->HasHighKey() && high_key.first) {
+          EXPECT_EQ(comparator(internal->GetHighKey(), high_key.second), 0) << "page " << level[i].first;
+        }
+        for (int j = 0; j < internal->GetSize(); j++) {
+          auto child_high_key = j + 1 < internal->GetSize() ? std::make_pair(true, internal->KeyAt(j + 1)) : high_key;
+          children.emplace_back(internal->ValueAt(j), child_high_key);
+        }
+      }
+      bpm->UnpinPage(level[i].first, false);
+    }
+    level = std::move(children);
+  }
+}
+
 TEST(BPlusTreeConcurrentTest, InsertTest1) {
   // create KeyComparator and index schema
   Schema *key_schema = ParseCreateStatement("a bigint");
@@ -330,4 +383,403 @@ TEST(BPlusTreeConcurrentTest, MixTest) {
   remove("test.log");
 }
 
+TEST(BPlusTreeConcurrentTest, OptimisticLatchTest) {
+  // small pages, so that many inserts and deletes must restart with the whole path write-latched
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 8, 8);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  std::vector<int64_t> keys;
+  int64_t scale_factor = 4000;
+  for (int64_t key = 1; key <= scale_factor; key++) {
+    keys.push_back(key * 7919 % scale_factor + 1);
+  }
+  const int num_threads = 4;
+  LaunchParallelTest(num_threads, InsertHelperSplit, &tree, keys, num_threads);
+
+  // every tree page is unpinned again, so that all frames but the one of the header page can be reused
+  std::vector<page_id_t> new_pages(bpm->GetPoolSize() - 1);
+  for (auto &new_page_id : new_pages) {
+    ASSERT_NE(bpm->NewPage(&new_page_id), nullptr);
+  }
+  for (auto new_page_id : new_pages) {
+    bpm->UnpinPage(new_page_id, false);
+    bpm->DeletePage(new_page_id);
+  }
+
+  // remove the odd keys while looking up the even ones
+  std::vector<int64_t> remove_keys;
+  for (auto key : keys) {
+    if (key % 2 == 1) {
+      remove_keys.push_back(key);
+    }
+  }
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(DeleteHelperSplit, &tree, remove_keys, num_threads, i);
+  }
+  threads.emplace_back([&tree, scale_factor] {
+    GenericKey<8> index_key;
+    std::vector<RID> rids;
+    for (int64_t key = 2; key <= scale_factor; key += 2) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(tree.GetValue(index_key, &rids));
+      ASSERT_EQ(rids.size(), 1);
+      EXPECT_EQ(rids[0].GetSlotNum(), key);
+    }
+  });
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  int64_t current_key = 2;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key = current_key + 2;
+  }
+  EXPECT_EQ(current_key, scale_factor + 2);
+
+  // removing the even keys too shrinks the tree back to nothing
+  LaunchParallelTest(num_threads, DeleteHelperSplit, &tree, keys, num_threads);
+  EXPECT_TRUE(tree.IsEmpty());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, BLinkScanTest) {
+  // small pages, so that scans and lookups keep running into splits that are not posted to the parent yet
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 4);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // every fourth key is there from the start, the others are inserted while they are scanned
+  int64_t scale_factor = 4000;
+  std::vector<int64_t> initial_keys;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale_factor; key++) {
+    int64_t shuffled = key * 7919 % scale_factor + 1;
+    (shuffled % 4 == 0 ? initial_keys : keys).push_back(shuffled);
+  }
+  InsertHelper(&tree, initial_keys);
+
+  const int num_threads = 4;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(InsertHelperSplit, &tree, keys, num_threads, i);
+  }
+  for (int i = 0; i < 2; i++) {
+    threads.emplace_back([&tree, scale_factor] {
+      for (int round = 0; round < 5; round++) {
+        int64_t previous = 0;
+        int64_t initial_seen = 0;
+        for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+          int64_t key = (*iterator).second.GetSlotNum();
+          EXPECT_LT(previous, key);
+          previous = key;
+          initial_seen += key % 4 == 0 ? 1 : 0;
+        }
+        EXPECT_EQ(initial_seen, scale_factor / 4);
+
+        GenericKey<8> index_key;
+        std::vector<RID> rids;
+        for (int64_t key = 4; key <= scale_factor; key += 4) {
+          rids.clear();
+          index_key.SetFromInteger(key);
+          EXPECT_TRUE(tree.GetValue(index_key, &rids));
+          ASSERT_EQ(rids.size(), 1);
+          EXPECT_EQ(rids[0].GetSlotNum(), key);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  int64_t current_key = 1;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key = current_key + 1;
+  }
+  EXPECT_EQ(current_key, scale_factor + 1);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeConcurrentTest, ReverseScanTest) {
+  // small pages, so that reverse scans keep running into prev-links of leaves that split or merged meanwhile
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 4);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // every fourth key stays, the others are inserted and removed again while they are scanned
+  int64_t scale_factor = 4000;
+  std::vector<int64_t> initial_keys;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale_factor; key++) {
+    int64_t shuffled = key * 7919 % scale_factor + 1;
+    (shuffled % 4 == 0 ? initial_keys : keys).push_back(shuffled);
+  }
+  InsertHelper(&tree, initial_keys);
+
+  const int num_threads = 4;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&tree, &keys, i] {
+      InsertHelperSplit(&tree, keys, num_threads, i);
+      DeleteHelperSplit(&tree, keys, num_threads, i);
+    });
+  }
+  for (int i = 0; i < 2; i++) {
+    threads.emplace_back([&tree, scale_factor] {
+      for (int round = 0; round < 10; round++) {
+        // the whole tree, and the keys in (1000, 3000]
+        GenericKey<8> low_key;
+        GenericKey<8> high_key;
+        low_key.SetFromInteger(1000);
+        high_key.SetFromInteger(3000);
+        bool bounded = round % 2 == 1;
+        int64_t previous = scale_factor + 1;
+        int64_t initial_seen = 0;
+        auto iterator = bounded ? tree.Begin(&low_key, false, &high_key, true, true)
+                                : tree.Begin(nullptr, true, nullptr, true, true);
+        for (; iterator != tree.end(); ++iterator) {
+          int64_t key = (*iterator).second.GetSlotNum();
+          EXPECT_GT(previous, key);
+          previous = key;
+          initial_seen += key % 4 == 0 ? 1 : 0;
+        }
+        EXPECT_EQ(initial_seen, bounded ? 500 : scale_factor / 4);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  int64_t current_key = scale_factor;
+  for (auto iterator = tree.Begin(nullptr, true, nullptr, true, true); iterator != tree.end(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key -= 4;
+  }
+  EXPECT_EQ(current_key, 0);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, AppendTest) {
+  // increasing keys go straight into the rightmost leaf, and the leaves they split off stay full
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 8, 8);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  int64_t scale_factor = 4000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale_factor / 2; key++) {
+    keys.push_back(key);
+  }
+  InsertHelper(&tree, keys);
+  GenericKey<8> index_key;
+  index_key.SetFromInteger(1);
+  std::deque<Page *> lock_page_que;
+  Page *page = tree.FindLeafPage(index_key, true, Operation::READ, nullptr, &lock_page_que);
+  page->RUnlatch();
+  int leaves = 0;
+  int entries = 0;
+  while (true) {
+    auto leaf = reinterpret_cast<BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>> *>(page->GetData());
+    leaves++;
+    entries += leaf->GetSize();
+    page_id_t next_page_id = leaf->GetNextPageId();
+    bpm->UnpinPage(page->GetPageId(), false);
+    if (INVALID_PAGE_ID == next_page_id) {
+      break;
+    }
+    EXPECT_EQ(leaf->GetSize(), 8);
+    page = bpm->FetchPage(next_page_id);
+  }
+  EXPECT_EQ(entries, scale_factor / 2);
+  EXPECT_EQ(leaves, scale_factor / 2 / 8);
+
+  // concurrent appends, while the first keys are removed
+  keys.clear();
+  std::vector<int64_t> remove_keys;
+  for (int64_t key = 1; key <= scale_factor / 2; key++) {
+    keys.push_back(scale_factor / 2 + key);
+    if (key <= scale_factor / 4) {
+      remove_keys.push_back(key);
+    }
+  }
+  const int num_threads = 4;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(InsertHelperSplit, &tree, keys, num_threads, i);
+  }
+  threads.emplace_back(DeleteHelper, &tree, remove_keys, 0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  int64_t current_key = scale_factor / 4 + 1;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key++;
+  }
+  EXPECT_EQ(current_key, scale_factor + 1);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, MultiTreeTest) {
+  // each tree has its own root latch, the roots of trees used by the same threads keep changing independently
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> first_tree("foo_pk", bpm, comparator, 3, 3);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> second_tree("bar_pk", bpm, comparator, 3, 3);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // both trees grow from and shrink back to nothing, several times
+  std::vector<int64_t> keys;
+  int64_t scale_factor = 1000;
+  for (int64_t key = 1; key <= scale_factor; key++) {
+    keys.push_back(key * 7919 % scale_factor + 1);
+  }
+  const int num_threads = 4;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&, i] {
+      for (int round = 0; round < 3; round++) {
+        InsertHelperSplit(&first_tree, keys, num_threads, i);
+        InsertHelperSplit(&second_tree, keys, num_threads, i);
+        DeleteHelperSplit(&first_tree, keys, num_threads, i);
+        DeleteHelperSplit(&second_tree, keys, num_threads, i);
+      }
+      InsertHelperSplit(&second_tree, keys, num_threads, i);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_TRUE(first_tree.IsEmpty());
+  int64_t current_key = 1;
+  for (auto iterator = second_tree.begin(); iterator != second_tree.end(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key++;
+  }
+  EXPECT_EQ(current_key, scale_factor + 1);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, StructureTest) {
+  // tiny pages, one thread inserting and removing keys at random while another reads them; splits are posted to
+  // their parents while merges and redistributions change the same parents
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t scale_factor = 1000;
+  for (int round = 0; round < 10; round++) {
+    std::thread writer([&tree, round, scale_factor] {
+      std::mt19937 random(round);
+      GenericKey<8> index_key;
+      for (int i = 0; i < 5000; i++) {
+        int64_t key = random() % scale_factor;
+        index_key.SetFromInteger(key);
+        if (random() % 3 != 0) {
+          tree.Insert(index_key, RID(0, key));
+        } else {
+          tree.Remove(index_key);
+        }
+      }
+    });
+    std::thread reader([&tree, round, scale_factor] {
+      std::mt19937 random(round + 100);
+      GenericKey<8> index_key;
+      std::vector<RID> rids;
+      for (int i = 0; i < 5000; i++) {
+        int64_t key = random() % scale_factor;
+        rids.clear();
+        index_key.SetFromInteger(key);
+        if (tree.GetValue(index_key, &rids)) {
+          EXPECT_EQ(rids[0].GetSlotNum(), key);
+        }
+      }
+    });
+    writer.join();
+    reader.join();
+    CheckTreeStructure(bpm, "foo_pk", comparator);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
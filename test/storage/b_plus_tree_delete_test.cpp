@@ -3,7 +3,12 @@
  */
 
 #include <algorithm>
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <random>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
 
 #include "b_plus_tree_test_util.h"  // NOLINT
 #include "buffer/buffer_pool_manager.h"
@@ -170,4 +175,273 @@ TEST(BPlusTreeTests, DISABLED_DeleteTest2) {
   remove("test.db");
   remove("test.log");
 }
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, CompactTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 16, 16);
+  GenericKey<8> index_key;
+
+  // random inserts scatter the leaves over the file, and removing four keys of five leaves them sparse
+  const int64_t scale = 5000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(45));
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key));
+  }
+  for (auto key : keys) {
+    if (key % 5 != 0) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key);
+    }
+  }
+  auto before = tree.CollectStats();
+
+  // an iterator in the middle of the leaves when they are rewritten continues from the new leaves
+  index_key.SetFromInteger(scale / 2);
+  auto iterator = tree.Begin(index_key);
+  EXPECT_EQ((*iterator).first.ToString(), scale / 2);
+  int freed = tree.Compact();
+  EXPECT_GT(freed, 0);
+  int64_t expected = scale / 2;
+  for (; iterator != tree.end(); ++iterator) {
+    ASSERT_EQ((*iterator).first.ToString(), expected);
+    expected += 5;
+  }
+  EXPECT_EQ(expected, scale + 5);
+
+  auto after = tree.CollectStats();
+  EXPECT_EQ(after.levels_.back().entry_count_, scale / 5);
+  EXPECT_EQ(after.levels_.back().page_count_, before.levels_.back().page_count_ - freed);
+  EXPECT_GT(after.levels_.back().fill_factor_, before.levels_.back().fill_factor_);
+  EXPECT_EQ(after.out_of_order_leaf_links_, 0);
+  EXPECT_LT(after.out_of_order_leaf_links_, before.out_of_order_leaf_links_);
+  // the leaves are in page order now, windows that shifted may still merge a few leaves until there is nothing to do
+  int rounds = 0;
+  while (tree.Compact() > 0) {
+    ASSERT_LT(++rounds, 5);
+  }
+
+  // compaction runs alongside inserts and removes, and a reverse scan
+  std::thread writer([&] {
+    GenericKey<8> key;
+    for (int64_t k = 1; k <= scale; k++) {
+      key.SetFromInteger(k);
+      if (k % 5 != 0) {
+        tree.Insert(key, RID(0, k));
+      } else if (k % 10 == 0) {
+        tree.Remove(key);
+      }
+    }
+  });
+  std::thread scanner([&] {
+    for (int i = 0; i < 5; i++) {
+      int64_t last = scale + 1;
+      for (auto it = tree.Begin(nullptr, false, nullptr, false, true); it != tree.end(); ++it) {
+        EXPECT_LT((*it).first.ToString(), last);
+        last = (*it).first.ToString();
+      }
+    }
+  });
+  for (int i = 0; i < 20; i++) {
+    tree.Compact(0.5 + i % 5 * 0.1);
+  }
+  writer.join();
+  scanner.join();
+  tree.Compact();
+
+  std::vector<RID> rids;
+  expected = 1;
+  for (auto it = tree.begin(); it != tree.end(); ++it) {
+    if (expected % 10 == 0) {
+      expected++;
+    }
+    ASSERT_EQ((*it).first.ToString(), expected);
+    expected++;
+  }
+  EXPECT_EQ(expected, scale);
+  for (int64_t key = 1; key <= scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(tree.GetValue(index_key, &rids), key % 10 != 0);
+  }
+  EXPECT_EQ(tree.CollectStats().out_of_order_leaf_links_, 0);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, CompactFullTreeTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+  GenericKey<8> index_key;
+
+  // random inserts leave the leaves out of page order and fuller than half, relocating them at a fill factor of one
+  // half would take more leaves than they are now, which their parents have no room for
+  const int64_t scale = 2000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key));
+  }
+  auto before = tree.CollectStats();
+  EXPECT_GT(before.out_of_order_leaf_links_, 0);
+  int freed = tree.Compact(0.5);
+  EXPECT_GE(freed, 0);
+  auto after = tree.CollectStats();
+  EXPECT_EQ(after.levels_.back().entry_count_, scale);
+  EXPECT_EQ(after.levels_.back().page_count_, before.levels_.back().page_count_ - freed);
+
+  // no page grew beyond its max size
+  page_id_t root_page_id;
+  auto header_page = reinterpret_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  ASSERT_TRUE(header_page->GetRootId("foo_pk", &root_page_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  std::vector<page_id_t> level = {root_page_id};
+  while (!level.empty()) {
+    std::vector<page_id_t> next_level;
+    for (auto level_page_id : level) {
+      auto node = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(level_page_id)->GetData());
+      EXPECT_LE(node->GetSize(), node->GetMaxSize());
+      if (!node->IsLeafPage()) {
+        auto internal = reinterpret_cast<BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>> *>(node);
+        for (int i = 0; i < internal->GetSize(); i++) {
+          next_level.push_back(internal->ValueAt(i));
+        }
+      }
+      bpm->UnpinPage(level_page_id, false);
+    }
+    level = std::move(next_level);
+  }
+
+  std::vector<RID> rids;
+  for (int64_t key = 1; key <= scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+  }
+  int64_t expected = 1;
+  for (auto it = tree.begin(); it != tree.end(); ++it) {
+    ASSERT_EQ((*it).first.ToString(), expected);
+    expected++;
+  }
+  EXPECT_EQ(expected, scale + 1);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, LazyMergeTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  GenericKey<8> index_key;
+  const int64_t scale = 2000;
+  auto leaf_count = [](BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree) {
+    return tree->CollectStats().levels_.back().page_count_;
+  };
+
+  // the same removes merge leaves right away, or leave them a quarter full
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> eager("eager_pk", bpm, comparator, 16, 16);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> lazy("lazy_pk", bpm, comparator, 16, 16);
+  lazy.SetMergeThreshold(0.0);
+  for (auto tree : {&eager, &lazy}) {
+    for (int64_t key = 1; key <= scale; key++) {
+      index_key.SetFromInteger(key);
+      tree->Insert(index_key, RID(0, key));
+    }
+  }
+  int64_t leaves = leaf_count(&lazy);
+  for (auto tree : {&eager, &lazy}) {
+    for (int64_t key = 1; key <= scale; key++) {
+      if (key % 4 != 0) {
+        index_key.SetFromInteger(key);
+        tree->Remove(index_key);
+      }
+    }
+  }
+  EXPECT_LT(leaf_count(&eager), leaves);
+  EXPECT_EQ(leaf_count(&lazy), leaves);
+
+  // inserting the keys back fills the leaves up again, without a split
+  for (int round = 0; round < 3; round++) {
+    for (int64_t key = 1; key <= scale; key++) {
+      if (key % 4 != 0) {
+        index_key.SetFromInteger(key);
+        EXPECT_TRUE(lazy.Insert(index_key, RID(0, key)));
+      }
+    }
+    EXPECT_EQ(leaf_count(&lazy), leaves);
+    for (int64_t key = 1; key <= scale; key++) {
+      if (key % 4 != 0) {
+        index_key.SetFromInteger(key);
+        lazy.Remove(index_key);
+      }
+    }
+    EXPECT_EQ(leaf_count(&lazy), leaves);
+  }
+
+  // the background cleanup merges the sparse leaves
+  lazy.StartBackgroundCleanup(std::chrono::milliseconds(10));
+  for (int i = 0; i < 200 && leaf_count(&lazy) == leaves; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  lazy.StopBackgroundCleanup();
+  EXPECT_LT(leaf_count(&lazy), leaves / 2);
+  // stopping wakes the cleanup up instead of waiting out its interval
+  lazy.StartBackgroundCleanup(std::chrono::hours(1));
+  auto start = std::chrono::steady_clock::now();
+  lazy.StopBackgroundCleanup();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::minutes(1));
+  int64_t expected = 4;
+  for (auto iterator = lazy.begin(); iterator != lazy.end(); ++iterator) {
+    ASSERT_EQ((*iterator).first.ToString(), expected);
+    expected += 4;
+  }
+  EXPECT_EQ(expected, scale + 4);
+
+  // a lazy tree emptied key by key merges its leaves once they are empty
+  for (int64_t key = 4; key <= scale; key += 4) {
+    index_key.SetFromInteger(key);
+    lazy.Remove(index_key);
+  }
+  EXPECT_TRUE(lazy.IsEmpty());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
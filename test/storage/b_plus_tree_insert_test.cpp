@@ -4,11 +4,19 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
 
 #include "b_plus_tree_test_util.h"  // NOLINT
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
 #include "storage/index/b_plus_tree.h"
+#include "storage/page/b_plus_tree_posting_page.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -139,4 +147,767 @@ TEST(BPlusTreeTests, DISABLED_InsertTest2) {
   remove("test.db");
   remove("test.log");
 }
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, DeepTreeTest) {
+  // with small fanouts splits reach up to the root, and each new page must be adopted by the parent page it ends up
+  // in, also when that parent splits and keeps the new page in its left half
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 5);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+
+  const int64_t scale = 1000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  GenericKey<8> index_key;
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.Insert(index_key, RID(0, key)));
+  }
+
+  page_id_t root_page_id;
+  auto header_page = reinterpret_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  ASSERT_TRUE(header_page->GetRootId("foo_pk", &root_page_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  std::vector<std::pair<page_id_t, page_id_t>> level = {{root_page_id, INVALID_PAGE_ID}};
+  int depth = 0;
+  while (!level.empty()) {
+    std::vector<std::pair<page_id_t, page_id_t>> next_level;
+    for (const auto &entry : level) {
+      auto node = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(entry.first)->GetData());
+      EXPECT_EQ(node->GetParentPageId(), entry.second);
+      if (!node->IsLeafPage()) {
+        auto internal = reinterpret_cast<BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>> *>(node);
+        for (int i = 0; i < internal->GetSize(); i++) {
+          next_level.emplace_back(internal->ValueAt(i), entry.first);
+        }
+      }
+      bpm->UnpinPage(entry.first, false);
+    }
+    level = std::move(next_level);
+    depth++;
+  }
+  EXPECT_GT(depth, 3);
+
+  std::vector<RID> rids;
+  for (int64_t key = 1; key <= scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+  }
+  int64_t expected = 1;
+  for (auto it = tree.begin(); it != tree.end(); ++it) {
+    ASSERT_EQ((*it).first.ToString(), expected);
+    expected++;
+  }
+  EXPECT_EQ(expected, scale + 1);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, IntKeyInsertTest) {
+  // IntKey pages store keys apart from values and search them with SIMD compares
+  using KeyType = IntKey<8>;
+  using ValueType = RID;
+  for (int max_size : {4, static_cast<int>(LEAF_PAGE_SIZE)}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+    IntKeyComparator<8> comparator;
+    BPlusTree<IntKey<8>, RID, IntKeyComparator<8>> tree("foo_pk", bpm, comparator, max_size, max_size + 1);
+    Transaction *transaction = new Transaction(0);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+
+    std::vector<int64_t> keys;
+    for (int64_t key = -300; key < 300; key++) {
+      keys.push_back(key * 1000000007L);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+    IntKey<8> index_key;
+    for (auto key : keys) {
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(tree.Insert(index_key, RID(0, static_cast<uint32_t>(key / 1000000007L + 300)), transaction));
+    }
+    index_key.SetFromInteger(keys[0]);
+    EXPECT_FALSE(tree.Insert(index_key, RID(), transaction));
+
+    std::vector<RID> rids;
+    for (auto key : keys) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      tree.GetValue(index_key, &rids);
+      ASSERT_EQ(rids.size(), 1);
+      EXPECT_EQ(rids[0].GetSlotNum(), key / 1000000007L + 300);
+    }
+    rids.clear();
+    index_key.SetFromInteger(1);
+    EXPECT_FALSE(tree.GetValue(index_key, &rids));
+
+    uint32_t slot = 0;
+    for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+      EXPECT_EQ((*iterator).second.GetSlotNum(), slot++);
+    }
+    EXPECT_EQ(slot, keys.size());
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete transaction;
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+TEST(BPlusTreeTests, BulkLoadTest) {
+  // the tree is built bottom-up from sorted keys, and then takes inserts and removes like any other tree
+  using KeyType = IntKey<8>;
+  using ValueType = RID;
+  for (int max_size : {4, static_cast<int>(LEAF_PAGE_SIZE)}) {
+    for (double fill_factor : {1.0, 0.7}) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+      IntKeyComparator<8> comparator;
+      BPlusTree<IntKey<8>, RID, IntKeyComparator<8>> tree("foo_pk", bpm, comparator, max_size, max_size + 1);
+      Transaction *transaction = new Transaction(0);
+      page_id_t page_id;
+      bpm->NewPage(&page_id);
+
+      // the even keys 0, 2, ..., 1998, each twice: only the first of equal keys is kept
+      int64_t next = 0;
+      auto stream = [&next](std::pair<IntKey<8>, RID> *item) {
+        if (next == 2000) {
+          return false;
+        }
+        int64_t key = next / 2 * 2;
+        item->first.SetFromInteger(key);
+        item->second = RID(static_cast<page_id_t>(next % 2), static_cast<uint32_t>(key));
+        next++;
+        return true;
+      };
+      EXPECT_TRUE(tree.BulkLoad(stream, fill_factor, transaction));
+      next = 0;
+      EXPECT_FALSE(tree.BulkLoad(stream, fill_factor, transaction));
+
+      int64_t expected = 0;
+      for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+        EXPECT_EQ((*iterator).first.GetValue(), expected);
+        EXPECT_EQ((*iterator).second.GetPageId(), 0);
+        expected += 2;
+      }
+      EXPECT_EQ(expected, 2000);
+
+      IntKey<8> index_key;
+      std::vector<RID> rids;
+      for (int64_t key = 1; key < 2000; key += 2) {
+        index_key.SetFromInteger(key);
+        EXPECT_TRUE(tree.Insert(index_key, RID(0, static_cast<uint32_t>(key)), transaction));
+      }
+      for (int64_t key = 0; key < 2000; key += 3) {
+        index_key.SetFromInteger(key);
+        tree.Remove(index_key, transaction);
+      }
+      for (int64_t key = 0; key < 2000; key++) {
+        rids.clear();
+        index_key.SetFromInteger(key);
+        EXPECT_EQ(tree.GetValue(index_key, &rids), key % 3 != 0);
+      }
+      int64_t count = 0;
+      for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+        EXPECT_NE((*iterator).first.GetValue() % 3, 0);
+        count++;
+      }
+      EXPECT_EQ(count, 2000 - 667);
+
+      bpm->UnpinPage(HEADER_PAGE_ID, true);
+      delete transaction;
+      delete bpm;
+      delete disk_manager;
+      remove("test.db");
+      remove("test.log");
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, DuplicateKeyTest) {
+  // a non-unique tree keeps the RIDs of a key in a posting list, which spans several pages for the largest keys
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+  IntKeyComparator<8> comparator;
+  BPlusTree<IntKey<8>, RID, IntKeyComparator<8>> tree("foo_idx", bpm, comparator, 4, 5, false);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+
+  auto rid_count = [](int64_t key) { return key % 4 == 0 ? 1500 : static_cast<int>(key % 4); };
+  auto make_rid = [](int j) { return RID(static_cast<page_id_t>(j % 37), static_cast<uint32_t>(j)); };
+  std::vector<std::pair<int64_t, int>> entries;
+  for (int64_t key = 0; key < 50; key++) {
+    for (int j = 0; j < rid_count(key); j++) {
+      entries.emplace_back(key, j);
+    }
+  }
+  std::shuffle(entries.begin(), entries.end(), std::mt19937(37));
+  IntKey<8> index_key;
+  for (const auto &entry : entries) {
+    index_key.SetFromInteger(entry.first);
+    EXPECT_TRUE(tree.Insert(index_key, make_rid(entry.second)));
+  }
+  for (int64_t key = 0; key < 50; key++) {
+    index_key.SetFromInteger(key);
+    EXPECT_FALSE(tree.Insert(index_key, make_rid(rid_count(key) - 1)));
+  }
+
+  // all RIDs of a key, in increasing order
+  auto expected_rids = [&](int64_t key, int step) {
+    std::vector<RID> rids;
+    for (int j = 0; j < rid_count(key); j += step) {
+      rids.push_back(make_rid(j));
+    }
+    std::sort(rids.begin(), rids.end(), [](const RID &lhs, const RID &rhs) { return lhs.Get() < rhs.Get(); });
+    return rids;
+  };
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < 50; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+    EXPECT_EQ(rids, expected_rids(key, 1));
+  }
+  size_t count = 0;
+  int64_t previous_key = -1;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+    if ((*iterator).first.GetValue() != previous_key) {
+      previous_key = (*iterator).first.GetValue();
+      rids = expected_rids(previous_key, 1);
+      count += rids.size();
+      std::reverse(rids.begin(), rids.end());
+    }
+    ASSERT_FALSE(rids.empty());
+    EXPECT_EQ((*iterator).second, rids.back());
+    rids.pop_back();
+  }
+  EXPECT_EQ(count, entries.size());
+
+  // remove the odd RIDs one by one, which drops the keys with a single one left, then every 8th key with all of its
+  for (const auto &entry : entries) {
+    if (entry.second % 2 == 1) {
+      index_key.SetFromInteger(entry.first);
+      tree.Remove(index_key, make_rid(entry.second));
+    }
+  }
+  for (int64_t key = 0; key < 50; key += 8) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key);
+  }
+  for (int64_t key = 0; key < 50; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(tree.GetValue(index_key, &rids), key % 8 != 0);
+    if (key % 8 != 0) {
+      EXPECT_EQ(rids, expected_rids(key, 2));
+    }
+  }
+
+  // bulk loading builds the same posting lists
+  BPlusTree<IntKey<8>, RID, IntKeyComparator<8>> loaded("bar_idx", bpm, comparator, 4, 5, false);
+  std::sort(entries.begin(), entries.end());
+  size_t next = 0;
+  EXPECT_TRUE(loaded.BulkLoad([&](std::pair<IntKey<8>, RID> *item) {
+    if (next == entries.size()) {
+      return false;
+    }
+    item->first.SetFromInteger(entries[next].first);
+    item->second = make_rid(entries[next++].second);
+    return true;
+  }));
+  for (int64_t key = 0; key < 50; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(loaded.GetValue(index_key, &rids));
+    EXPECT_EQ(rids, expected_rids(key, 1));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, UniqueReferenceSlotTest) {
+  // a unique tree has no posting lists, and returns a RID with the slot of a posting list reference as is
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  IntKeyComparator<8> comparator;
+  BPlusTree<IntKey<8>, RID, IntKeyComparator<8>> tree("foo_idx", bpm, comparator, 4, 5);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+
+  // the RIDs name the header and tree pages, which are no posting pages
+  IntKey<8> index_key;
+  for (int64_t key = 0; key < 20; key++) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.Insert(index_key, BPlusTreePostingPage::Reference(static_cast<page_id_t>(key))));
+  }
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < 20; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+    EXPECT_EQ(rids, std::vector<RID>{BPlusTreePostingPage::Reference(static_cast<page_id_t>(key))});
+  }
+  int64_t expected_key = 0;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+    EXPECT_EQ((*iterator).first.GetValue(), expected_key);
+    EXPECT_EQ((*iterator).second, BPlusTreePostingPage::Reference(static_cast<page_id_t>(expected_key)));
+    expected_key++;
+  }
+  EXPECT_EQ(expected_key, 20);
+
+  // removing a key or its value leaves the pages the RIDs name alone
+  for (int64_t key = 0; key < 20; key++) {
+    index_key.SetFromInteger(key);
+    if (key % 2 == 0) {
+      tree.Remove(index_key, BPlusTreePostingPage::Reference(static_cast<page_id_t>(key)));
+    } else {
+      tree.Remove(index_key);
+    }
+  }
+  EXPECT_TRUE(tree.IsEmpty());
+  for (int64_t key = 0; key < 20; key++) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.Insert(index_key, RID(0, static_cast<uint32_t>(key))));
+  }
+  for (int64_t key = 0; key < 20; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+    EXPECT_EQ(rids, std::vector<RID>{RID(0, static_cast<uint32_t>(key))});
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, GetValuesTest) {
+  // a batch lookup returns what GetValue() returns for each key, whatever the order of the keys and with repeats
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  IntKeyComparator<8> comparator;
+  BPlusTree<IntKey<8>, RID, IntKeyComparator<8>> tree("foo_idx", bpm, comparator, 4, 5, false);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+
+  IntKey<8> index_key;
+  std::vector<IntKey<8>> keys(3);
+  std::vector<std::vector<RID>> results;
+  tree.GetValues(keys, &results);
+  EXPECT_EQ(results, std::vector<std::vector<RID>>(3));
+
+  // the even keys below 1000, every 10th with a second RID
+  for (int64_t key = 0; key < 1000; key += 2) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(static_cast<page_id_t>(key), 0));
+    if (key % 10 == 0) {
+      tree.Insert(index_key, RID(static_cast<page_id_t>(key), 1));
+    }
+  }
+  std::mt19937 rng(39);
+  for (int batch_size : {1, 10, 100, 2000}) {
+    std::uniform_int_distribution<int64_t> dist(-10, 1010);
+    keys.clear();
+    for (int i = 0; i < batch_size; i++) {
+      index_key.SetFromInteger(dist(rng));
+      keys.push_back(index_key);
+    }
+    tree.GetValues(keys, &results);
+    ASSERT_EQ(results.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      std::vector<RID> rids;
+      EXPECT_EQ(tree.GetValue(keys[i], &rids), !results[i].empty());
+      EXPECT_EQ(results[i], rids);
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, RangeScanTest) {
+  // bounded scans in both directions, over leaves merged by removes
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+  IntKeyComparator<8> comparator;
+  BPlusTree<IntKey<8>, RID, IntKeyComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < 1000; key += 2) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(38));
+  IntKey<8> index_key;
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, static_cast<uint32_t>(key)));
+  }
+  for (int64_t key = 0; key < 1000; key += 6) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key);
+  }
+  std::vector<int64_t> expected_keys;
+  for (int64_t key = 0; key < 1000; key += 2) {
+    if (key % 6 != 0) {
+      expected_keys.push_back(key);
+    }
+  }
+
+  IntKey<8> low_key;
+  IntKey<8> high_key;
+  for (int64_t low : {-1L, 0L, 2L, 3L, 500L, 998L}) {
+    for (int64_t high : {-1L, 2L, 3L, 500L, 502L, 1000L}) {
+      for (int inclusive = 0; inclusive < 4; inclusive++) {
+        bool low_inclusive = inclusive % 2 == 0;
+        bool high_inclusive = inclusive / 2 == 0;
+        low_key.SetFromInteger(low);
+        high_key.SetFromInteger(high);
+        // -1 stands for no bound
+        const IntKey<8> *low_bound = low < 0 ? nullptr : &low_key;
+        const IntKey<8> *high_bound = high < 0 ? nullptr : &high_key;
+        std::vector<int64_t> expected;
+        for (auto key : expected_keys) {
+          if ((low < 0 || key > low || (key == low && low_inclusive)) &&
+              (high < 0 || key < high || (key == high && high_inclusive))) {
+            expected.push_back(key);
+          }
+        }
+        for (bool reverse : {false, true}) {
+          std::vector<int64_t> scanned;
+          for (auto iterator = tree.Begin(low_bound, low_inclusive, high_bound, high_inclusive, reverse);
+               iterator != tree.end(); ++iterator) {
+            scanned.push_back((*iterator).first.GetValue());
+          }
+          if (reverse) {
+            std::reverse(scanned.begin(), scanned.end());
+          }
+          EXPECT_EQ(scanned, expected) << low << (low_inclusive ? " <= " : " < ") << "key"
+                                       << (high_inclusive ? " <= " : " < ") << high << (reverse ? " reverse" : "");
+        }
+      }
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, VarKeyTest) {
+  // VarKey pages store every key in the bytes it has: short keys pack densely and long keys are stored whole
+  using KeyType = VarKey<256>;
+  using ValueType = RID;
+  Schema *key_schema = ParseCreateStatement("a varchar(240)");
+  VarKeyComparator<256> comparator(key_schema);
+  auto make_key = [key_schema](const std::string &str) {
+    KeyType index_key;
+    index_key.SetFromKey(Tuple({ValueFactory::GetVarcharValue(str)}, key_schema));
+    return index_key;
+  };
+  EXPECT_THROW(make_key(std::string(300, 'a')), Exception);
+
+  // mostly short keys, every 10th one long
+  std::mt19937 rng(43);
+  std::set<std::string> unique_keys;
+  while (unique_keys.size() < 2000) {
+    int length = unique_keys.size() % 10 == 0 ? 100 + static_cast<int>(rng() % 140) : 1 + static_cast<int>(rng() % 8);
+    std::string key;
+    for (int i = 0; i < length; i++) {
+      key.push_back(static_cast<char>('a' + rng() % 26));
+    }
+    unique_keys.insert(key);
+  }
+  std::vector<std::string> sorted_keys(unique_keys.begin(), unique_keys.end());
+  std::vector<uint32_t> order(sorted_keys.size());
+  for (uint32_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), rng);
+
+  for (int max_size : {4, static_cast<int>(LEAF_PAGE_SIZE)}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+    BPlusTree<KeyType, ValueType, VarKeyComparator<256>> tree("foo_pk", bpm, comparator, max_size, max_size + 1);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+
+    for (auto i : order) {
+      EXPECT_TRUE(tree.Insert(make_key(sorted_keys[i]), RID(0, i)));
+    }
+    EXPECT_FALSE(tree.Insert(make_key(sorted_keys[0]), RID(0, 0)));
+    uint32_t slot = 0;
+    for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+      ASSERT_EQ(comparator((*iterator).first, make_key(sorted_keys[slot])), 0);
+      EXPECT_EQ((*iterator).second.GetSlotNum(), slot++);
+    }
+    EXPECT_EQ(slot, sorted_keys.size());
+
+    if (max_size == static_cast<int>(LEAF_PAGE_SIZE)) {
+      // a leaf holds far more keys than fit at the size of the longest key
+      std::deque<Page *> latched;
+      Page *page = tree.FindLeafPage(make_key("m"), false, Operation::READ, nullptr, &latched);
+      auto leaf = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, VarKeyComparator<256>> *>(page->GetData());
+      EXPECT_GT(leaf->GetSize(), 2 * (PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / (sizeof(KeyType) + sizeof(ValueType)));
+      page->RUnlatch();
+      bpm->UnpinPage(page->GetPageId(), false);
+    }
+
+    // remove every other key in insert order, merging pages of short and long keys
+    for (size_t i = 0; i < order.size(); i += 2) {
+      tree.Remove(make_key(sorted_keys[order[i]]));
+    }
+    std::vector<RID> rids;
+    for (size_t i = 0; i < order.size(); i++) {
+      rids.clear();
+      EXPECT_EQ(tree.GetValue(make_key(sorted_keys[order[i]]), &rids), i % 2 == 1);
+    }
+    slot = 0;
+    for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+      slot++;
+    }
+    EXPECT_EQ(slot, sorted_keys.size() / 2);
+    for (size_t i = 1; i < order.size(); i += 2) {
+      tree.Remove(make_key(sorted_keys[order[i]]));
+    }
+    EXPECT_TRUE(tree.IsEmpty());
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+  delete key_schema;
+}
+
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeTests, StatsTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  GenericKey<8> index_key;
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+  EXPECT_EQ(tree.CollectStats().height_, 0);
+
+  // decreasing keys split the first leaf over and over, each new leaf to the left of the one before
+  const int64_t scale = 2000;
+  for (int64_t key = scale; key > 0; key--) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key));
+  }
+  auto stats = tree.CollectStats(10);
+  ASSERT_GE(stats.height_, 5);
+  ASSERT_EQ(static_cast<int>(stats.levels_.size()), stats.height_);
+  EXPECT_EQ(stats.levels_[0].page_count_, 1);
+  for (int level = 0; level + 1 < stats.height_; level++) {
+    // every page below the root is the child of one entry of the level above
+    EXPECT_EQ(stats.levels_[level].entry_count_, stats.levels_[level + 1].page_count_);
+  }
+  const auto &leaves = stats.levels_.back();
+  EXPECT_EQ(leaves.entry_count_, scale);
+  EXPECT_GT(leaves.fill_factor_, 0.25);
+  EXPECT_LE(leaves.fill_factor_, 1.0);
+  int64_t page_count = 0;
+  for (const auto &level : stats.levels_) {
+    page_count += level.page_count_;
+  }
+  EXPECT_EQ(stats.PageCount(), page_count);
+  EXPECT_GT(stats.LeafFragmentation(), 0.5);
+
+  // the samples are the first keys of equally spaced leaves, the first one is the smallest key
+  ASSERT_GT(stats.key_samples_.size(), 5);
+  ASSERT_LE(stats.key_samples_.size(), 10);
+  EXPECT_EQ(stats.key_samples_[0].ToString(), 1);
+  for (size_t i = 1; i < stats.key_samples_.size(); i++) {
+    EXPECT_LT(comparator(stats.key_samples_[i - 1], stats.key_samples_[i]), 0);
+  }
+  EXPECT_GE(leaves.page_count_, static_cast<int64_t>(stats.key_samples_.size() - 1) * stats.key_sample_stride_);
+
+  // a bulk loaded tree is full and its leaves are in page order
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> loaded("foo_pk", bpm, comparator, 4, 5);
+  int64_t next_key = 1;
+  loaded.BulkLoad([&](std::pair<GenericKey<8>, RID> *item) {
+    if (next_key > scale) {
+      return false;
+    }
+    item->first.SetFromInteger(next_key);
+    item->second = RID(0, next_key++);
+    return true;
+  });
+  stats = loaded.CollectStats();
+  EXPECT_EQ(stats.levels_.back().entry_count_, scale);
+  EXPECT_DOUBLE_EQ(stats.levels_.back().fill_factor_, 1.0);
+  EXPECT_EQ(stats.out_of_order_leaf_links_, 0);
+
+  // statistics are collected while the tree changes
+  std::thread writer([&] {
+    GenericKey<8> key;
+    for (int64_t k = scale + 1; k <= 3 * scale; k++) {
+      key.SetFromInteger(k);
+      tree.Insert(key, RID(0, k));
+    }
+  });
+  for (int i = 0; i < 20; i++) {
+    stats = tree.CollectStats();
+    EXPECT_GE(stats.levels_.back().entry_count_, scale);
+  }
+  writer.join();
+  EXPECT_EQ(tree.CollectStats().levels_.back().entry_count_, 3 * scale);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, AdaptiveHashTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  GenericKey<8> index_key;
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+  const int64_t scale = 500;
+  for (int64_t key = 1; key <= scale; key += 2) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key));
+  }
+  std::vector<RID> rids;
+  auto lookup = [&](int64_t key) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    bool found = tree.GetValue(index_key, &rids);
+    EXPECT_EQ(found, !rids.empty());
+    return found;
+  };
+
+  // disabled, lookups are not counted
+  EXPECT_FALSE(tree.IsAdaptiveHashIndexEnabled());
+  lookup(1);
+  EXPECT_EQ(tree.GetAdaptiveHashStats().lookups_, 0);
+
+  tree.SetAdaptiveHashIndex(true);
+  // the first hot lookups descend from the root, the later ones hit
+  int64_t lookups = 0;
+  for (int round = 0; round < 10; round++) {
+    for (int64_t key = 1; key <= scale; key += 2) {
+      ASSERT_TRUE(lookup(key));
+      EXPECT_EQ(rids[0], RID(0, key));
+      lookups++;
+    }
+  }
+  auto stats = tree.GetAdaptiveHashStats();
+  EXPECT_EQ(stats.lookups_, lookups);
+  EXPECT_GE(stats.HitRate(), 0.6);
+  EXPECT_LE(stats.HitRate(), 0.8);
+
+  // inserts split the leaves of the hot keys, which invalidates their entries, and move keys within the others
+  for (int64_t key = 2; key <= scale; key += 2) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key));
+  }
+  for (int64_t key = 1; key <= scale; key++) {
+    ASSERT_TRUE(lookup(key));
+    EXPECT_EQ(rids[0], RID(0, key));
+  }
+  // removed keys are not found through the entries of their leaves, and merges invalidate the entries too
+  for (int64_t key = 1; key <= scale; key++) {
+    if (key % 4 != 0) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key);
+    }
+  }
+  for (int round = 0; round < 3; round++) {
+    for (int64_t key = 1; key <= scale; key++) {
+      ASSERT_EQ(lookup(key), key % 4 == 0);
+    }
+  }
+  EXPECT_GT(tree.GetAdaptiveHashStats().hits_, stats.hits_);
+
+  // hot lookups while a writer splits and merges leaves
+  std::thread writer([&] {
+    GenericKey<8> key;
+    for (int round = 0; round < 5; round++) {
+      for (int64_t k = 1; k <= scale; k++) {
+        key.SetFromInteger(k);
+        if (k % 4 != 0 && 0 == round % 2) {
+          tree.Insert(key, RID(0, k));
+        } else if (k % 4 != 0) {
+          tree.Remove(key);
+        }
+      }
+    }
+  });
+  // failures are only counted while the writer runs, it must be joined before the test may return
+  GenericKey<8> key;
+  std::vector<RID> values;
+  int misses = 0;
+  for (int round = 0; round < 20; round++) {
+    for (int64_t k = 4; k <= scale; k += 4) {
+      values.clear();
+      key.SetFromInteger(k);
+      if (!tree.GetValue(key, &values) || !(values[0] == RID(0, k))) {
+        misses++;
+      }
+    }
+  }
+  writer.join();
+  EXPECT_EQ(misses, 0);
+
+  // disabling drops the entries and the statistics
+  tree.SetAdaptiveHashIndex(false);
+  lookup(4);
+  EXPECT_EQ(tree.GetAdaptiveHashStats().lookups_, 0);
+  EXPECT_EQ(tree.GetAdaptiveHashStats().HitRate(), 0);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
@@ -0,0 +1,153 @@
+/**
+ * b_plus_tree_page_search_test.cpp
+ *
+ * Checks the binary search of leaf and internal pages against a linear scan on full pages of every GenericKey size,
+ * and of the SIMD search of IntKey pages. The disabled benchmark reports the cost of searching one page (that is, one
+ * level of the tree) with either.
+ */
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "common/rid.h"
+#include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "storage/index/int_key.h"
+#include "storage/page/b_plus_tree_internal_page.h"
+#include "storage/page/b_plus_tree_leaf_page.h"
+
+namespace bustub {
+
+template <size_t KeySize>
+void SetKey(GenericKey<KeySize> *key, int64_t value) {
+  std::memset(key->data_, 0, KeySize);
+  if (KeySize < sizeof(int64_t)) {
+    auto narrow = static_cast<int32_t>(value);
+    std::memcpy(key->data_, &narrow, sizeof(narrow));
+  } else {
+    std::memcpy(key->data_, &value, sizeof(value));
+  }
+}
+
+template <size_t KeySize>
+void SetKey(IntKey<KeySize> *key, int64_t value) {
+  key->SetFromInteger(value);
+}
+
+template <typename KeyType>
+KeyType MakeKey(int64_t value) {
+  KeyType key;
+  SetKey(&key, value);
+  return key;
+}
+
+template <typename KeyType, typename KeyComparator>
+void SearchFullPages(const char *key_name, size_t key_size, int num_searches, bool report) {
+  using LeafPage = BPlusTreeLeafPage<KeyType, RID, KeyComparator>;
+  using InternalPage = BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>;
+  Schema *key_schema = ParseCreateStatement(key_size < sizeof(int64_t) ? "a integer" : "a bigint");
+  KeyComparator comparator(key_schema);
+
+  // fill both pages with the even keys 0, 2, 4, ...
+  std::vector<char> leaf_data(PAGE_SIZE);
+  auto leaf = reinterpret_cast<LeafPage *>(leaf_data.data());
+  leaf->Init(1);
+  int leaf_size = leaf->GetMaxSize();
+  for (int i = 0; i < leaf_size; i++) {
+    leaf->Insert(MakeKey<KeyType>(2 * i), RID(0, i), comparator);
+  }
+  std::vector<char> internal_data(PAGE_SIZE);
+  auto internal = reinterpret_cast<InternalPage *>(internal_data.data());
+  internal->Init(2);
+  internal->PopulateNewRoot(100, MakeKey<KeyType>(2), 101);
+  int internal_size = internal->GetMaxSize();
+  for (int i = 2; i < internal_size; i++) {
+    internal->InsertNodeAfter(99 + i, MakeKey<KeyType>(2 * i), 100 + i);
+  }
+
+  // probe hits and misses, including keys outside the page
+  std::mt19937 rng(key_size);
+  std::uniform_int_distribution<int64_t> dist(-2, 2 * internal_size + 1);
+  std::vector<KeyType> probes;
+  for (int i = 0; i < num_searches; i++) {
+    probes.push_back(MakeKey<KeyType>(dist(rng)));
+  }
+
+  std::vector<int> linear_leaf;
+  std::vector<page_id_t> linear_internal;
+  auto start = std::chrono::steady_clock::now();
+  for (const auto &probe : probes) {
+    int i = 0;
+    while (i < leaf_size && comparator(leaf->KeyAt(i), probe) < 0) {
+      i++;
+    }
+    linear_leaf.push_back(i);
+  }
+  auto linear_leaf_ns = std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  for (const auto &probe : probes) {
+    int i = 1;
+    while (i < internal_size && comparator(internal->KeyAt(i), probe) <= 0) {
+      i++;
+    }
+    linear_internal.push_back(internal->ValueAt(i - 1));
+  }
+  auto linear_internal_ns = std::chrono::steady_clock::now() - start;
+
+  std::vector<int> binary_leaf;
+  std::vector<page_id_t> binary_internal;
+  start = std::chrono::steady_clock::now();
+  for (const auto &probe : probes) {
+    binary_leaf.push_back(leaf->KeyIndex(probe, comparator));
+  }
+  auto binary_leaf_ns = std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  for (const auto &probe : probes) {
+    binary_internal.push_back(internal->Lookup(probe, comparator));
+  }
+  auto binary_internal_ns = std::chrono::steady_clock::now() - start;
+
+  EXPECT_EQ(linear_leaf, binary_leaf);
+  EXPECT_EQ(linear_internal, binary_internal);
+  RID rid;
+  EXPECT_TRUE(leaf->Lookup(MakeKey<KeyType>(2 * (leaf_size - 1)), &rid, comparator));
+  EXPECT_EQ(rid.GetSlotNum(), leaf_size - 1);
+  EXPECT_FALSE(leaf->Lookup(MakeKey<KeyType>(1), &rid, comparator));
+
+  auto per_search = [num_searches](std::chrono::nanoseconds elapsed) { return elapsed.count() / num_searches; };
+  if (report) {
+    std::printf("%s<%zu>: leaf (%d keys) linear %ld ns, binary %ld ns; internal (%d keys) linear %ld ns, "
+                "binary %ld ns\n",
+                key_name, key_size, leaf_size, per_search(linear_leaf_ns), per_search(binary_leaf_ns), internal_size,
+                per_search(linear_internal_ns), per_search(binary_internal_ns));
+  }
+  delete key_schema;
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreePageSearchTest, FullPageSearchTest) {
+  SearchFullPages<GenericKey<4>, GenericComparator<4>>("GenericKey", 4, 2000, false);
+  SearchFullPages<GenericKey<8>, GenericComparator<8>>("GenericKey", 8, 2000, false);
+  SearchFullPages<GenericKey<16>, GenericComparator<16>>("GenericKey", 16, 2000, false);
+  SearchFullPages<GenericKey<32>, GenericComparator<32>>("GenericKey", 32, 2000, false);
+  SearchFullPages<GenericKey<64>, GenericComparator<64>>("GenericKey", 64, 2000, false);
+  SearchFullPages<IntKey<4>, IntKeyComparator<4>>("IntKey", 4, 2000, false);
+  SearchFullPages<IntKey<8>, IntKeyComparator<8>>("IntKey", 8, 2000, false);
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreePageSearchTest, DISABLED_FullPageSearchBenchmark) {
+  SearchFullPages<GenericKey<4>, GenericComparator<4>>("GenericKey", 4, 20000, true);
+  SearchFullPages<GenericKey<8>, GenericComparator<8>>("GenericKey", 8, 20000, true);
+  SearchFullPages<GenericKey<16>, GenericComparator<16>>("GenericKey", 16, 20000, true);
+  SearchFullPages<GenericKey<32>, GenericComparator<32>>("GenericKey", 32, 20000, true);
+  SearchFullPages<GenericKey<64>, GenericComparator<64>>("GenericKey", 64, 20000, true);
+  SearchFullPages<IntKey<4>, IntKeyComparator<4>>("IntKey", 4, 20000, true);
+  SearchFullPages<IntKey<8>, IntKeyComparator<8>>("IntKey", 8, 20000, true);
+}
+
+}  // namespace bustub
@@ -0,0 +1,162 @@
+/**
+ * b_plus_tree_page_test.cpp
+ *
+ * Checks the entry moves of leaf and internal pages that splits, merges and redistributions are built from.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "common/rid.h"
+#include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "storage/page/b_plus_tree_internal_page.h"
+#include "storage/page/b_plus_tree_leaf_page.h"
+
+namespace bustub {
+
+using LeafPage = BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
+using InternalPage = BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>>;
+
+static GenericKey<8> MakeKey(int64_t value) {
+  GenericKey<8> key;
+  key.SetFromInteger(value);
+  return key;
+}
+
+static std::vector<int64_t> LeafKeys(const LeafPage *leaf) {
+  std::vector<int64_t> keys;
+  for (int i = 0; i < leaf->GetSize(); i++) {
+    keys.push_back(leaf->KeyAt(i).ToString());
+  }
+  return keys;
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreePageTest, LeafRedistributeTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  std::vector<char> left_data(PAGE_SIZE);
+  std::vector<char> right_data(PAGE_SIZE);
+  auto left = reinterpret_cast<LeafPage *>(left_data.data());
+  auto right = reinterpret_cast<LeafPage *>(right_data.data());
+  left->Init(1);
+  right->Init(2);
+  for (int64_t key = 0; key < 5; key++) {
+    left->Insert(MakeKey(key), RID(0, key), comparator);
+    right->Insert(MakeKey(key + 5), RID(0, key + 5), comparator);
+  }
+
+  // the first entry of the right sibling goes to the end of the left one, and back to the front of the right one
+  right->MoveFirstToEndOf(left);
+  EXPECT_EQ(LeafKeys(left), (std::vector<int64_t>{0, 1, 2, 3, 4, 5}));
+  EXPECT_EQ(LeafKeys(right), (std::vector<int64_t>{6, 7, 8, 9}));
+  left->MoveLastToFrontOf(right);
+  EXPECT_EQ(LeafKeys(left), (std::vector<int64_t>{0, 1, 2, 3, 4}));
+  EXPECT_EQ(LeafKeys(right), (std::vector<int64_t>{5, 6, 7, 8, 9}));
+  for (int i = 0; i < right->GetSize(); i++) {
+    EXPECT_EQ(right->GetItem(i).second, RID(0, i + 5));
+  }
+  delete key_schema;
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreePageTest, LeafOverflowTest) {
+  // a full leaf takes one more entry before it is split, which must stay within the page
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  std::vector<char> data(2 * PAGE_SIZE, 0x5a);
+  auto leaf = reinterpret_cast<LeafPage *>(data.data());
+  leaf->Init(1);
+  int max_size = leaf->GetMaxSize();
+  for (int64_t key = max_size; 0 <= key; key--) {
+    leaf->Insert(MakeKey(key), RID(0, key), comparator);
+  }
+  EXPECT_EQ(leaf->GetSize(), max_size + 1);
+  for (int i = 0; i <= max_size; i++) {
+    EXPECT_EQ(leaf->KeyAt(i).ToString(), i);
+  }
+  for (size_t i = PAGE_SIZE; i < data.size(); i++) {
+    ASSERT_EQ(data[i], 0x5a);
+  }
+  delete key_schema;
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreePageTest, InternalRedistributeTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+
+  // a parent with two internal children of 5 grandchildren each, separated by key 50
+  page_id_t parent_id;
+  page_id_t left_id;
+  page_id_t right_id;
+  auto parent = reinterpret_cast<InternalPage *>(bpm->NewPage(&parent_id)->GetData());
+  auto left = reinterpret_cast<InternalPage *>(bpm->NewPage(&left_id)->GetData());
+  auto right = reinterpret_cast<InternalPage *>(bpm->NewPage(&right_id)->GetData());
+  parent->Init(parent_id);
+  left->Init(left_id, parent_id);
+  right->Init(right_id, parent_id);
+  parent->PopulateNewRoot(left_id, MakeKey(50), right_id);
+  std::vector<page_id_t> children;
+  for (int i = 0; i < 10; i++) {
+    page_id_t child_id;
+    bpm->NewPage(&child_id);
+    bpm->UnpinPage(child_id, true);
+    children.push_back(child_id);
+  }
+  left->PopulateNewRoot(children[0], MakeKey(10), children[1]);
+  right->PopulateNewRoot(children[5], MakeKey(60), children[6]);
+  for (int i = 2; i < 5; i++) {
+    left->InsertNodeAfter(children[i - 1], MakeKey(10 * i), children[i]);
+    right->InsertNodeAfter(children[i + 4], MakeKey(50 + 10 * i), children[i + 5]);
+  }
+  auto check = [&](const InternalPage *page, const std::vector<int> &child_indexes, const std::vector<int> &keys) {
+    ASSERT_EQ(page->GetSize(), static_cast<int>(child_indexes.size()));
+    for (int i = 0; i < page->GetSize(); i++) {
+      EXPECT_EQ(page->ValueAt(i), children[child_indexes[i]]);
+      if (0 < i) {
+        EXPECT_EQ(page->KeyAt(i).ToString(), keys[i - 1]);
+      }
+      auto child = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(page->ValueAt(i))->GetData());
+      EXPECT_EQ(child->GetParentPageId(), page->GetPageId());
+      bpm->UnpinPage(page->ValueAt(i), false);
+    }
+  };
+  auto set_parents = [&](const InternalPage *page) {
+    for (int i = 0; i < page->GetSize(); i++) {
+      auto child = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(page->ValueAt(i))->GetData());
+      child->SetParentPageId(page->GetPageId());
+      bpm->UnpinPage(page->ValueAt(i), true);
+    }
+  };
+  set_parents(left);
+  set_parents(right);
+
+  // the separator moves down behind the moved child, which is adopted, and the rest of the right page moves up by
+  // whole entries
+  right->MoveFirstToEndOf(left, parent->KeyAt(1), bpm);
+  parent->SetKeyAt(1, right->KeyAt(0));
+  check(left, {0, 1, 2, 3, 4, 5}, {10, 20, 30, 40, 50});
+  check(right, {6, 7, 8, 9}, {70, 80, 90});
+  EXPECT_EQ(parent->KeyAt(1).ToString(), 60);
+
+  left->MoveLastToFrontOf(right, parent->KeyAt(1), bpm);
+  parent->SetKeyAt(1, right->KeyAt(0));
+  check(left, {0, 1, 2, 3, 4}, {10, 20, 30, 40});
+  check(right, {5, 6, 7, 8, 9}, {60, 70, 80, 90});
+  EXPECT_EQ(parent->KeyAt(1).ToString(), 50);
+
+  bpm->UnpinPage(parent_id, true);
+  bpm->UnpinPage(left_id, true);
+  bpm->UnpinPage(right_id, true);
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
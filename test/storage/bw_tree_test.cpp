@@ -0,0 +1,334 @@
+/**
+ * bw_tree_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/bw_tree.h"
+
+namespace bustub {
+
+using TestBwTree = BwTree<GenericKey<8>, RID, GenericComparator<8>>;
+
+namespace {
+
+RID KeyRid(int64_t key) { return RID(static_cast<int32_t>(key >> 32), static_cast<uint32_t>(key & 0xFFFFFFFF)); }
+
+// the keys of the whole tree, in scan order
+std::vector<int64_t> ScanKeys(TestBwTree *tree) {
+  std::vector<std::pair<GenericKey<8>, RID>> entries;
+  tree->Scan(nullptr, nullptr, &entries);
+  std::vector<int64_t> keys;
+  for (const auto &entry : entries) {
+    keys.push_back(entry.first.ToString());
+  }
+  return keys;
+}
+
+}  // namespace
+
+TEST(BwTreeTests, InsertTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  {
+    // small nodes, so that the tree splits into a few levels
+    TestBwTree tree("foo_pk", bpm, comparator, true, 4, 4);
+    GenericKey<8> index_key;
+    int64_t scale = 1000;
+    std::vector<int64_t> keys;
+    for (int64_t key = 1; key <= scale; key++) {
+      keys.push_back(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+    for (auto key : keys) {
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(tree.Insert(index_key, KeyRid(key)));
+    }
+    EXPECT_GT(tree.GetHeight(), 2);
+
+    std::vector<RID> rids;
+    for (int64_t key = 1; key <= scale; key++) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(tree.GetValue(index_key, &rids));
+      ASSERT_EQ(rids.size(), 1);
+      EXPECT_EQ(rids[0], KeyRid(key));
+      // a unique tree rejects a second value of a key
+      EXPECT_FALSE(tree.Insert(index_key, KeyRid(key + 1)));
+    }
+    rids.clear();
+    index_key.SetFromInteger(scale + 1);
+    EXPECT_FALSE(tree.GetValue(index_key, &rids));
+
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(ScanKeys(&tree), keys);
+
+    // bounded scan
+    GenericKey<8> low_key;
+    GenericKey<8> high_key;
+    low_key.SetFromInteger(100);
+    high_key.SetFromInteger(199);
+    std::vector<std::pair<GenericKey<8>, RID>> entries;
+    tree.Scan(&low_key, &high_key, &entries);
+    ASSERT_EQ(entries.size(), 100);
+    for (size_t i = 0; i < entries.size(); i++) {
+      EXPECT_EQ(entries[i].first.ToString(), 100 + static_cast<int64_t>(i));
+    }
+  }
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BwTreeTests, DeleteTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  {
+    TestBwTree tree("foo_pk", bpm, comparator, true, 4, 4);
+    GenericKey<8> index_key;
+    int64_t scale = 500;
+    for (int64_t key = 1; key <= scale; key++) {
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, KeyRid(key));
+    }
+    std::vector<int64_t> remaining;
+    for (int64_t key = 1; key <= scale; key++) {
+      index_key.SetFromInteger(key);
+      if (key % 3 == 0) {
+        tree.Remove(index_key);
+      } else if (key % 3 == 1) {
+        // the value must match
+        tree.Remove(index_key, KeyRid(key + 1));
+        remaining.push_back(key);
+      } else {
+        tree.Remove(index_key, KeyRid(key));
+      }
+    }
+    EXPECT_EQ(ScanKeys(&tree), remaining);
+    std::vector<RID> rids;
+    for (int64_t key = 1; key <= scale; key++) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      EXPECT_EQ(tree.GetValue(index_key, &rids), key % 3 == 1);
+    }
+    // deleted keys can be inserted again
+    index_key.SetFromInteger(3);
+    EXPECT_TRUE(tree.Insert(index_key, KeyRid(3)));
+    rids.clear();
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+  }
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BwTreeTests, NonUniqueTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  {
+    TestBwTree tree("foo_idx", bpm, comparator, false, 4, 4);
+    GenericKey<8> index_key;
+    int64_t scale = 50;
+    int values = 20;
+    for (int v = 0; v < values; v++) {
+      for (int64_t key = 1; key <= scale; key++) {
+        index_key.SetFromInteger(key);
+        EXPECT_TRUE(tree.Insert(index_key, RID(v, key)));
+      }
+    }
+    // a duplicate pair is rejected
+    index_key.SetFromInteger(1);
+    EXPECT_FALSE(tree.Insert(index_key, RID(0, 1)));
+
+    std::vector<RID> rids;
+    for (int64_t key = 1; key <= scale; key++) {
+      index_key.SetFromInteger(key);
+      // remove the odd values
+      for (int v = 1; v < values; v += 2) {
+        tree.Remove(index_key, RID(v, key));
+      }
+      rids.clear();
+      tree.GetValue(index_key, &rids);
+      std::sort(rids.begin(), rids.end(), [](const RID &lhs, const RID &rhs) { return lhs.Get() < rhs.Get(); });
+      ASSERT_EQ(rids.size(), values / 2);
+      for (int i = 0; i < values / 2; i++) {
+        EXPECT_EQ(rids[i], RID(2 * i, key));
+      }
+    }
+    EXPECT_EQ(ScanKeys(&tree).size(), scale * values / 2);
+
+    // removing a key removes all its values
+    index_key.SetFromInteger(7);
+    tree.Remove(index_key);
+    rids.clear();
+    EXPECT_FALSE(tree.GetValue(index_key, &rids));
+  }
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BwTreeTests, ConcurrentTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  {
+    TestBwTree tree("foo_pk", bpm, comparator, true, 8, 8);
+    int threads = 8;
+    int64_t scale = 20000;
+    std::vector<std::thread> workers;
+    // concurrent inserts
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+        GenericKey<8> index_key;
+        for (int64_t key = t; key < scale; key += threads) {
+          index_key.SetFromInteger(key);
+          EXPECT_TRUE(tree.Insert(index_key, KeyRid(key)));
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    workers.clear();
+    std::vector<int64_t> keys(scale);
+    for (int64_t key = 0; key < scale; key++) {
+      keys[key] = key;
+    }
+    ASSERT_EQ(ScanKeys(&tree), keys);
+
+    // concurrent deletes of the odd keys, while readers look up the even ones
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+        GenericKey<8> index_key;
+        std::vector<RID> rids;
+        for (int64_t key = 2 * t; key < scale; key += 2 * threads) {
+          if (t % 2 == 0) {
+            index_key.SetFromInteger(key + 1);
+            tree.Remove(index_key);
+            index_key.SetFromInteger(key + 3);
+            tree.Remove(index_key, KeyRid(key + 3));
+          } else {
+            rids.clear();
+            index_key.SetFromInteger(key);
+            EXPECT_TRUE(tree.GetValue(index_key, &rids));
+          }
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    std::vector<int64_t> remaining;
+    for (int64_t key = 0; key < scale; key += 2) {
+      remaining.push_back(key);
+    }
+    EXPECT_EQ(ScanKeys(&tree), remaining);
+    // the consolidated chains were freed once no thread could read them anymore
+    EXPECT_GT(tree.GetFreedNodeCount(), 0);
+  }
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// lookups and inserts of random keys, against the B+ tree, at 1 to 64 threads
+TEST(BwTreeTests, DISABLED_BenchmarkTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4096, disk_manager);
+  // the header page of the B+ trees
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  const int64_t preload = 100000;
+  const int64_t operations = 400000;
+
+  auto run = [&](int threads, const std::function<void(const GenericKey<8> &, int64_t, bool)> &operation) {
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+        std::mt19937_64 random(t);
+        GenericKey<8> index_key;
+        for (int64_t i = 0; i < operations / threads; i++) {
+          int64_t key = random() % (4 * preload);
+          index_key.SetFromInteger(key);
+          // one insert for every four lookups
+          operation(index_key, key, 0 == i % 5);
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return operations / elapsed.count();
+  };
+
+  std::cout << "threads, b+ tree ops/s, bw-tree ops/s" << std::endl;
+  for (int threads = 1; threads <= 64; threads *= 2) {
+    std::string name = "bench_" + std::to_string(threads);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> b_plus_tree(name, bpm, comparator);
+    TestBwTree bw_tree(name, bpm, comparator);
+    GenericKey<8> index_key;
+    for (int64_t key = 0; key < 4 * preload; key += 4) {
+      index_key.SetFromInteger(key);
+      b_plus_tree.Insert(index_key, KeyRid(key));
+      bw_tree.Insert(index_key, KeyRid(key));
+    }
+    double b_plus_tree_rate = run(threads, [&](const GenericKey<8> &key, int64_t value, bool insert) {
+      std::vector<RID> rids;
+      if (insert) {
+        b_plus_tree.Insert(key, KeyRid(value));
+      } else {
+        b_plus_tree.GetValue(key, &rids);
+      }
+    });
+    double bw_tree_rate = run(threads, [&](const GenericKey<8> &key, int64_t value, bool insert) {
+      std::vector<RID> rids;
+      if (insert) {
+        bw_tree.Insert(key, KeyRid(value));
+      } else {
+        bw_tree.GetValue(key, &rids);
+      }
+    });
+    std::cout << threads << ", " << static_cast<int64_t>(b_plus_tree_rate) << ", "
+              << static_cast<int64_t>(bw_tree_rate) << std::endl;
+  }
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
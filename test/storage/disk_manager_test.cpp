@@ -10,11 +10,16 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/memory_disk_manager.h"
+#include "storage/disk/simulated_disk_manager.h"
 
 namespace bustub {
 
@@ -72,6 +77,180 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, TablespaceTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  // pages [10, 20) are striped across two files
+  dm.AddTablespace(10, 20, {"test_ts0.db", "test_ts1.db"});
+  EXPECT_THROW(dm.AddTablespace(15, 30, {"test_ts2.db"}), Exception);
+
+  for (page_id_t page_id : {0, 9, 10, 11, 12, 19, 20}) {
+    std::snprintf(data, sizeof(data), "page %d", page_id);
+    dm.WritePage(page_id, data);
+  }
+  for (page_id_t page_id : {0, 9, 10, 11, 12, 19, 20}) {
+    std::snprintf(data, sizeof(data), "page %d", page_id);
+    std::memset(buf, 0, sizeof(buf));
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  }
+
+  // 10, 12 land in the first file, 11, 19 in the second; the db file itself stops at page 20
+  std::ifstream ts0("test_ts0.db", std::ios::binary | std::ios::ate);
+  std::ifstream ts1("test_ts1.db", std::ios::binary | std::ios::ate);
+  EXPECT_EQ(ts0.tellg(), 2 * PAGE_SIZE);
+  EXPECT_EQ(ts1.tellg(), 5 * PAGE_SIZE);
+
+  // 9 -> 10 -> 11 -> 12 and 19 -> 20 are sequential over the whole disk manager; within the striped files only
+  // 10 -> 12 is, the first two pages of the first file
+  auto stats = dm.GetStats();
+  EXPECT_EQ(stats.pages_written_, 7);
+  EXPECT_EQ(stats.pages_read_, 7);
+  EXPECT_EQ(stats.bytes_read_, 7 * PAGE_SIZE);
+  EXPECT_EQ(stats.sequential_reads_, 4);
+  EXPECT_EQ(stats.random_reads_, 3);
+  EXPECT_EQ(stats.read_latency_.count_, 7);
+  auto file_stats = dm.GetFileStats();
+  EXPECT_EQ(file_stats.size(), 3);
+  EXPECT_EQ(file_stats["test_ts0.db"].pages_written_, 2);
+  EXPECT_EQ(file_stats["test_ts1.db"].pages_written_, 2);
+  EXPECT_EQ(file_stats["test_ts0.db"].sequential_writes_, 1);
+  EXPECT_EQ(file_stats["test_ts0.db"].sequential_reads_, 1);
+  EXPECT_EQ(file_stats["test_ts1.db"].sequential_reads_, 0);
+  EXPECT_EQ(file_stats["test.db"].sequential_reads_, 0);
+  EXPECT_EQ(file_stats["test.db"].pages_read_, 3);
+
+  dm.ShutDown();
+  remove("test_ts0.db");
+  remove("test_ts1.db");
+  remove("test_ts2.db");
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ReadAheadTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  for (page_id_t page_id = 0; page_id < 20; page_id++) {
+    std::snprintf(data, sizeof(data), "page %d", page_id);
+    dm.WritePage(page_id, data);
+  }
+
+  // reading 1 after 0 stages 1..8, reading 9 stages 9..16, reading 17 stages 17..19, everything else is a hit
+  for (page_id_t page_id = 0; page_id < 20; page_id++) {
+    std::snprintf(data, sizeof(data), "page %d", page_id);
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  }
+  // the file only counts the reads that went to it, a hit is not a read
+  auto stats = dm.GetFileStats()["test.db"];
+  EXPECT_EQ(stats.pages_read_, 4);
+  EXPECT_EQ(stats.read_ahead_ios_, 3);
+  EXPECT_EQ(stats.read_ahead_pages_, 19);
+  EXPECT_EQ(stats.read_ahead_hits_, 16);
+
+  // writes keep staged pages coherent
+  std::snprintf(data, sizeof(data), "page 81");
+  dm.WritePage(18, data);
+  dm.ReadPage(18, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+  // a prefetched scan is served from the buffer from its first page on
+  dm.Prefetch(0, 4);
+  for (page_id_t page_id = 0; page_id < 4; page_id++) {
+    std::snprintf(data, sizeof(data), "page %d", page_id);
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  }
+  stats = dm.GetFileStats()["test.db"];
+  EXPECT_EQ(stats.read_ahead_ios_, 4);
+  EXPECT_EQ(stats.read_ahead_hits_, 21);
+
+  dm.SetReadAheadPages(1);
+  for (page_id_t page_id = 5; page_id < 8; page_id++) {
+    dm.ReadPage(page_id, buf);
+  }
+  stats = dm.GetFileStats()["test.db"];
+  EXPECT_EQ(stats.read_ahead_ios_, 4);
+  EXPECT_EQ(stats.read_ahead_hits_, 21);
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST(MemoryDiskManagerTest, ReadWriteTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  MemoryDiskManager dm;
+  std::strncpy(data, "A test string.", sizeof(data));
+
+  std::memset(buf, 1, sizeof(buf));
+  dm.ReadPage(3, buf);  // unwritten pages read back as zeroes
+  EXPECT_EQ(buf[0], 0);
+  EXPECT_EQ(buf[PAGE_SIZE - 1], 0);
+
+  dm.WritePage(3, data);
+  dm.ReadPage(3, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  EXPECT_EQ(dm.GetNumPages(), 1);
+  EXPECT_EQ(dm.GetNumWrites(), 1);
+
+  char log_buf[16] = {0};
+  EXPECT_FALSE(dm.ReadLog(log_buf, sizeof(log_buf), 0));
+  dm.WriteLog(data, sizeof(log_buf));
+  EXPECT_TRUE(dm.ReadLog(log_buf, sizeof(log_buf), 0));
+  EXPECT_EQ(std::memcmp(log_buf, data, sizeof(log_buf)), 0);
+  EXPECT_EQ(dm.GetNumFlushes(), 1);
+  EXPECT_EQ(dm.GetStats().log_bytes_written_, sizeof(log_buf));
+  EXPECT_EQ(dm.GetStats().log_latency_.count_, 1);
+}
+
+// NOLINTNEXTLINE
+TEST(SimulatedDiskManagerTest, LatencyTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  MemoryDiskManager memory;
+  DeviceProfile profile;
+  profile.read_latency_ = std::chrono::milliseconds(2);
+  profile.write_latency_ = std::chrono::milliseconds(5);
+  SimulatedDiskManager dm(&memory, profile);
+  std::strncpy(data, "A test string.", sizeof(data));
+
+  dm.WritePage(0, data);
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  // every request reaches the device once, and is recorded with at least the latency of the profile
+  EXPECT_EQ(dm.GetStats().pages_written_, 1);
+  EXPECT_EQ(dm.GetStats().pages_read_, 1);
+  EXPECT_EQ(memory.GetStats().pages_written_, 1);
+  EXPECT_EQ(memory.GetStats().pages_read_, 1);
+  EXPECT_GE(dm.GetStats().write_latency_.PercentileMicros(0.5), 5000);
+  EXPECT_GE(dm.GetStats().read_latency_.MeanMicros(), 2000);
+
+  // the file layout belongs to the wrapped device, which keeps every page in memory
+  dm.AddTablespace(10, 20, {"test_ts0.db"});
+  dm.SetReadAheadPages(4);
+  dm.WritePage(10, data);
+  std::ifstream ts0("test_ts0.db");
+  EXPECT_FALSE(ts0.is_open());
+  EXPECT_EQ(memory.GetNumPages(), 2);
+
+  // reads over a bandwidth-limited channel are counted like any other
+  profile = DeviceProfile();
+  profile.bandwidth_ = 1UL << 20U;
+  SimulatedDiskManager slow(&memory, profile);
+  for (int i = 0; i < 4; i++) {
+    slow.ReadPage(0, buf);
+  }
+  EXPECT_EQ(slow.GetStats().pages_read_, 4);
+  EXPECT_EQ(slow.GetStats().bytes_read_, 4 * PAGE_SIZE);
+  EXPECT_EQ(memory.GetStats().pages_read_, 5);
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
@@ -0,0 +1,204 @@
+/**
+ * generic_key_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/b_plus_tree_index.h"
+#include "storage/index/generic_key.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+static int Sign(int cmp) { return (cmp > 0) - (cmp < 0); }
+
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, NormalizedCompareTest) {
+  Schema *key_schema = ParseCreateStatement("a tinyint,b smallint,c integer,d bigint,e double,f bool");
+  EXPECT_TRUE(GenericKey<32>::CanNormalize(key_schema));
+  EXPECT_FALSE(GenericKey<16>::CanNormalize(key_schema));
+  Schema *varchar_schema = ParseCreateStatement("a varchar(8)");
+  EXPECT_FALSE(GenericKey<64>::CanNormalize(varchar_schema));
+
+  GenericComparator<32> comparator(key_schema);
+  GenericComparator<32> normalized_comparator(key_schema, true);
+  EXPECT_TRUE(normalized_comparator.IsNormalized());
+
+  // small value ranges, so that ties in the leading columns are common
+  std::mt19937 rng(445);
+  std::uniform_int_distribution<int> dist(-3, 3);
+  auto random_tuple = [&]() {
+    std::vector<Value> values{ValueFactory::GetTinyIntValue(dist(rng)),
+                              ValueFactory::GetSmallIntValue(dist(rng) * 1000),
+                              ValueFactory::GetIntegerValue(dist(rng) * 100000),
+                              ValueFactory::GetBigIntValue(dist(rng) * 10000000000L),
+                              ValueFactory::GetDecimalValue(dist(rng) * 0.75),
+                              ValueFactory::GetBooleanValue(dist(rng) > 0)};
+    return Tuple(values, key_schema);
+  };
+  for (int i = 0; i < 2000; i++) {
+    Tuple lhs = random_tuple();
+    Tuple rhs = random_tuple();
+    GenericKey<32> lhs_key;
+    GenericKey<32> rhs_key;
+    lhs_key.SetFromKey(lhs);
+    rhs_key.SetFromKey(rhs);
+    GenericKey<32> lhs_normalized;
+    GenericKey<32> rhs_normalized;
+    lhs_normalized.SetNormalizedFromKey(lhs, key_schema);
+    rhs_normalized.SetNormalizedFromKey(rhs, key_schema);
+    EXPECT_EQ(Sign(comparator(lhs_key, rhs_key)), normalized_comparator(lhs_normalized, rhs_normalized));
+    EXPECT_EQ(Sign(comparator(lhs_key, rhs_key)), Sign(memcmp(lhs_normalized.data_, rhs_normalized.data_, 32)));
+  }
+
+  // NULL sorts before every value
+  Schema *int_schema = ParseCreateStatement("a integer");
+  GenericComparator<8> int_comparator(int_schema, true);
+  GenericKey<8> null_key;
+  GenericKey<8> min_key;
+  null_key.SetNormalizedFromKey(Tuple({ValueFactory::GetNullValueByType(TypeId::INTEGER)}, int_schema), int_schema);
+  min_key.SetNormalizedFromKey(Tuple({ValueFactory::GetIntegerValue(BUSTUB_INT32_MIN)}, int_schema), int_schema);
+  EXPECT_LT(int_comparator(null_key, min_key), 0);
+
+  delete key_schema;
+  delete varchar_schema;
+  delete int_schema;
+}
+
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, NormalizedIndexTest) {
+  Schema *schema = ParseCreateStatement("a integer,b bigint");
+  // owned by the index
+  auto *metadata = new IndexMetadata("normalized_index", "t", schema, {1, 0});
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>> index(metadata, bpm);
+
+  // negative keys would sort after positive ones if their little-endian bytes were compared
+  std::vector<int64_t> keys;
+  for (int64_t key = -50; key < 50; key++) {
+    keys.push_back(key * 7919 % 100);
+  }
+  for (auto key : keys) {
+    Tuple tuple({ValueFactory::GetIntegerValue(static_cast<int32_t>(key)), ValueFactory::GetBigIntValue(-key)}, schema);
+    index.InsertEntry(tuple.KeyFromTuple(*schema, *metadata->GetKeySchema(), metadata->GetKeyAttrs()),
+                      RID(0, static_cast<uint32_t>(key + 100)), nullptr);
+  }
+
+  std::vector<RID> result;
+  Tuple probe({ValueFactory::GetBigIntValue(3), ValueFactory::GetIntegerValue(-3)}, metadata->GetKeySchema());
+  index.ScanKey(probe, &result, nullptr);
+  ASSERT_EQ(result.size(), 1);
+  EXPECT_EQ(result[0].GetSlotNum(), 97);
+
+  // ascending on b = -key
+  int64_t previous = 1000;
+  int count = 0;
+  for (auto it = index.GetBeginIterator(); it != index.GetEndIterator(); ++it) {
+    int64_t key = static_cast<int64_t>((*it).second.GetSlotNum()) - 100;
+    EXPECT_LT(key, previous);
+    previous = key;
+    count++;
+  }
+  EXPECT_EQ(count, keys.size());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, CompressedPageTest) {
+  using KeyType = GenericKey<64>;
+  using ValueType = RID;
+  Schema *key_schema = ParseCreateStatement("a bigint,b bigint");
+  GenericComparator<64> comparator(key_schema, true);
+  // 2 normalized BIGINTs take 18 of the 64 bytes
+  EXPECT_EQ(comparator.KeyLength(), 18);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  BPlusTree<KeyType, ValueType, GenericComparator<64>> tree("compressed_index", bpm, comparator);
+
+  // every key shares its first column, which the pages keep once as the prefix of their fences
+  auto make_key = [key_schema](int64_t key) {
+    KeyType index_key;
+    Tuple tuple({ValueFactory::GetBigIntValue(1L << 40), ValueFactory::GetBigIntValue(key)}, key_schema);
+    index_key.SetNormalizedFromKey(tuple, key_schema);
+    return index_key;
+  };
+  std::vector<int64_t> keys;
+  for (int64_t key = -3000; key < 3000; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(36));
+  auto insert = [&](int thread_itr) {
+    for (size_t i = thread_itr; i < keys.size(); i += 4) {
+      tree.Insert(make_key(keys[i]), RID(static_cast<int32_t>(keys[i] >> 32), static_cast<uint32_t>(keys[i])));
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back(insert, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // a leaf holds more keys than fit uncompressed
+  std::deque<Page *> latched;
+  Page *page = tree.FindLeafPage(make_key(0), false, Operation::READ, nullptr, &latched);
+  auto leaf = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, GenericComparator<64>> *>(page->GetData());
+  EXPECT_GT(leaf->GetMaxSize(), (PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / (sizeof(KeyType) + sizeof(ValueType)));
+  page->RUnlatch();
+  bpm->UnpinPage(page->GetPageId(), false);
+
+  // remove the odd keys, merging and redistributing pages of different prefixes
+  threads.clear();
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&](int thread_itr) {
+      for (int64_t key = -2999 + 2 * thread_itr; key < 3000; key += 8) {
+        tree.Remove(make_key(key));
+      }
+    }, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  int64_t expected = -3000;
+  for (auto it = tree.begin(); !it.isEnd(); ++it) {
+    EXPECT_EQ(comparator((*it).first, make_key(expected)), 0);
+    EXPECT_EQ(static_cast<int32_t>((*it).second.GetSlotNum()), expected);
+    expected += 2;
+  }
+  EXPECT_EQ(expected, 3000);
+  for (int64_t key = -3000; key < 3000; key++) {
+    std::vector<RID> result;
+    EXPECT_EQ(tree.GetValue(make_key(key), &result), key % 2 == 0);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub